@@ -0,0 +1,96 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <rog_map/rog_map_core/counter_map.h>
+
+namespace rog_map {
+
+    /* The squared Euclidean distance (in cells) from each cell to the nearest occupied cell of
+     * the prob map, capped at max_step cells. For every cell, the occupied cells of each distance
+     * shell within max_step are counted, so an occupancy edge only updates the counters of the
+     * ball around it, and the clearance is the smallest shell with a non-zero counter.
+     * */
+    class ClearanceMap : public CounterMap {
+    public:
+        typedef std::shared_ptr<ClearanceMap> Ptr;
+
+        ClearanceMap() = default;
+
+        ~ClearanceMap() override = default;
+
+        void initClearanceMap(
+                const Vec3i &half_prob_map_size_i, /* The input is half map size, to ensure the map size is always odds*/
+                const double &resolution,
+                const int &max_step,
+                const bool &map_sliding_en,
+                const double &sliding_thresh,
+                const Vec3f &fix_map_origin,
+                const double &unk_thresh,
+                const bool &brick_layout_en = false);
+
+        int getMaxStep() const {
+            return max_step_;
+        }
+
+        /* The squared distance in cells from id_g to the nearest occupied cell, or
+         * max_step * max_step + 1 if there is none within max_step. id_g should be
+         * inside the local map.
+         * */
+        int getClearanceSqr(const Vec3i &id_g) const {
+            const int shell = cells_[getHashIndexFromGlobalIndex(id_g) * stride_];
+            return shell_sqr_[shell];
+        }
+
+        void resetLocalMap() override;
+
+    private:
+        /* A run of neighbors from start to start + (0, 0, len - 1), shell_offset is the
+         * index in run_shells_ of the shell of the first neighbor
+         * */
+        struct NeighborRun {
+            Vec3i start;
+            int len;
+            int shell_offset;
+        };
+
+        int max_step_{0};
+        /* The number of distinct squared distances within max_step, including 0 */
+        int shell_num_{0};
+        /* The squared distance of each shell, shell_num_ stands for none within max_step */
+        std::vector<int> shell_sqr_;
+        std::vector<NeighborRun> neighbor_runs_;
+        std::vector<uint8_t> run_shells_;
+
+        /* Per cell, the clearance shell followed by the counter of each shell */
+        int stride_{0};
+        std::vector<uint8_t> cells_;
+
+        bool had_been_initialized{false};
+
+        void triggerJumpingEdge(const rog_map::Vec3i &id_g,
+                                const rog_map::GridType &from_type,
+                                const rog_map::GridType &to_type) override;
+    };
+}
@@ -24,10 +24,26 @@
 #pragma once
 
 #include <rog_map/rog_map_core/counter_map.h>
+#include <rog_map/rog_map_core/thread_pool.h>
 
 //#define ESDF_MAP_DEBUG
 
+/* Storage bits of the distances in ESDFMap, 64 for double, 32 for float */
+#ifndef ROG_MAP_ESDF_BITS
+#define ROG_MAP_ESDF_BITS 64
+#endif
+
 namespace rog_map {
+    using super_utils::Mat3Df;
+    using super_utils::VecDf;
+
+#if ROG_MAP_ESDF_BITS == 64
+    typedef double ESDFValue;
+#elif ROG_MAP_ESDF_BITS == 32
+    typedef float ESDFValue;
+#else
+#error "ROG_MAP_ESDF_BITS should be 64 or 32."
+#endif
 
     class ESDFMap : public CounterMap {
 
@@ -44,7 +60,11 @@ namespace rog_map {
                 const bool &map_sliding_en,
                 const double &sliding_thresh,
                 const Vec3f &fix_map_origin,
-                const double &unk_thresh);
+                const double &unk_thresh,
+                const bool &incremental_update_en = false,
+                const double &max_dist = 3.0,
+                const int &thread_num = 1,
+                const double &fallback_ratio = 0.03);
 
         void getUpdatedBbox(Vec3f & box_min,Vec3f & box_max)const;
 
@@ -56,14 +76,16 @@ namespace rog_map {
 
         void updateESDF3D(const Vec3f &cur_odom);
 
-        void resetOneCell(const int & hash_id) override;
-
         void evaluateEDT(const Eigen::Vector3d& pos, double& dist);
 
         void evaluateFirstGrad(const Eigen::Vector3d& pos, Eigen::Vector3d& grad);
 
         void evaluateSecondGrad(const Eigen::Vector3d& pos, Eigen::Vector3d& grad);
 
+        /* The interpolated distance and its gradient at each column of pos, the same
+         * values as evaluateEDT and evaluateFirstGrad at a fraction of the cost */
+        void evaluateEDTBatch(const Mat3Df &pos, VecDf &dist, Mat3Df &grad) const;
+
         void getPositiveESDFPointCloud(const rog_map::Vec3f &box_min_d, const rog_map::Vec3f &box_max_d,
                                      const double &visualize_z, pcl::PointCloud<pcl::PointXYZI> & pcl_pc);
 
@@ -76,18 +98,116 @@ namespace rog_map {
         void fillESDF(F_get_val f_get_val, F_set_val f_set_val,
                       const int &start, const int &end, const int &dim, const int &id_l);
 
+        /* Clamp to the storage type, an unreached cell keeps the max of double in the passes */
+        static ESDFValue toESDFValue(const double &val) {
+            return static_cast<ESDFValue>(std::min(val, static_cast<double>(std::numeric_limits<ESDFValue>::max())));
+        }
+
+        /* Run f(i) for i in [start, end], split over the thread pool. The EDT rows of a
+         * pass write disjoint cells, and the parabola envelope of a row lives on the stack
+         * of fillESDF, so the rows need no locking.
+         * */
+        template<typename F>
+        void parallelForRange(const int &start, const int &end, F &&f);
+
         bool had_been_initialized{false};
         bool map_empty_{true};
-        std::vector<double> distance_buffer;
-        vector<double> tmp_buffer1_, tmp_buffer2_;
+        std::vector<ESDFValue> distance_buffer;
+        vector<ESDFValue> tmp_buffer1_, tmp_buffer2_;
+        ThreadPool::Ptr thread_pool_;
         Vec3i half_local_update_box_i_;
         Vec3i update_local_map_min_i_, update_local_map_max_i_;
 
         std::mutex update_esdf_mtx;
 
+        /* With incremental_update_en, the distances in the local update box are kept by
+         * the dynamic brushfire of Lau et al. instead of recomputed every frame. A field
+         * keeps the nearest source cell of each cell, the positive field has the occupied
+         * cells as sources and the negative field the others. The occupancy edges and the
+         * motion of the box insert and remove sources, and only the cells whose nearest
+         * source changes are visited. The squared distances (in cells) are capped at
+         * sqr_dist_cap, and the source of a source cell is itself, whatever is stored in source.
+         * The fields only cover the box, a cell is stored at its global index modulo box_size_i.
+         * */
+        struct BrushfireField {
+            std::vector<int> sqr_dist;
+            vec_E<Vec3i> source;
+            std::vector<uint8_t> is_source;
+            std::vector<uint8_t> to_raise;
+            /* Only the occupied cells are visited, the negative distance of the others is zero */
+            bool occupied_only{false};
+            /* The open list, bucketed by the squared distance */
+            std::vector<vec_E<Vec3i>> open;
+            int open_min{0};
+            size_t open_size{0};
+        };
+
+        static constexpr int REBUILD_SLOW_NUM = 5;
+
+        struct IncrementalData {
+            bool enable{false};
+            double max_dist{0};
+            /* An update runs the full EDT instead when the cells entering the box and the
+             * occupancy edges in it are more than this ratio of the box, as when the box moves
+             * fast. The fields are then stale, and rebuilt once REBUILD_SLOW_NUM updates in a
+             * row are under the ratio, a rebuild costs about two full updates. The distances of
+             * the full update are not capped at max_dist.
+             * */
+            double fallback_ratio{0};
+            bool stale{true};
+            int slow_num{0};
+            Vec3i last_min{0, 0, 0}, last_max{-1, -1, -1};
+            size_t edge_num{0};
+            int sqr_dist_cap{0};
+            Vec3i box_size_i;
+            BrushfireField pos, neg;
+            std::vector<uint8_t> occupied;
+            /* The brushfire visits the cells in [box_min, box_max] and takes the sources in
+             * [valid_min, valid_max], they differ only while the box moves. Empty if min > max.
+             * */
+            Vec3i box_min{0, 0, 0}, box_max{-1, -1, -1};
+            Vec3i valid_min{0, 0, 0}, valid_max{-1, -1, -1};
+            /* The cells whose distance changed since the last update */
+            vec_E<Vec3i> changed;
+        } inc_;
+
+        static bool insideBox(const Vec3i &id_g, const Vec3i &box_min, const Vec3i &box_max) {
+            return (id_g - box_min).minCoeff() >= 0 && (box_max - id_g).minCoeff() >= 0;
+        }
+
+        int getBoxHash(const Vec3i &id_g) const;
+
+        template<typename F>
+        void forEachBoxNeighbor(const Vec3i &id_g, F &&f) const;
 
         void triggerJumpingEdge(const rog_map::Vec3i &id_g, const rog_map::GridType &from_type,
-                                const rog_map::GridType &to_type) override {}
+                                const rog_map::GridType &to_type) override;
+
+        void resetBrushfire(BrushfireField &field);
+
+        void clearBoxCell(const int &box_hash);
+
+        void pushBrushfire(BrushfireField &field, const int &sqr_dist, const Vec3i &id_g);
+
+        void setBrushfireSource(BrushfireField &field, const Vec3i &id_g);
+
+        void removeBrushfireSource(BrushfireField &field, const Vec3i &id_g);
+
+        bool isBrushfireSourceValid(const BrushfireField &field, const Vec3i &id_g) const;
+
+        void processBrushfire(BrushfireField &field);
+
+        void seedBoxCell(BrushfireField &field, const Vec3i &id_g);
+
+        void updateESDFFull(const Vec3f &cur_odom);
+
+        void updateESDFIncremental(const Vec3f &cur_odom);
+
+        /* Recompute both fields over the box from the occupancy, only the sources next to a
+         * cell of the other kind are spread */
+        void rebuildBrushfire(const Vec3i &box_min, const Vec3i &box_max);
+
+        void refreshDistance(const Vec3i &id_g);
 
         // EDT Environment
 
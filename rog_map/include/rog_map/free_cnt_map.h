@@ -26,6 +26,9 @@
 #pragma once
 
 #include <rog_map/rog_map_core/sliding_map.h>
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
 
 namespace rog_map {
     using namespace color_text;
@@ -34,6 +37,13 @@ namespace rog_map {
     public:
         typedef std::shared_ptr<FreeCntMap> Ptr;
 
+        /* A 26-connected cluster of frontier cells */
+        struct FrontierCluster {
+            Vec3f centroid;
+            int size{0};
+            vec_E<Vec3f> cells;
+        };
+
         FreeCntMap(const Vec3i &half_map_size_i,
                    const double &resolution,
                    const bool &sliding_en,
@@ -43,7 +53,7 @@ namespace rog_map {
                                                          sliding_en,
                                                          sliding_thresh,
                                                          fix_map_origin) {
-            int map_size = sc_.map_size_i.prod();
+            int map_size = sc_.map_vox_num;
             neighbor_free_cnt.resize(map_size, 0);
             resetLocalMap();
             std::cout << GREEN << " -- [InfMap] Init successfully -- ." << RESET << std::endl;
@@ -56,6 +66,34 @@ namespace rog_map {
         void resetLocalMap() override {
             std::cout << YELLOW << " -- [Fro-Map] Clear all local map."<<RESET << std::endl;
             std::fill(neighbor_free_cnt.begin(), neighbor_free_cnt.end(), 0);
+            if (frontier_index_.enable) {
+                std::fill(frontier_index_.known.begin(), frontier_index_.known.end(), 0);
+                clearFrontierIndex();
+            }
+        }
+
+        /* Label the frontier cells (unknown cells with a known free neighbor) with their
+         * cluster in a per-cell array, and merge the clusters incrementally, so that
+         * getFrontierClusters costs O(#frontiers) instead of a scan of the whole map.
+         * */
+        void initFrontierIndex();
+
+        /* The owner of the map reports the unknown <-> known transitions of a cell */
+        void updateKnownFlag(const Vec3i &id_g, const bool &known);
+
+        /* Only the cells inside [box_min, box_max] are indexed. The box should be updated
+         * after every map sliding.
+         * */
+        void setFrontierIndexBox(const Vec3i &box_min, const Vec3i &box_max);
+
+        /* Split the clusters that lost cells since the last query, then output all clusters.
+         * The split mutates the index, the caller must keep the map updates out, e.g. with
+         * a read view of the ProbMap.
+         * */
+        void getFrontierClusters(std::vector<FrontierCluster> &clusters);
+
+        int getFrontierNum() const {
+            return frontier_index_.frontier_num;
         }
 
         int getFreeCnt(const Vec3f &pos) {
@@ -91,6 +129,10 @@ namespace rog_map {
                                 throw std::runtime_error("Frontier counter overflow with smaller than 0");
                             }
                         }
+                        // The frontier state only changes when the counter crosses zero
+                        if (frontier_index_.enable && neighbor_free_cnt[hash_id] == (add ? 1 : 0)) {
+                            refreshFrontier(hash_id, neighbor_id_g);
+                        }
                     }
                 }
             }
@@ -98,6 +140,34 @@ namespace rog_map {
 
         void resetCell(const int &hash_id) override {
             neighbor_free_cnt[hash_id] = 0;
+            if (frontier_index_.enable) {
+                frontier_index_.known[hash_id] = 0;
+                removeFrontier(hash_id);
+            }
+        }
+
+        void resetSlab(const vector<int> &slab_hash, const vec_E<Vec3i> &slab_id_g) override {
+            for (const auto &hash_id: slab_hash) {
+                neighbor_free_cnt[hash_id] = 0;
+            }
+            if (frontier_index_.enable) {
+                for (const auto &hash_id: slab_hash) {
+                    frontier_index_.known[hash_id] = 0;
+                    removeFrontier(hash_id);
+                }
+            }
+        }
+
+        void resetBricks(const vector<int> &brick_hash) override {
+            static constexpr int BRICK_VOX_NUM = 1 << (3 * BRICK_BIT);
+            for (const auto &brick: brick_hash) {
+                const int start = brick << (3 * BRICK_BIT);
+                std::fill_n(neighbor_free_cnt.begin() + start, BRICK_VOX_NUM, 0);
+                if (frontier_index_.enable) {
+                    std::fill_n(frontier_index_.known.begin() + start, BRICK_VOX_NUM, 0);
+                    forEachCellInBrick(brick, [this](const int &hash_id) { removeFrontier(hash_id); });
+                }
+            }
         }
 
     private:
@@ -105,6 +175,56 @@ namespace rog_map {
         std::vector<int16_t> neighbor_free_cnt;
         rog_map::Config cfg_;
 
+        /* The members may hold stale cells that were removed or relabeled, they are
+         * dropped when the cluster is compacted or split.
+         * */
+        struct ClusterData {
+            vec_E<Vec3i> members;
+            int size{0};
+            Vec3f pos_sum{Vec3f::Zero()};
+            // Lost cells since the last split, may be disconnected and pos_sum is stale
+            bool dirty{false};
+        };
+
+        struct FrontierIndex {
+            bool enable{false};
+            std::vector<uint8_t> known;
+            // Cluster id of every frontier cell by hash id, -1 for the other cells
+            std::vector<int> label;
+            Vec3i box_min{Vec3i::Zero()}, box_max{Vec3i::Zero()};
+            // False until the first setFrontierIndexBox and after a reset
+            bool box_valid{false};
+            int frontier_num{0};
+            std::unordered_map<int, ClusterData> clusters;
+            int next_cluster_id{0};
+            std::mutex query_mtx;
+        } frontier_index_;
+
+        bool insideFrontierBox(const Vec3i &id_g) const {
+            return (id_g.array() >= frontier_index_.box_min.array()).all() &&
+                   (id_g.array() <= frontier_index_.box_max.array()).all();
+        }
+
+        /* Whether a member of the cluster still is a frontier cell of it */
+        bool isClusterMember(const Vec3i &id_g, const int &cluster_id) const {
+            return insideFrontierBox(id_g) &&
+                   frontier_index_.label[getHashIndexFromGlobalIndex(id_g)] == cluster_id;
+        }
+
+        void clearFrontierIndex();
+
+        void refreshFrontier(const int &hash_id, const Vec3i &id_g);
+
+        void insertFrontier(const int &hash_id, const Vec3i &id_g);
+
+        void removeFrontier(const int &hash_id);
+
+        void mergeCluster(const int &from_id, const int &to_id);
+
+        void compactCluster(ClusterData &cluster, const int &cluster_id);
+
+        void splitCluster(const int &cluster_id);
+
     };
 
 }
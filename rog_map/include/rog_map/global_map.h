@@ -0,0 +1,178 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <rog_map/rog_map_core/common_lib.hpp>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+namespace rog_map {
+
+    /* A sparse store of the prob map cells by global index, in bricks of 16x16x16 cells
+     * keyed by the global brick index. It keeps the cells written back by the sliding map
+     * after they leave the local map. The unknown cells are stored as 0, and a brick is only
+     * created by a known cell.
+     * */
+    template<typename ValueT>
+    class GlobalMap {
+    public:
+        typedef std::shared_ptr<GlobalMap<ValueT>> Ptr;
+
+        static constexpr int BRICK_BIT = 4;
+        static constexpr int BRICK_SIZE = 1 << BRICK_BIT;
+        static constexpr int BRICK_MASK = BRICK_SIZE - 1;
+        static constexpr int BRICK_CELL_NUM = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+        typedef std::array<ValueT, BRICK_CELL_NUM> Brick;
+
+        GlobalMap() = default;
+
+        /* The floor of id_g / BRICK_SIZE, the shift of a negative int rounds down */
+        static Vec3i brickIndex(const Vec3i &id_g) {
+            return {id_g.x() >> BRICK_BIT, id_g.y() >> BRICK_BIT, id_g.z() >> BRICK_BIT};
+        }
+
+        static int cellOffset(const Vec3i &id_g) {
+            return ((id_g.x() & BRICK_MASK) << (2 * BRICK_BIT)) |
+                   ((id_g.y() & BRICK_MASK) << BRICK_BIT) |
+                   (id_g.z() & BRICK_MASK);
+        }
+
+        void writeCell(const Vec3i &id_g, const ValueT &value) {
+            const Vec3i brick_id = brickIndex(id_g);
+            const int64_t key = brickKey(brick_id);
+            // The cells of a slab come in runs of the same brick
+            if (key != last_key_ || last_brick_ == nullptr) {
+                const auto it = bricks_.find(key);
+                if (it == bricks_.end()) {
+                    if (value == 0) {
+                        return;
+                    }
+                    last_brick_ = &bricks_.emplace(key, Brick{}).first->second;
+                } else {
+                    last_brick_ = &it->second;
+                }
+                last_key_ = key;
+            }
+            (*last_brick_)[cellOffset(id_g)] = value;
+        }
+
+        const Brick *findBrick(const Vec3i &brick_id) const {
+            const auto it = bricks_.find(brickKey(brick_id));
+            return it == bricks_.end() ? nullptr : &it->second;
+        }
+
+        size_t getBrickNum() const {
+            return bricks_.size();
+        }
+
+        void clear() {
+            bricks_.clear();
+            last_brick_ = nullptr;
+        }
+
+        /* The file is a header followed by the bricks, each as its brick index and cells. The
+         * resolution and the log-odds scale are checked by load, as the raw values depend on them.
+         * */
+        bool save(const std::string &file_name, const double &resolution, const double &scale) const {
+            std::ofstream file(file_name, std::ios::binary);
+            if (!file.is_open()) {
+                return false;
+            }
+            FileHeader header;
+            header.value_size = sizeof(ValueT);
+            header.resolution = resolution;
+            header.scale = scale;
+            header.brick_num = bricks_.size();
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            for (const auto &brick: bricks_) {
+                const Vec3i brick_id = keyToBrickIndex(brick.first);
+                const int32_t id[3] = {brick_id.x(), brick_id.y(), brick_id.z()};
+                file.write(reinterpret_cast<const char *>(id), sizeof(id));
+                file.write(reinterpret_cast<const char *>(brick.second.data()), sizeof(Brick));
+            }
+            return file.good();
+        }
+
+        bool load(const std::string &file_name, const double &resolution, const double &scale) {
+            std::ifstream file(file_name, std::ios::binary);
+            if (!file.is_open()) {
+                return false;
+            }
+            FileHeader header;
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!file.good() || std::memcmp(header.magic, FileHeader().magic, sizeof(header.magic)) != 0 ||
+                header.value_size != sizeof(ValueT) ||
+                std::fabs(header.resolution - resolution) > 1e-9 || std::fabs(header.scale - scale) > 1e-9) {
+                return false;
+            }
+            clear();
+            for (uint64_t i = 0; i < header.brick_num; i++) {
+                int32_t id[3];
+                Brick brick;
+                file.read(reinterpret_cast<char *>(id), sizeof(id));
+                file.read(reinterpret_cast<char *>(brick.data()), sizeof(Brick));
+                if (!file.good()) {
+                    clear();
+                    return false;
+                }
+                bricks_[brickKey(Vec3i(id[0], id[1], id[2]))] = brick;
+            }
+            return true;
+        }
+
+    private:
+        struct FileHeader {
+            char magic[8]{'R', 'O', 'G', 'G', 'M', 'A', 'P', '1'};
+            uint32_t value_size{0};
+            uint32_t brick_size{BRICK_SIZE};
+            double resolution{0};
+            double scale{1.0};
+            uint64_t brick_num{0};
+        };
+
+        /* 21 bits per axis, enough for 2^24 cells along each axis */
+        static constexpr int KEY_BIT = 21;
+        static constexpr int64_t KEY_OFFSET = int64_t(1) << (KEY_BIT - 1);
+        static constexpr int64_t KEY_MASK = (int64_t(1) << KEY_BIT) - 1;
+
+        static int64_t brickKey(const Vec3i &brick_id) {
+            return ((brick_id.x() + KEY_OFFSET) << (2 * KEY_BIT)) |
+                   ((brick_id.y() + KEY_OFFSET) << KEY_BIT) |
+                   (brick_id.z() + KEY_OFFSET);
+        }
+
+        static Vec3i keyToBrickIndex(const int64_t &key) {
+            return {static_cast<int>(((key >> (2 * KEY_BIT)) & KEY_MASK) - KEY_OFFSET),
+                    static_cast<int>(((key >> KEY_BIT) & KEY_MASK) - KEY_OFFSET),
+                    static_cast<int>((key & KEY_MASK) - KEY_OFFSET)};
+        }
+
+        std::unordered_map<int64_t, Brick> bricks_;
+        /* The brick of the last written cell, the nodes of an unordered_map never move */
+        int64_t last_key_{0};
+        Brick *last_brick_{nullptr};
+    };
+}
@@ -24,6 +24,10 @@
 #pragma once
 
 #include <rog_map/rog_map_core/counter_map.h>
+#include <rog_map/rog_map_core/raycaster.h>
+#include <rog_map/rog_map_core/map_snapshot.h>
+#include <atomic>
+#include <mutex>
 
 namespace rog_map {
 
@@ -40,7 +44,8 @@ namespace rog_map {
             return sc_.resolution;
         }
 
-        bool isOccupiedInflate(const Vec3f &pos) const;
+        /* The layer 0 is inflated by inflation_step, the layer i by inflation_layer_steps[i - 1] */
+        bool isOccupiedInflate(const Vec3f &pos, const int &layer_id = 0) const;
 
         bool isUnknownInflate(const Vec3f &pos) const;
 
@@ -53,39 +58,179 @@ namespace rog_map {
         void boxSearch(const Vec3f &box_min, const Vec3f &box_max,
                        const GridType &gt, vec_E<Vec3f> &out_points) const;
 
+        /* Check the segments from starts[i] to ends[i] against the inflated occupancy of a
+         * layer. blocked_t[i] is the parameter in [0, 1] where segment i enters its first
+         * occupied cell (or a cell farther than max_dis from its start), and -1 if the
+         * segment is free. The cells are visited as in RayCaster, the end cell is not
+         * checked. With stop_at_first_blocked, the segments after the first blocked one are
+         * abandoned and their blocked_t is NaN. Returns true if all segments are free.
+         * */
+        bool areLinesFree(const vec_Vec3f &starts, const vec_Vec3f &ends, std::vector<double> &blocked_t,
+                          const int &layer_id = 0, const double &max_dis = 999999,
+                          const bool &stop_at_first_blocked = false) const;
+
         void resetLocalMap() override;
 
         void infMapPosToGlobalIndex(const Vec3f &pos, Vec3i &id) const;
 
         void infMapGlobalIndexToPos(const Vec3i &id_g, Vec3f &pos) const;
 
-        GridType getGridType(const Vec3f &pos) const;
+        GridType getGridType(const Vec3f &pos, const int &layer_id = 0) const;
+
+        GridType getGridType(const Vec3i &id_g, const int &layer_id = 0) const;
+
+        /* True if the height z is inside the virtual ceil or ground of a layer, which getGridType(pos)
+         * reports as occupied */
+        bool isInflatedVirtualHeight(const double &z, const int &layer_id = 0) const;
+
+        /* The hash term along an axis of the cell containing the coordinate pos, or -1 outside
+         * the local map, see SlidingMap::getAxisHashTerm */
+        int getAxisHashTermOfPos(const double &pos, const int &axis) const {
+            int id_g;
+            posToGlobalIndex(pos, id_g);
+            return getAxisHashTerm(id_g, axis);
+        }
+
+        /* The grid type of a cell inside the local map from its counters, as getGridType(id_g) */
+        GridType getGridTypeOfHash(const int &hash_id, const int &layer_id = 0) const;
+
+        int getInflationLayerNum() const {
+            return 1 + static_cast<int>(imd_.layers.size());
+        }
 
-        GridType getGridType(const Vec3i &id_g) const ;
+        /* The layer with the smallest inflation radius not less than radius, or the largest layer */
+        int getInflationLayerId(const double &radius) const;
+
+        /* Append the counter buffers, in a fixed order, for the map snapshots */
+        void getSnapshotBuffers(std::vector<SnapshotBuffer> &buffers);
+
+        /* The jumping edges are kept in a log for the users updating their own state
+         * incrementally, e.g. a replanning path search. Append the edges after position seq
+         * of the log and move seq to its end. The log is only kept after the first call.
+         * Returns false if some edges after seq are lost: at the first call, after a reset
+         * of the map, or when seq is more than MAX_EDGE_LOG_SIZE edges behind.
+         *
+         * The inflated type of a cell only changes within getMaxInflationStep() cells of an
+         * edge, or when the cell enters or leaves the local map.
+         * */
+        bool getJumpingEdgesSince(uint64_t &seq, std::vector<JumpingEdge> &edges) const;
+
+        /* The largest inflation step of all layers and of the unknown inflation */
+        int getMaxInflationStep() const {
+            return max_inflation_step_;
+        }
 
     private:
+        /* A run of spherical neighbors from start to start + (0, 0, len - 1) */
+        struct NeighborRun {
+            Vec3i start;
+            int len;
+        };
+
         struct InfMapData {
             std::vector<int16_t> occ_inflate_cnt;
             std::vector<int16_t> unk_inflate_cnt;
             int unk_neighbor_num;
             int occ_neighbor_num;
+            /* The spherical neighbors grouped in runs along z, see forEachHashInZRun */
+            std::vector<NeighborRun> occ_neighbor_runs;
+            std::vector<NeighborRun> unk_neighbor_runs;
+
+            /* The extra layers of inflation_layer_steps, always counted per neighbor */
+            struct InfLayer {
+                int step;
+                int neighbor_num;
+                std::vector<NeighborRun> runs;
+                std::vector<int16_t> cnt;
+            };
+            std::vector<InfLayer> layers;
         } imd_;
 
+        /* With region_inflation_en, occ_inflate_cnt is a 0/1 flag of the squared distance
+         * (in cells) to the nearest occupied cell being within sqr_radius. An added occupied
+         * cell sets the flags of its neighbors, the blocks of 8x8x8 cells around a removed
+         * one are recomputed by a separable distance transform, with the z-runs of dirty
+         * blocks sharing one buffer. When the batch is dense, all dirty blocks are recomputed,
+         * so the cost follows the dirty volume instead of the neighbor number.
+         * */
+        static constexpr int INF_BLOCK_BIT = 3;
+        static constexpr int INF_BLOCK_SIZE = 1 << INF_BLOCK_BIT;
+        static constexpr size_t MAX_BLOCK_RUN = 8;
+
+        struct RegionInflationData {
+            int radius{0};
+            int sqr_radius{0};
+            int sqr_dist_cap{0};
+            std::vector<Vec3i> add_cells;
+            std::vector<Vec3i> all_blocks, removal_blocks;
+            /* buffers of the distance transform of a block */
+            std::vector<int> block_dist;
+            std::vector<int> line_f, env_v;
+            std::vector<double> env_z;
+        } rid_;
+
         rog_map::Config cfg_;
         int inf_num_{0};
         double inf_t_{0.0};
+        int max_inflation_step_{0};
+
+        static constexpr size_t MAX_EDGE_LOG_SIZE = 1 << 18;
+
+        struct EdgeLog {
+            mutable std::mutex mtx;
+            mutable std::atomic<bool> enabled{false};
+            std::vector<JumpingEdge> edges;
+            /* The position of edges[0] in the log */
+            uint64_t begin_seq{0};
+        } edge_log_;
+
+        void logJumpingEdges(const JumpingEdge *edges, const size_t &num);
+
+        /* Drop all edges of the log, the users behind its end will start over */
+        void clearEdgeLog();
 
         void triggerJumpingEdge(const rog_map::Vec3i &id_g,
                                 const rog_map::GridType &from_type,
                                 const rog_map::GridType &to_type) override;
 
-        bool isOccupiedInflate(const Vec3i &id_g) const;
+        void triggerJumpingEdgeBatch(const std::vector<JumpingEdge> &edges) override;
+
+        void inflateOccCell(const Vec3i &id_g);
+
+        template<class F>
+        void forEachBlockRun(const std::vector<Vec3i> &blocks, F &&f) const;
+
+        long recomputeCost(const std::vector<Vec3i> &blocks) const;
+
+        void recomputeBlocks(const std::vector<Vec3i> &blocks);
+
+        void recomputeOccInflation(const Vec3i &block, const int &block_num);
+
+        void sqrDistTransform1D(int *data, const int &n, const int &stride);
+
+        bool isOccupiedInflate(const Vec3i &id_g, const int &layer_id = 0) const;
+
+        /* Append the cells of the z-run [z_min, z_max] at (x, y) whose state is gt, in
+         * order of z, the hash is computed once per run inside the local map.
+         * */
+        void searchZRun(const int &x, const int &y, const int &z_min, const int &z_max,
+                        const GridType &gt, vec_E<Vec3f> &out_points) const;
+
+        int16_t getOccInflateCnt(const int &hash_id, const int &layer_id) const {
+            return layer_id == 0 ? imd_.occ_inflate_cnt[hash_id] : imd_.layers[layer_id - 1].cnt[hash_id];
+        }
+
+        int getLayerStep(const int &layer_id) const {
+            return layer_id == 0 ? cfg_.inflation_step : imd_.layers[layer_id - 1].step;
+        }
 
         void updateInflation(const Vec3i &id_g, const bool is_hit);
 
+        void updateLayerInflation(const Vec3i &id_g, const bool is_hit);
+
         void updateUnkInflation(const Vec3i &id_g, const bool is_add);
 
-        void resetOneCell(const int &hash_id) override;
+        static void buildNeighborRuns(const std::vector<Vec3i> &neighbors, std::vector<NeighborRun> &runs);
     };
 }
 
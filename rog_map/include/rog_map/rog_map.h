@@ -68,6 +68,12 @@ namespace rog_map {
                         const bool& use_inf_map = false,
                         const bool& use_unk_as_occ = false) const;
 
+        /* Same as isLineFree with the spherical neighbor list of ceil(radius / resolution)
+         * cells, each step is one clearance lookup with clearance_en, see isSphereFree.
+         * */
+        bool isSweptSphereFree(const Vec3f& start_pt, const Vec3f& end_pt,
+                               const double& radius, const double& max_dis = 999999) const;
+
         bool getNearestCellIs(const GridType& target_type,
                                 const Vec3f& start_pos,
                                 Vec3f& nearest_pt, const double& max_dis) const {
@@ -119,9 +125,28 @@ namespace rog_map {
 
         void updateRobotState(const Pose& pose);
 
+        /* The number of leading entries of cfg_.spherical_neighbor that may lie within max_dis
+         * of a position, and the largest coordinate among them */
+        int getNearestSearchNum(const double& max_dis, int& radius) const;
+
+        /* Search the cells start_id + cfg_.spherical_neighbor[i], i < nei_num, whose center is
+         * within max_dis of start_pos, per z column in order of distance to start_id. The
+         * columns come from cfg_.circular_neighbor, fill_column(column, bit_min, bit_max, target)
+         * sets the words of target holding the bits [bit_min, bit_max], bit k for the cell
+         * dz = k - radius, and the columns stop once they are farther than the best target.
+         * Among equally near cells any one may be returned.
+         * */
+        template<class F>
+        bool searchNearestColumn(const Vec3i& start_id, const Vec3f& start_pos, const double& max_dis,
+                                 const int& nei_num, const int& radius, F&& fill_column, Vec3f& nearest_pt) const;
+
+        /* The column search over the occupied and unknown bits of the prob map */
         bool findNearestCellThat(const bool & is, const GridType& target_type,
             const Vec3f & start_pos, Vec3f& nearest_pt, const double & max_dis) const ;
 
+        /* The column search over the inf map, the target bits of an inf map column are read
+         * once and shared by the prob map columns inside it.
+         * */
         bool findNearestInfCellThat(const bool & is, const GridType& target_type,
           const Vec3f & start_pos, Vec3f& nearest_pt, const double & max_dis) const ;
 
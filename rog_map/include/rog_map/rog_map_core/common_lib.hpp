@@ -41,6 +41,7 @@
 namespace rog_map {
     using super_utils::Vec3f;
     using super_utils::Vec3i;
+    using super_utils::Vec2i;
     using super_utils::vec_Vec3f;
     using super_utils::vec_E;
 
@@ -25,6 +25,7 @@
 
 #include <rog_map/rog_map_core/common_lib.hpp>
 #include <super_utils/yaml_loader.hpp>
+#include <thread>
 
 #ifndef ORIGIN_AT_CORNER
 #ifndef ORIGIN_AT_CENTER
@@ -83,6 +84,15 @@ namespace rog_map {
             loader.LoadParam(name_space + "/esdf/enable", esdf_en, false);
             vector<double> temp_esdf_update_box;
             loader.LoadParam(name_space + "/esdf/local_update_box", temp_esdf_update_box, temp_esdf_update_box);
+            loader.LoadParam(name_space + "/esdf/incremental_update_en", esdf_incremental_update_en, false);
+            loader.LoadParam(name_space + "/esdf/max_dist", esdf_max_dist, 3.0);
+            loader.LoadParam(name_space + "/esdf/incremental_fallback_ratio", esdf_incremental_fallback_ratio, 0.03);
+            loader.LoadParam(name_space + "/esdf/thread_num", esdf_thread_num, 1);
+            if (esdf_thread_num <= 0) {
+                esdf_thread_num = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+                std::cout << color_text::YELLOW << " -- [ROG] esdf thread_num is set to hardware concurrency: "
+                          << esdf_thread_num << RESET << std::endl;
+            }
 
             if (esdf_en) {
                 if (temp_esdf_update_box.size() != 3) {
@@ -91,6 +101,24 @@ namespace rog_map {
                     esdf_local_update_box = Vec3f(temp_esdf_update_box[0], temp_esdf_update_box[1],
                                                   temp_esdf_update_box[2]);
                 }
+                if (esdf_incremental_update_en && esdf_max_dist <= 0) {
+                    throw std::invalid_argument("The esdf max_dist should be positive!");
+                }
+            }
+
+            loader.LoadParam(name_space + "/global_map_en", global_map_en, false);
+            if (global_map_en) {
+                loader.LoadParam(name_space + "/load_global_map_en", load_global_map_en, false);
+                loader.LoadParam(name_space + "/save_global_map_en", save_global_map_en, false);
+                loader.LoadParam(name_space + "/global_map_name", global_map_name, string("global_map.bin"));
+                global_map_name = replaceCmakeRootDir(global_map_name);
+            }
+            loader.LoadParam(name_space + "/map_save_period", map_save_period, -1.0);
+
+            loader.LoadParam(name_space + "/clearance/enable", clearance_en, false);
+            loader.LoadParam(name_space + "/clearance/max_step", clearance_max_step, 2);
+            if (clearance_en && clearance_max_step < 1) {
+                throw std::invalid_argument("The clearance max_step should be positive!");
             }
 
 
@@ -100,8 +128,16 @@ namespace rog_map {
                 pcd_name = replaceCmakeRootDir(pcd_name);
             }
 
+            loader.LoadParam(name_space + "/load_snapshot_en", load_snapshot_en, false);
+            loader.LoadParam(name_space + "/save_snapshot_en", save_snapshot_en, false);
+            if (load_snapshot_en || save_snapshot_en) {
+                loader.LoadParam(name_space + "/snapshot_name", snapshot_name, string("map.snap"));
+                snapshot_name = replaceCmakeRootDir(snapshot_name);
+            }
+
             loader.LoadParam(name_space + "/map_sliding/enable", map_sliding_en, true);
             loader.LoadParam(name_space + "/map_sliding/threshold", map_sliding_thresh, -1.0);
+            loader.LoadParam(name_space + "/brick_layout_en", brick_layout_en, false);
 
             vector<double> temp_fix_origin;
             loader.LoadParam(name_space + "/fix_map_origin", temp_fix_origin, vector<double>{0, 0, 0});
@@ -112,6 +148,7 @@ namespace rog_map {
             }
 
             loader.LoadParam(name_space + "/frontier_extraction_en", frontier_extraction_en, false);
+            loader.LoadParam(name_space + "/frontier_cluster_en", frontier_cluster_en, false);
 
             loader.LoadParam(name_space + "/ros_callback/enable", ros_callback_en, false);
             loader.LoadParam(name_space + "/ros_callback/cloud_topic", cloud_topic, string("/cloud_registered"));
@@ -156,6 +193,13 @@ namespace rog_map {
             loader.LoadParam(name_space + "/unk_inflation_step", unk_inflation_step, 1);
 
             loader.LoadParam(name_space + "/inflation_step", inflation_step, 1);
+            loader.LoadParam(name_space + "/region_inflation_en", region_inflation_en, false);
+            loader.LoadParam(name_space + "/inflation_layer_steps", inflation_layer_steps, vector<int>{});
+            for (const auto &step: inflation_layer_steps) {
+                if (step < 1) {
+                    throw std::invalid_argument("The inflation_layer_steps should be larger or equal than 1!");
+                }
+            }
             loader.LoadParam(name_space + "/intensity_thresh", intensity_thresh, -1);
 
             vector<double> temp_map_size;
@@ -182,6 +226,13 @@ namespace rog_map {
                           << RESET << std::endl;
                 batch_update_size = 1;
             }
+            loader.LoadParam(name_space + "/raycasting/thread_num", raycast_thread_num, 1);
+            if (raycast_thread_num <= 0) {
+                raycast_thread_num = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+                std::cout << color_text::YELLOW << " -- [ROG] raycasting thread_num is set to hardware concurrency: "
+                          << raycast_thread_num << RESET << std::endl;
+            }
+            loader.LoadParam(name_space + "/raycasting/pipeline_en", pipeline_update_en, false);
             loader.LoadParam(name_space + "/raycasting/unk_thresh", unk_thresh, 0.70);
             loader.LoadParam(name_space + "/raycasting/p_hit", p_hit, 0.70f);
             loader.LoadParam(name_space + "/raycasting/p_miss", p_miss, 0.70f);
@@ -250,6 +301,20 @@ namespace rog_map {
                 return a.x() * a.x() + a.y() * a.y() + a.z() * a.z() < b.x() * b.x() + b.y() * b.y() + b.z() * b.z();
             });
 
+            inf_layer_spherical_neighbor.assign(inflation_layer_steps.size(), {});
+            for (size_t i = 0; i < inflation_layer_steps.size(); i++) {
+                const int step = inflation_layer_steps[i];
+                for (int dx = -step; dx <= step; dx++) {
+                    for (int dy = -step; dy <= step; dy++) {
+                        for (int dz = -step; dz <= step; dz++) {
+                            if (step == 1 || dx * dx + dy * dy + dz * dz <= step * step) {
+                                inf_layer_spherical_neighbor[i].emplace_back(dx, dy, dz);
+                            }
+                        }
+                    }
+                }
+            }
+
             if (unk_inflation_en) {
                 unk_inf_spherical_neighbor.clear();
                 // init spherical neighbor
@@ -285,19 +350,59 @@ namespace rog_map {
             std::sort(spherical_neighbor.begin(), spherical_neighbor.end(), [](const Vec3i &a, const Vec3i &b) {
                 return a.x() * a.x() + a.y() * a.y() + a.z() * a.z() < b.x() * b.x() + b.y() * b.y() + b.z() * b.z();
             });
+            /* the z columns of the same ball, for the column search of the prob map */
+            for (int dx = -max_seach_step; dx <= max_seach_step; dx++) {
+                for (int dy = -max_seach_step; dy <= max_seach_step; dy++) {
+                    if (dx * dx + dy * dy <= max_seach_step * max_seach_step) {
+                        circular_neighbor.emplace_back(dx, dy);
+                    }
+                }
+            }
+            std::sort(circular_neighbor.begin(), circular_neighbor.end(), [](const Vec2i &a, const Vec2i &b) {
+                return a.squaredNorm() < b.squaredNorm();
+            });
         }
 
         // add 24.07.18 add esdf
         bool esdf_en{false};
         Vec3f esdf_local_update_box{};
         double esdf_resolution{};
+        /* update the distances changed by the occupancy edges instead of the whole local update box */
+        bool esdf_incremental_update_en{false};
+        double esdf_max_dist{};
+        /* the incremental update runs the full update when this ratio of the box changes */
+        double esdf_incremental_fallback_ratio{0.03};
+        /* number of threads used by the EDT passes of the full update, 1 for the serial EDT */
+        int esdf_thread_num{1};
+
+        /* keep the cells leaving the local map in a global map and page them back in */
+        bool global_map_en{false};
+        /* load the global map saved by saveGlobalMap at startup, and save it on exit */
+        bool load_global_map_en{false}, save_global_map_en{false};
+        string global_map_name{"global_map.bin"};
+        /* the maps enabled for saving are also saved every map_save_period seconds of updates if positive */
+        double map_save_period{-1};
+
+        /* keep the distance to the nearest occupied cell for the swept sphere check */
+        bool clearance_en{false};
+        /* the clearance is capped at max_step cells */
+        int clearance_max_step{2};
 
         bool load_pcd_en{false};
         bool use_dynamic_reconfigure{false};
         string pcd_name{"map.pcd"};
+        /* load a snapshot saved by saveSnapshot at startup, the pcd is only loaded if it fails */
+        bool load_snapshot_en{false};
+        /* save the snapshot on exit, and every map_save_period seconds if positive */
+        bool save_snapshot_en{false};
+        string snapshot_name{"map.snap"};
 
         double resolution{}, inflation_resolution{};
         int inflation_step{};
+        /* recompute the inflation of dirty blocks instead of the per-cell neighbor update when cheaper */
+        bool region_inflation_en{false};
+        /* the inflation steps of the extra layers, layer 0 is inflation_step */
+        std::vector<int> inflation_layer_steps{};
         Vec3f local_update_box_d, half_local_update_box_d{};
         Vec3i local_update_box_i, half_local_update_box_i{};
         Vec3f map_size_d, half_map_size_d{};
@@ -310,26 +415,35 @@ namespace rog_map {
         double virtual_ceil_height{}, virtual_ground_height{};
         int inf_virtual_ceil_height_id_g{}, inf_virtual_ground_height_id_g{};
 
-        bool visualization_en{false}, frontier_extraction_en{false},
+        bool visualization_en{false}, frontier_extraction_en{false}, frontier_cluster_en{false},
                 raycasting_en{true}, ros_callback_en{false}, pub_unknown_map_en{false};
 
         /* Spherical neighbor for inflation*/
         std::vector<Vec3i> inf_spherical_neighbor{};
         std::vector<Vec3i> unk_inf_spherical_neighbor{};
+        std::vector<std::vector<Vec3i>> inf_layer_spherical_neighbor{};
         /* Spherical neighbor for nearest search within x m*/
         std::vector<Vec3i> spherical_neighbor{};
+        /* The (dx, dy) of the z columns of spherical_neighbor, sorted by distance */
+        std::vector<Vec2i> circular_neighbor{};
 
         /* intensity noise filter*/
         int intensity_thresh{};
         /* aster properties */
         string frame_id{};
         bool map_sliding_en{true};
+        /* store the prob map and the inflation map in 8x8x8 bricks */
+        bool brick_layout_en{false};
         Vec3f fix_map_origin{};
         string odom_topic{}, cloud_topic{};
         /* probability update */
         double raycast_range_min{}, raycast_range_max{};
         double sqr_raycast_range_min{}, sqr_raycast_range_max{};
         int point_filt_num{}, batch_update_size{};
+        /* number of threads used to walk the rays, 1 for the serial raycasting */
+        int raycast_thread_num{1};
+        /* apply the probability and jump edge update in a second thread, overlapped with the next raycasting */
+        bool pipeline_update_en{false};
         float p_hit{}, p_miss{}, p_min{}, p_max{}, p_occ{}, p_free{};
         float l_hit{}, l_miss{}, l_min{}, l_max{}, l_occ{}, l_free{};
 
@@ -373,6 +487,9 @@ namespace rog_map {
             } else {
                 max_step = std::max(inflation_step, unk_inflation_step);
             }
+            for (const auto &step: inflation_layer_steps) {
+                max_step = std::max(max_step, step);
+            }
             inf_half_map_size_i = (half_map_size_d / inflation_resolution).cast<int>()
                                   + (max_step + 1) * Vec3i::Ones();
 
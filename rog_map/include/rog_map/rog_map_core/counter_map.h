@@ -44,6 +44,26 @@ namespace rog_map {
                                const GridType &from_type,
                                const GridType &to_type);
 
+        struct GridCounterUpdate {
+            Vec3f pos;
+            GridType from_type;
+            GridType to_type;
+        };
+
+        /* Apply a batch of sub-cell updates. The counters are updated first, then the
+         * jumping edge of each touched cell is triggered once in the order of the hash id,
+         * from its type before the batch to its type after the batch. So the updates
+         * canceling each other in a cell trigger nothing.
+         * */
+        void updateGridCounterBatch(const std::vector<GridCounterUpdate> &updates);
+
+        /* A counter cell whose type changed */
+        struct JumpingEdge {
+            Vec3i id_g;
+            GridType from_type;
+            GridType to_type;
+        };
+
 
     protected:
         bool map_empty_{true};
@@ -58,6 +78,19 @@ namespace rog_map {
             int unk_thresh;
         } md_;
 
+        struct BatchData {
+            /* A cell is touched by the current batch iff its stamp equals the generation */
+            std::vector<uint16_t> stamp;
+            uint16_t generation{0};
+            struct TouchedCell {
+                int hash_id;
+                Vec3i id_g;
+                GridType from_type;
+            };
+            std::vector<TouchedCell> touched;
+            std::vector<JumpingEdge> edges;
+        } bd_;
+
 
         void initCounterMap(
                 const Vec3i &half_prob_map_size_i, /* The input is half map size, to ensure the map size is always odds*/
@@ -67,7 +100,8 @@ namespace rog_map {
                 const bool &map_sliding_en,
                 const double &sliding_thresh,
                 const Vec3f &fix_map_origin,
-                const double &unk_thresh);
+                const double &unk_thresh,
+                const bool &brick_layout_en = false);
 
 
         /* The '=' is necessary. When unk thresh is set to 1.0, a cell in counter map
@@ -99,12 +133,14 @@ namespace rog_map {
                                         const GridType &from_type,
                                         const GridType &to_type) = 0;
 
-        /* When map sliding, a reset command is called, the counter map
-         * should reset the unk and occ counter and at the same time call
-         * reset to the derived class to reset the map
+        /* The jumping edges of a batch, in the memory order of the cells. The default
+         * implementation calls triggerJumpingEdge for each edge.
          * */
-
-        virtual void resetOneCell(const int &hash_id) = 0;
+        virtual void triggerJumpingEdgeBatch(const std::vector<JumpingEdge> &edges) {
+            for (const auto &edge: edges) {
+                triggerJumpingEdge(edge.id_g, edge.from_type, edge.to_type);
+            }
+        }
 
         bool isUnknown(const Vec3i &id_g) const;
 
@@ -126,12 +162,33 @@ namespace rog_map {
         }
 
     private:
+        /* When map sliding, the counter map only resets the unk and occ counter. A
+         * reset cell becomes unknown, and the cells of the prob map inside it had been
+         * reset before, so no jumping edge is triggered.
+         * */
         void resetCell(const int &hash_id) override {
             md_.occupied_cnt[hash_id] = 0;
             md_.unknown_cnt[hash_id] = md_.sub_grid_num;
-            resetOneCell(hash_id);
         }
 
+        void resetSlab(const vector<int> &slab_hash, const vec_E<Vec3i> &slab_id_g) override {
+            for (const auto &hash_id: slab_hash) {
+                md_.occupied_cnt[hash_id] = 0;
+                md_.unknown_cnt[hash_id] = md_.sub_grid_num;
+            }
+        }
+
+        void resetBricks(const vector<int> &brick_hash) override {
+            static constexpr int BRICK_VOX_NUM = 1 << (3 * BRICK_BIT);
+            for (const auto &brick: brick_hash) {
+                const int start = brick << (3 * BRICK_BIT);
+                std::fill_n(md_.occupied_cnt.begin() + start, BRICK_VOX_NUM, 0);
+                std::fill_n(md_.unknown_cnt.begin() + start, BRICK_VOX_NUM, md_.sub_grid_num);
+            }
+        }
+
+        void applyGridCounter(const int &addr, const GridType &from_type, const GridType &to_type);
+
         bool had_been_initialized{false};
 
 
@@ -0,0 +1,91 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <rog_map/rog_map_core/common_lib.hpp>
+#include <cstdint>
+
+namespace rog_map {
+
+    /* A raw buffer of a map layer, stored as one section of a snapshot */
+    struct SnapshotBuffer {
+        char *data;
+        size_t size;
+    };
+
+    template<typename T>
+    SnapshotBuffer makeSnapshotBuffer(std::vector<T> &buffer) {
+        return {reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(T)};
+    }
+
+    /* A binary snapshot of the map buffers. The file is a header with the local map origin,
+     * the parameters the raw values depend on and the size of each section, followed by the
+     * sections. Opening a snapshot maps the file and checks the header against the current
+     * map, so a snapshot of another configuration or a truncated file is rejected before any
+     * buffer is touched, and loading is a plain copy of each section.
+     * */
+    class MapSnapshot {
+    public:
+        MapSnapshot() = default;
+
+        ~MapSnapshot();
+
+        MapSnapshot(const MapSnapshot &) = delete;
+
+        MapSnapshot &operator=(const MapSnapshot &) = delete;
+
+        /* The file is written next to file_name and renamed, so a crash while saving never
+         * leaves a broken snapshot behind.
+         * */
+        static bool save(const std::string &file_name, const Vec3i &origin_i,
+                         const std::vector<double> &params, const std::vector<SnapshotBuffer> &buffers);
+
+        /* Map the file, and check its parameters and section sizes against params and buffers */
+        bool open(const std::string &file_name, const std::vector<double> &params,
+                  const std::vector<SnapshotBuffer> &buffers);
+
+        const Vec3i &getOrigin() const {
+            return origin_i_;
+        }
+
+        /* Copy the sections into the buffers checked by open */
+        void copyTo(const std::vector<SnapshotBuffer> &buffers) const;
+
+    private:
+        struct FileHeader {
+            char magic[8]{'R', 'O', 'G', 'S', 'N', 'A', 'P', '1'};
+            int32_t origin_i[3]{0, 0, 0};
+            uint32_t param_num{0};
+            uint64_t buffer_num{0};
+        };
+
+        void close();
+
+        void *addr_{nullptr};
+        size_t file_size_{0};
+        Vec3i origin_i_{Vec3i::Zero()};
+        /* The offset of each section in the file */
+        std::vector<size_t> offsets_;
+    };
+}
@@ -23,6 +23,11 @@
 
 #include "raycaster.h"
 
+#if defined(ROG_MAP_USE_AVX2) && (defined(__x86_64__) || defined(__i386__))
+#define ROG_MAP_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
 namespace rog_map {
     namespace raycaster {
         RayCaster::RayCaster(const double &resolution) {
@@ -208,5 +213,123 @@ namespace rog_map {
             return true;
         }
 
+        void BatchRayCaster::setResolution(const double &resolution) {
+            setup_.setResolution(resolution);
+        }
+
+        bool BatchRayCaster::loadRay(const int &lane, const int &ray_id,
+                                     const Eigen::Vector3d &start, const Eigen::Vector3d &end) {
+            // The start and end are in the same cell, RayCaster::step reports nothing for this ray
+            if (!setup_.setInput(start, end)) {
+                return false;
+            }
+            ray_id_[lane] = ray_id;
+            t_to_bound_[0][lane] = setup_.t_to_bound_x_;
+            t_to_bound_[1][lane] = setup_.t_to_bound_y_;
+            t_to_bound_[2][lane] = setup_.t_to_bound_z_;
+            t_when_step_[0][lane] = setup_.t_when_step_x_;
+            t_when_step_[1][lane] = setup_.t_when_step_y_;
+            t_when_step_[2][lane] = setup_.t_when_step_z_;
+            cur_id_[0][lane] = setup_.cur_ray_pt_id_x_;
+            cur_id_[1][lane] = setup_.cur_ray_pt_id_y_;
+            cur_id_[2][lane] = setup_.cur_ray_pt_id_z_;
+            end_id_[0][lane] = setup_.end_x_i_;
+            end_id_[1][lane] = setup_.end_y_i_;
+            end_id_[2][lane] = setup_.end_z_i_;
+            expand_dir_[0][lane] = setup_.expand_dir_x_;
+            expand_dir_[1][lane] = setup_.expand_dir_y_;
+            expand_dir_[2][lane] = setup_.expand_dir_z_;
+            return true;
+        }
+
+        bool BatchRayCaster::avx2Supported() {
+#ifdef ROG_MAP_AVX2_DISPATCH
+            static const bool supported = __builtin_cpu_supports("avx2");
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        void BatchRayCaster::stepLanes() {
+            if (use_avx2_) {
+                stepLanesAVX2();
+            } else {
+                stepLanesScalar();
+            }
+        }
+
+        void BatchRayCaster::stepLanesScalar() {
+            for (int lane = 0; lane < kLaneNum; lane++) {
+                if (!step_mask_[lane]) {
+                    continue;
+                }
+                int axis;
+                if (t_to_bound_[0][lane] < t_to_bound_[1][lane]) {
+                    axis = t_to_bound_[0][lane] < t_to_bound_[2][lane] ? 0 : 2;
+                } else {
+                    axis = t_to_bound_[1][lane] < t_to_bound_[2][lane] ? 1 : 2;
+                }
+                cur_id_[axis][lane] += expand_dir_[axis][lane];
+                t_to_bound_[axis][lane] += t_when_step_[axis][lane];
+            }
+        }
+
+#ifdef ROG_MAP_AVX2_DISPATCH
+        // Only this function is compiled for AVX2, it is called after avx2Supported()
+        __attribute__((target("avx2")))
+        void BatchRayCaster::stepLanesAVX2() {
+            const __m256d step = _mm256_castsi256_pd(
+                    _mm256_load_si256(reinterpret_cast<const __m256i *>(step_mask_)));
+            const __m256d tx = _mm256_load_pd(t_to_bound_[0]);
+            const __m256d ty = _mm256_load_pd(t_to_bound_[1]);
+            const __m256d tz = _mm256_load_pd(t_to_bound_[2]);
+            // Same branches as RayCaster::step: x if x < y && x < z, y if !(x < y) && y < z, otherwise z
+            const __m256d x_lt_y = _mm256_cmp_pd(tx, ty, _CMP_LT_OQ);
+            const __m256d sel_x = _mm256_and_pd(step, _mm256_and_pd(x_lt_y, _mm256_cmp_pd(tx, tz, _CMP_LT_OQ)));
+            const __m256d sel_y = _mm256_and_pd(step, _mm256_andnot_pd(x_lt_y, _mm256_cmp_pd(ty, tz, _CMP_LT_OQ)));
+            const __m256d sel_z = _mm256_andnot_pd(_mm256_or_pd(sel_x, sel_y), step);
+            _mm256_store_pd(t_to_bound_[0], _mm256_add_pd(tx, _mm256_and_pd(sel_x, _mm256_load_pd(t_when_step_[0]))));
+            _mm256_store_pd(t_to_bound_[1], _mm256_add_pd(ty, _mm256_and_pd(sel_y, _mm256_load_pd(t_when_step_[1]))));
+            _mm256_store_pd(t_to_bound_[2], _mm256_add_pd(tz, _mm256_and_pd(sel_z, _mm256_load_pd(t_when_step_[2]))));
+            const int axis_mask[3] = {_mm256_movemask_pd(sel_x), _mm256_movemask_pd(sel_y), _mm256_movemask_pd(sel_z)};
+            for (int lane = 0; lane < kLaneNum; lane++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    if (axis_mask[axis] & (1 << lane)) {
+                        cur_id_[axis][lane] += expand_dir_[axis][lane];
+                    }
+                }
+            }
+        }
+#else
+        void BatchRayCaster::stepLanesAVX2() {
+            stepLanesScalar();
+        }
+#endif
+
+#ifdef RAYCASTER_DEBUG
+        void BatchRayCaster::checkRay(const Eigen::Vector3d &start, const Eigen::Vector3d &end,
+                                      const std::vector<Eigen::Vector3i> &visited) const {
+            RayCaster raycaster(setup_.resolution_);
+            raycaster.setInput(start, end);
+            Eigen::Vector3d ray_pt;
+            size_t cnt = 0;
+            while (cnt < visited.size() && raycaster.step(ray_pt)) {
+                Eigen::Vector3i id;
+                raycaster.posToIndex(ray_pt.x(), id.x());
+                raycaster.posToIndex(ray_pt.y(), id.y());
+                raycaster.posToIndex(ray_pt.z(), id.z());
+                if (id != visited[cnt]) {
+                    std::cout << " -- [BatchRayCaster]: cell " << cnt << " mismatch, expect " << id.transpose()
+                              << " but got " << visited[cnt].transpose() << std::endl;
+                    throw std::runtime_error(" -- [BatchRayCaster]: result differs from RayCaster!");
+                }
+                cnt++;
+            }
+            if (cnt != visited.size()) {
+                throw std::runtime_error(" -- [BatchRayCaster]: visited more cells than RayCaster!");
+            }
+        }
+#endif
     }
 }
\ No newline at end of file
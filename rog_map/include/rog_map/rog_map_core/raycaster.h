@@ -29,6 +29,9 @@
 #include "memory"
 #include "common_lib.hpp"
 
+// Cross check every ray of the BatchRayCaster with the scalar RayCaster
+// #define RAYCASTER_DEBUG
+
 #ifndef ORIGIN_AT_CORNER
 #ifndef ORIGIN_AT_CENTER
 #error "Please define either ORIGIN_AT_CORNER or ORIGIN_AT_CENTER, but not both."
@@ -73,6 +76,7 @@ namespace rog_map {
             bool step(Eigen::Vector3d &ray_pt);
 
         private:
+            friend class BatchRayCaster;
             double resolution_{-1};
             bool first_point{true};
             // progress variables
@@ -86,6 +90,137 @@ namespace rog_map {
             double t_when_step_x_, t_when_step_y_, t_when_step_z_;
             int step_num_{0};
         };
+
+        /* Walks a batch of rays with exactly the same traversal as RayCaster, but keeps
+         * kLaneNum rays in flight. The axis selection and the t update of all lanes are
+         * done together, and a lane is refilled with the next ray as soon as its ray
+         * terminates. The cells are reported as integer global index, so no position is
+         * computed during the traversal.
+         *
+         * With ROG_MAP_USE_AVX2 the lane update is also compiled for AVX2, and is chosen at
+         * runtime when the CPU supports it, so the same binary runs on CPUs without AVX2.
+         * */
+        class BatchRayCaster {
+        public:
+            typedef std::shared_ptr<BatchRayCaster> Ptr;
+
+            static constexpr int kLaneNum = 4;
+
+            BatchRayCaster() = default;
+
+            ~BatchRayCaster() = default;
+
+            void setResolution(const double &resolution);
+
+            /* Whether the AVX2 lane update is compiled and supported by this CPU */
+            static bool avx2Supported();
+
+            /* Use the AVX2 lane update if it is supported, it is on by default. The scalar
+             * one gives the same cells, turning AVX2 off is for checking that.
+             * */
+            void setAVX2Enabled(const bool &en) {
+                use_avx2_ = en && avx2Supported();
+            }
+
+            bool isAVX2Enabled() const {
+                return use_avx2_;
+            }
+
+            /* Walk the rays [first, starts.size()) with the given stride. For every cell
+             * passed by ray i (end cell excluded, same as RayCaster::step), calls
+             * visit(i, id_g), the ray is stopped when visit returns false.
+             * */
+            template<typename Visitor>
+            void walk(const vec_Vec3f &starts, const vec_Vec3f &ends, Visitor &&visit,
+                      const int &first = 0, const int &stride = 1);
+
+        private:
+            RayCaster setup_;
+            alignas(32) double t_to_bound_[3][kLaneNum];
+            alignas(32) double t_when_step_[3][kLaneNum];
+            alignas(32) int64_t step_mask_[kLaneNum];
+            int cur_id_[3][kLaneNum];
+            int end_id_[3][kLaneNum];
+            int expand_dir_[3][kLaneNum];
+            int ray_id_[kLaneNum];
+            bool use_avx2_{avx2Supported()};
+
+            bool loadRay(const int &lane, const int &ray_id,
+                         const Eigen::Vector3d &start, const Eigen::Vector3d &end);
+
+            void stepLanes();
+
+            void stepLanesScalar();
+
+            void stepLanesAVX2();
+
+#ifdef RAYCASTER_DEBUG
+            std::vector<Eigen::Vector3i> visited_[kLaneNum];
+
+            void checkRay(const Eigen::Vector3d &start, const Eigen::Vector3d &end,
+                          const std::vector<Eigen::Vector3i> &visited) const;
+#endif
+        };
+
+        template<typename Visitor>
+        void BatchRayCaster::walk(const vec_Vec3f &starts, const vec_Vec3f &ends, Visitor &&visit,
+                                  const int &first, const int &stride) {
+            const int ray_num = static_cast<int>(starts.size());
+            int next_ray = first;
+            // load the next valid ray into the lane, return false if no ray left
+            auto refill = [&](const int &lane) {
+                while (next_ray < ray_num) {
+                    const int i = next_ray;
+                    next_ray += stride;
+                    if (loadRay(lane, i, starts[i], ends[i])) {
+                        return true;
+                    }
+                }
+                ray_id_[lane] = -1;
+                return false;
+            };
+
+            int active_num = 0;
+            for (int lane = 0; lane < kLaneNum; lane++) {
+                active_num += refill(lane);
+            }
+
+            Eigen::Vector3i id_g;
+            while (active_num > 0) {
+                // 1) report the current cell of each lane, lanes whose ray ends are refilled
+                for (int lane = 0; lane < kLaneNum; lane++) {
+                    step_mask_[lane] = 0;
+                    const int i = ray_id_[lane];
+                    if (i < 0) {
+                        continue;
+                    }
+                    id_g.x() = cur_id_[0][lane];
+                    id_g.y() = cur_id_[1][lane];
+                    id_g.z() = cur_id_[2][lane];
+                    bool ray_end = id_g.x() == end_id_[0][lane] &&
+                                   id_g.y() == end_id_[1][lane] &&
+                                   id_g.z() == end_id_[2][lane];
+                    if (!ray_end) {
+                        ray_end = !visit(i, id_g);
+#ifdef RAYCASTER_DEBUG
+                        visited_[lane].push_back(id_g);
+#endif
+                    }
+                    if (ray_end) {
+#ifdef RAYCASTER_DEBUG
+                        checkRay(starts[i], ends[i], visited_[lane]);
+                        visited_[lane].clear();
+#endif
+                        // the new ray reports its first cell in the next round
+                        active_num -= !refill(lane);
+                        continue;
+                    }
+                    step_mask_[lane] = -1;
+                }
+                // 2) advance the lanes that reported a cell
+                stepLanes();
+            }
+        }
     }
 }
 
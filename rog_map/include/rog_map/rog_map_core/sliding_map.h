@@ -46,7 +46,8 @@ namespace rog_map {
                    const double &resolution,
                    const bool &map_sliding_en,
                    const double &sliding_thresh,
-                   const Vec3f &fix_map_origin);
+                   const Vec3f &fix_map_origin,
+                   const bool &brick_layout_en = false);
 
         SlidingMap() = default;
 
@@ -56,7 +57,8 @@ namespace rog_map {
                   const double &resolution,
                   const bool &map_sliding_en,
                   const double &sliding_thresh,
-                  const Vec3f &fix_map_origin);
+                  const Vec3f &fix_map_origin,
+                  const bool &brick_layout_en = false);
 
         void printMapInformation();
 
@@ -67,6 +69,14 @@ namespace rog_map {
         bool insideLocalMap(const Vec3i &id_g) const;
 
     protected:
+        /* In the brick layout, the cells are stored in bricks of 8x8x8 cells, a brick is
+         * contiguous in memory and the bricks are stored in x-major order. The local index
+         * and the ring buffer of each axis are the same as the flat layout, only the hash changes.
+         * */
+        static constexpr int BRICK_BIT = 3;
+        static constexpr int BRICK_SIZE = 1 << BRICK_BIT;
+        static constexpr int BRICK_MASK = BRICK_SIZE - 1;
+
         struct SlidingConfig {
             double resolution{0};
             double resolution_inv{0};
@@ -79,7 +89,10 @@ namespace rog_map {
             int virtual_ceil_height_id_g{0};
             int virtual_ground_height_id_g{0};
             int safe_margin_i{0};
+            /* number of memory cells, padded to whole bricks in the brick layout */
             int map_vox_num{0};
+            bool brick_layout_en{false};
+            Vec3i brick_num_i{};
         } sc_;
 
         Vec3f local_map_origin_d_, local_map_bound_min_d_, local_map_bound_max_d_;
@@ -97,11 +110,152 @@ namespace rog_map {
 
         virtual void resetCell(const int & hash_id) = 0;
 
+        /* Reset all cells of a slab leaving the local map in one call, slab_id_g is the
+         * global index of each cell before sliding. The default implementation calls
+         * resetCell for each cell, derived maps override it to batch the updates of the
+         * layers depending on them.
+         * */
+        virtual void resetSlab(const vector<int> &slab_hash, const vec_E<Vec3i> &slab_id_g);
+
+        /* In the brick layout, the bricks whose cells all leave the local map are reset as a
+         * whole, their cells are not passed to resetSlab. The default implementation calls
+         * resetCell for each cell, derived maps override it to fill the brick memory in bulk.
+         * */
+        virtual void resetBricks(const vector<int> &brick_hash);
+
         void clearMemoryOutOfMap(const vector<int> &clear_id, const int &i);
 
 
         int getLocalIndexHash(const Vec3i &id_in) const;
 
+        /* In both layouts, the hash of a cell is the sum of one term per axis of its global
+         * index, so the hashes of a window of cells are sums of three table lookups. Returns -1
+         * if id_g is outside the local map along the axis.
+         * */
+        int getAxisHashTerm(const int &id_g, const int &axis) const;
+
+        /* Call f(hash_id) for the cells of a brick in memory order, the padding cells beyond
+         * the local map are skipped.
+         * */
+        template<class F>
+        void forEachCellInBrick(const int &brick_hash, F &&f) const {
+            const int brick_yz = sc_.brick_num_i(1) * sc_.brick_num_i(2);
+            const Vec3i min_id = Vec3i(brick_hash / brick_yz, (brick_hash % brick_yz) / sc_.brick_num_i(2),
+                                       brick_hash % sc_.brick_num_i(2)) * BRICK_SIZE;
+            const Vec3i len = (sc_.map_size_i - min_id).cwiseMin(BRICK_SIZE);
+            const int brick_start = brick_hash << (3 * BRICK_BIT);
+            for (int x = 0; x < len.x(); x++) {
+                for (int y = 0; y < len.y(); y++) {
+                    const int row_start = brick_start | (x << (2 * BRICK_BIT)) | (y << BRICK_BIT);
+                    for (int z = 0; z < len.z(); z++) {
+                        f(row_start | z);
+                    }
+                }
+            }
+        }
+
+        /* Call f(hash_id) for all cells of the local map in memory order, without the padding
+         * cells of the brick layout.
+         * */
+        template<class F>
+        void forEachCellHash(F &&f) const {
+            if (sc_.brick_layout_en) {
+                const int brick_num = sc_.brick_num_i.prod();
+                for (int brick_hash = 0; brick_hash < brick_num; brick_hash++) {
+                    forEachCellInBrick(brick_hash, f);
+                }
+                return;
+            }
+            for (int hash_id = 0; hash_id < sc_.map_vox_num; hash_id++) {
+                f(hash_id);
+            }
+        }
+
+        /* Call f(hash_id) for the cells from id_g to id_g + (0, 0, len - 1) in order, which
+         * should be inside the local map. In the flat layout a run along z is contiguous
+         * in memory except at the wrap of the ring buffer, so only one hash is computed.
+         * */
+        template<class F>
+        void forEachHashInZRun(const Vec3i &id_g, const int &len, F &&f) const {
+            Vec3i id_l;
+            globalIndexToLocalIndex(id_g, id_l);
+            if (sc_.brick_layout_en) {
+                for (int k = 0; k < len; k++) {
+                    f(getLocalIndexHash(id_l));
+                    if (++id_l.z() > sc_.half_map_size_i.z()) {
+                        id_l.z() = -sc_.half_map_size_i.z();
+                    }
+                }
+                return;
+            }
+            int z = id_l.z() + sc_.half_map_size_i.z();
+            id_l.z() = -sc_.half_map_size_i.z();
+            const int row_hash = getLocalIndexHash(id_l);
+            for (int k = 0; k < len; k++) {
+                f(row_hash + z);
+                if (++z == sc_.map_size_i.z()) {
+                    z = 0;
+                }
+            }
+        }
+
+        /* Call f(hash_start, piece_len, k_start) for the pieces of the z-run from id_g of len
+         * cells that are contiguous in memory, at most two in the flat layout and one per brick
+         * in the brick layout. k_start is the offset of the piece in the run.
+         * */
+        template<class F>
+        void forEachZRunPiece(const Vec3i &id_g, const int &len, F &&f) const {
+            Vec3i id_l;
+            globalIndexToLocalIndex(id_g, id_l);
+            int z = id_l.z() + sc_.half_map_size_i.z();
+            if (sc_.brick_layout_en) {
+                for (int k = 0; k < len;) {
+                    id_l.z() = z - sc_.half_map_size_i.z();
+                    const int piece_len = std::min({len - k, BRICK_SIZE - (z & BRICK_MASK), sc_.map_size_i.z() - z});
+                    f(getLocalIndexHash(id_l), piece_len, k);
+                    k += piece_len;
+                    z = (z + piece_len) % sc_.map_size_i.z();
+                }
+                return;
+            }
+            id_l.z() = -sc_.half_map_size_i.z();
+            const int row_hash = getLocalIndexHash(id_l);
+            const int first_len = std::min(len, sc_.map_size_i.z() - z);
+            f(row_hash + z, first_len, 0);
+            if (first_len < len) {
+                f(row_hash, len - first_len, first_len);
+            }
+        }
+
+        /* Call f(k) for the offsets k in [0, len) of the z-run from id_g whose bit is set in
+         * bits, a bitset indexed by hash id. The pieces of the run are scanned 64 cells per word.
+         * */
+        template<class F>
+        void forEachSetBitInZRun(const std::vector<uint64_t> &bits, const Vec3i &id_g, const int &len, F &&f) const {
+            forEachZRunPiece(id_g, len, [&](const int &hash_start, const int &piece_len, const int &k_start) {
+                const int hash_end = hash_start + piece_len;
+                for (int h = hash_start; h < hash_end;) {
+                    const int bit = h & 63;
+                    const int num = std::min(64 - bit, hash_end - h);
+                    uint64_t word = bits[h >> 6] >> bit;
+                    if (num < 64) {
+                        word &= (uint64_t(1) << num) - 1;
+                    }
+                    while (word) {
+                        f(k_start + h - hash_start + __builtin_ctzll(word));
+                        word &= word - 1;
+                    }
+                    h += num;
+                }
+            });
+        }
+
+        /* Or the bits of the z-run from id_g of len cells, a bitset indexed by hash id, into
+         * the bits [out_start, out_start + len) of out.
+         * */
+        void copyZRunBits(const std::vector<uint64_t> &bits, const Vec3i &id_g, const int &len,
+                          uint64_t *out, const int &out_start) const;
+
         void posToGlobalIndex(const Vec3f &pos, Vec3i &id) const;
 
         void posToGlobalIndex(const double &pos, int &id) const;
@@ -113,6 +267,8 @@ namespace rog_map {
         /* Only used in clearMemoryOutOfMap and */
         void localIndexToGlobalIndex(const Vec3i &id_l, Vec3i &id_g) const;
 
+        int localIndexToGlobalIndex(const int &id_l, const int &i) const;
+
         void localIndexToPos(const Vec3i &id_l, Vec3f &pos) const;
 
         void hashIdToLocalIndex(const int &hash_id,
@@ -135,6 +291,10 @@ namespace rog_map {
     private:
         bool had_been_initialized{false};
 
+        vector<int> slab_hash_;
+        vec_E<Vec3i> slab_id_g_;
+        vector<int> slab_brick_hash_;
+
     };
 
 
@@ -0,0 +1,76 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rog_map {
+
+    /* A fixed-size worker pool for the data-parallel stages of ROG-Map.
+     * parallelFor() blocks the caller until all tasks are done, and the
+     * caller thread also works on the tasks, so a pool of size N uses
+     * N-1 background threads. A pool of size 1 runs everything inline.
+     * */
+    class ThreadPool {
+    public:
+        typedef std::shared_ptr<ThreadPool> Ptr;
+
+        explicit ThreadPool(const int &thread_num);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        int size() const {
+            return thread_num_;
+        }
+
+        /* Run f(task_id) for task_id in [0, task_num) and wait for all of them. */
+        void parallelFor(const int &task_num, const std::function<void(const int &)> &f);
+
+    private:
+        void workerLoop();
+
+        void runTasks();
+
+        int thread_num_{1};
+        std::vector<std::thread> workers_;
+
+        std::mutex mtx_;
+        std::condition_variable job_cv_, done_cv_;
+        const std::function<void(const int &)> *job_{nullptr};
+        int task_num_{0};
+        int next_task_{0};
+        int finished_task_{0};
+        long job_id_{0};
+        bool stop_{false};
+    };
+}
@@ -0,0 +1,160 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <rog_map/clearance_map.h>
+
+using namespace color_text;
+using namespace super_utils;
+
+namespace rog_map {
+
+    void ClearanceMap::initClearanceMap(const Vec3i &half_prob_map_size_i, const double &resolution,
+                                        const int &max_step, const bool &map_sliding_en,
+                                        const double &sliding_thresh, const Vec3f &fix_map_origin,
+                                        const double &unk_thresh, const bool &brick_layout_en) {
+        if (had_been_initialized) {
+            throw std::runtime_error(" -- [ClearanceMap]: init can only be called once!");
+        }
+        had_been_initialized = true;
+        if (max_step < 1) {
+            throw std::invalid_argument(" -- [ClearanceMap]: max_step should be positive!");
+        }
+        max_step_ = max_step;
+        // The margin of max_step keeps the ball around every prob map cell inside the map
+        initCounterMap(half_prob_map_size_i,
+                       resolution,
+                       resolution,
+                       max_step,
+                       map_sliding_en,
+                       sliding_thresh,
+                       fix_map_origin,
+                       unk_thresh,
+                       brick_layout_en);
+
+        /* 1) The shells are the distinct squared distances within max_step */
+        const int sqr_cap = max_step * max_step;
+        std::vector<int> shell_of_sqr(sqr_cap + 1, -1);
+        std::vector<int> shell_size(sqr_cap + 1, 0);
+        for (int dx = -max_step; dx <= max_step; dx++) {
+            for (int dy = -max_step; dy <= max_step; dy++) {
+                for (int dz = -max_step; dz <= max_step; dz++) {
+                    const int sqr = dx * dx + dy * dy + dz * dz;
+                    if (sqr <= sqr_cap) {
+                        shell_size[sqr]++;
+                    }
+                }
+            }
+        }
+        shell_sqr_.clear();
+        for (int sqr = 0; sqr <= sqr_cap; sqr++) {
+            if (shell_size[sqr] == 0) {
+                continue;
+            }
+            // The counter of a shell is at most its size
+            if (shell_size[sqr] > std::numeric_limits<uint8_t>::max()) {
+                throw std::invalid_argument(" -- [ClearanceMap]: max_step is too large for the shell counters!");
+            }
+            shell_of_sqr[sqr] = static_cast<int>(shell_sqr_.size());
+            shell_sqr_.push_back(sqr);
+        }
+        shell_num_ = static_cast<int>(shell_sqr_.size());
+        shell_sqr_.push_back(sqr_cap + 1);
+
+        /* 2) The neighbors in the ball, grouped in runs along z */
+        neighbor_runs_.clear();
+        run_shells_.clear();
+        for (int dx = -max_step; dx <= max_step; dx++) {
+            for (int dy = -max_step; dy <= max_step; dy++) {
+                const int sqr_xy = dx * dx + dy * dy;
+                if (sqr_xy > sqr_cap) {
+                    continue;
+                }
+                const int dz_max = static_cast<int>(std::floor(std::sqrt(sqr_cap - sqr_xy)));
+                NeighborRun run;
+                run.start = Vec3i(dx, dy, -dz_max);
+                run.len = 2 * dz_max + 1;
+                run.shell_offset = static_cast<int>(run_shells_.size());
+                neighbor_runs_.push_back(run);
+                for (int dz = -dz_max; dz <= dz_max; dz++) {
+                    run_shells_.push_back(static_cast<uint8_t>(shell_of_sqr[sqr_xy + dz * dz]));
+                }
+            }
+        }
+
+        stride_ = shell_num_ + 1;
+        cells_.resize(static_cast<size_t>(sc_.map_vox_num) * stride_);
+        resetLocalMap();
+        std::cout << GREEN << " -- [ClearanceMap] Init successfully -- ." << RESET << std::endl;
+        std::cout << GREEN << " -- [ClearanceMap] max_step: " << max_step_ << ", shell_num: " << shell_num_
+                  << RESET << std::endl;
+        printMapInformation();
+    }
+
+    void ClearanceMap::resetLocalMap() {
+        std::cout << YELLOW << " -- [Clr-Map] Clear all local map." << RESET << std::endl;
+        std::fill(md_.unknown_cnt.begin(), md_.unknown_cnt.end(), md_.sub_grid_num);
+        std::fill(md_.occupied_cnt.begin(), md_.occupied_cnt.end(), 0);
+        std::fill(cells_.begin(), cells_.end(), 0);
+        for (size_t i = 0; i < cells_.size(); i += stride_) {
+            cells_[i] = static_cast<uint8_t>(shell_num_);
+        }
+    }
+
+    void ClearanceMap::triggerJumpingEdge(const Vec3i &id_g, const GridType &from_type, const GridType &to_type) {
+        const bool is_add = to_type == OCCUPIED;
+        if (is_add == (from_type == OCCUPIED)) {
+            return;
+        }
+        /* The cells leaving the map had all their occupied neighbors removed by the prob map
+         * before this map slides, so the counters never need a reset on sliding.
+         * */
+        for (const auto &run: neighbor_runs_) {
+            const Vec3i id_shift = id_g + run.start;
+#ifdef COUNTER_MAP_DEBUG
+            if (!insideLocalMap(id_shift) || !insideLocalMap(Vec3i(id_shift + Vec3i(0, 0, run.len - 1)))) {
+                throw std::runtime_error(" -- [CM] clearance update out of map.");
+            }
+#endif
+            const uint8_t *shell_it = &run_shells_[run.shell_offset];
+            forEachHashInZRun(id_shift, run.len, [&](const int &addr) {
+                uint8_t *cell = &cells_[static_cast<size_t>(addr) * stride_];
+                const uint8_t shell = *shell_it++;
+                uint8_t &cnt = cell[1 + shell];
+                if (is_add) {
+                    if (cnt++ == 0 && shell < cell[0]) {
+                        cell[0] = shell;
+                    }
+                    return;
+                }
+                if (--cnt == 0 && shell == cell[0]) {
+                    // Raise the clearance to the next non-empty shell
+                    int next = shell + 1;
+                    while (next < shell_num_ && cell[1 + next] == 0) {
+                        next++;
+                    }
+                    cell[0] = static_cast<uint8_t>(next);
+                }
+            });
+        }
+    }
+}
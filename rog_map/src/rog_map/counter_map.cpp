@@ -36,7 +36,8 @@ namespace rog_map {
             const bool &map_sliding_en,
             const double &sliding_thresh,
             const Vec3f &fix_map_origin,
-            const double &unk_thresh) {
+            const double &unk_thresh,
+            const bool &brick_layout_en) {
 
         if (had_been_initialized) {
             throw std::runtime_error(" -- [CounterMap]: init can only be called once!");
@@ -76,14 +77,16 @@ namespace rog_map {
                                         + (inflation_step + 1) * Vec3i::Ones();
 
         /* 3) Initialize the SlidingMap */
-        initSlidingMap(half_counter_map_size_i, counter_map_resolution, map_sliding_en, sliding_thresh, fix_map_origin);
+        initSlidingMap(half_counter_map_size_i, counter_map_resolution, map_sliding_en, sliding_thresh, fix_map_origin,
+                       brick_layout_en);
 
-        int map_size = sc_.map_size_i.prod();
+        int map_size = sc_.map_vox_num;
         md_.sub_grid_num = pow(std::round(counter_map_resolution / prob_map_resolution), 3);
         md_.unk_thresh = ceil(unk_thresh * md_.sub_grid_num);
         md_.unk_thresh = std::min(std::max(1, md_.unk_thresh), md_.sub_grid_num);
         md_.unknown_cnt.resize(map_size, md_.sub_grid_num);
         md_.occupied_cnt.resize(map_size, 0);
+        bd_.stamp.resize(map_size, 0);
 
         resetLocalMap();
         std::cout << GREEN << " -- [CounterMap] Init successfully -- ." << RESET << std::endl;
@@ -115,6 +118,63 @@ namespace rog_map {
         const int addr = getHashIndexFromGlobalIndex(id_g);
 
         GridType counter_cell_from_type = getGridType(addr);
+        applyGridCounter(addr, from_type, to_type);
+        GridType counter_cell_to_type = getGridType(addr);
+
+        if (counter_cell_from_type != counter_cell_to_type) {
+            triggerJumpingEdge(id_g, counter_cell_from_type, counter_cell_to_type);
+        }
+    }
+
+    void CounterMap::updateGridCounterBatch(const std::vector<GridCounterUpdate> &updates) {
+        TimeConsuming update_t("updateGridCounterBatch", false);
+        if (updates.empty()) {
+            return;
+        }
+        map_empty_ = false;
+        if (++bd_.generation == 0) {
+            std::fill(bd_.stamp.begin(), bd_.stamp.end(), 0);
+            bd_.generation = 1;
+        }
+        bd_.touched.clear();
+
+        /* 1) Update all counters, and record the type of each touched cell before the batch */
+        Vec3i id_g;
+        for (const auto &up: updates) {
+            posToGlobalIndex(up.pos, id_g);
+#ifdef COUNTER_MAP_DEBUG
+            if (!insideLocalMap(id_g)) {
+                throw std::runtime_error(" -- [InfMap]: Update a counter which is not inside the local map.");
+            }
+
+            if (up.from_type == up.to_type) {
+                throw std::runtime_error(" -- [InfMap]: From type is equal to to type.");
+            }
+#endif
+            const int addr = getHashIndexFromGlobalIndex(id_g);
+            if (bd_.stamp[addr] != bd_.generation) {
+                bd_.stamp[addr] = bd_.generation;
+                bd_.touched.push_back({addr, id_g, getGridType(addr)});
+            }
+            applyGridCounter(addr, up.from_type, up.to_type);
+        }
+
+        /* 2) Trigger the jumping edges, once per touched cell, in the memory order of the cells */
+        std::sort(bd_.touched.begin(), bd_.touched.end(),
+                  [](const BatchData::TouchedCell &a, const BatchData::TouchedCell &b) {
+                      return a.hash_id < b.hash_id;
+                  });
+        bd_.edges.clear();
+        for (const auto &cell: bd_.touched) {
+            const GridType counter_cell_to_type = getGridType(cell.hash_id);
+            if (cell.from_type != counter_cell_to_type) {
+                bd_.edges.push_back({cell.id_g, cell.from_type, counter_cell_to_type});
+            }
+        }
+        triggerJumpingEdgeBatch(bd_.edges);
+    }
+
+    void CounterMap::applyGridCounter(const int &addr, const GridType &from_type, const GridType &to_type) {
         /* Update the counter map */
         if (from_type == GridType::OCCUPIED) {
             md_.occupied_cnt[addr] -= 1;
@@ -142,12 +202,6 @@ namespace rog_map {
             throw std::runtime_error(" -- [CouterMap]: Unknown counter is out of range.");
         }
 #endif
-
-        GridType counter_cell_to_type = getGridType(addr);
-
-        if (counter_cell_from_type != counter_cell_to_type) {
-            triggerJumpingEdge(id_g, counter_cell_from_type, counter_cell_to_type);
-        }
     }
 
     bool CounterMap::isUnknown(const Vec3i &id_g) const {
@@ -31,7 +31,9 @@ namespace rog_map {
     void ESDFMap::initESDFMap(const rog_map::Vec3i &half_prob_map_size_i, const double &prob_map_resolution,
                               const double &temp_counter_map_resolution, const rog_map::Vec3f &local_update_box,
                               const bool &map_sliding_en, const double &sliding_thresh,
-                              const rog_map::Vec3f &fix_map_origin, const double &unk_thresh) {
+                              const rog_map::Vec3f &fix_map_origin, const double &unk_thresh,
+                              const bool &incremental_update_en, const double &max_dist,
+                              const int &thread_num, const double &fallback_ratio) {
 
         if (had_been_initialized) {
             throw std::runtime_error(" -- [ESDFMap]: init can only be called once!");
@@ -46,12 +48,32 @@ namespace rog_map {
                        fix_map_origin,
                        unk_thresh);
 
+        // The incremental update falls back to the full update, so both keep the EDT buffers
         distance_buffer.resize(sc_.map_vox_num);
         tmp_buffer1_.resize(sc_.map_vox_num);
         tmp_buffer2_.resize(sc_.map_vox_num);
+        thread_pool_ = std::make_shared<ThreadPool>(thread_num);
         posToGlobalIndex(local_update_box, half_local_update_box_i_);
         half_local_update_box_i_ /= 2;
 
+        inc_.enable = incremental_update_en;
+        if (inc_.enable) {
+            inc_.max_dist = max_dist;
+            inc_.fallback_ratio = fallback_ratio;
+            const int max_step = static_cast<int>(ceil(max_dist / sc_.resolution));
+            inc_.sqr_dist_cap = max_step * max_step;
+            inc_.box_size_i = 2 * half_local_update_box_i_ + Vec3i::Ones();
+            const int box_vox_num = inc_.box_size_i.prod();
+            for (auto *field: {&inc_.pos, &inc_.neg}) {
+                field->sqr_dist.resize(box_vox_num);
+                field->source.resize(box_vox_num);
+                field->is_source.resize(box_vox_num);
+                field->to_raise.resize(box_vox_num);
+            }
+            inc_.neg.occupied_only = true;
+            inc_.occupied.resize(box_vox_num);
+        }
+
         resetLocalMap();
         std::cout << GREEN << " -- [ESDFMap] Init successfully -- ." << RESET << std::endl;
         printMapInformation();
@@ -67,6 +89,20 @@ namespace rog_map {
         std::cout << YELLOW << " -- [ESDFMap] Clear all local map." << RESET << std::endl;
         std::fill(md_.unknown_cnt.begin(), md_.unknown_cnt.end(), md_.sub_grid_num);
         std::fill(md_.occupied_cnt.begin(), md_.occupied_cnt.end(), 0);
+        if (inc_.enable) {
+            resetBrushfire(inc_.pos);
+            resetBrushfire(inc_.neg);
+            std::fill(inc_.occupied.begin(), inc_.occupied.end(), 0);
+            inc_.box_min = inc_.valid_min = Vec3i::Zero();
+            inc_.box_max = inc_.valid_max = -Vec3i::Ones();
+            inc_.changed.clear();
+            inc_.stale = true;
+            inc_.slow_num = 0;
+            inc_.last_min = Vec3i::Zero();
+            inc_.last_max = -Vec3i::Ones();
+            inc_.edge_num = 0;
+            std::fill(distance_buffer.begin(), distance_buffer.end(), inc_.max_dist);
+        }
     }
 
     double ESDFMap::getDistance(const rog_map::Vec3f &pos) const {
@@ -79,6 +115,14 @@ namespace rog_map {
 
     void ESDFMap::updateESDF3D(const rog_map::Vec3f &cur_odom) {
         std::lock_guard<std::mutex> lck(update_esdf_mtx);
+        if (inc_.enable) {
+            updateESDFIncremental(cur_odom);
+            return;
+        }
+        updateESDFFull(cur_odom);
+    }
+
+    void ESDFMap::updateESDFFull(const rog_map::Vec3f &cur_odom) {
         using namespace std;
         TimeConsuming up_t("updateESDF3D", false);
         Vec3i id_l, cur_odom_i;
@@ -102,7 +146,7 @@ namespace rog_map {
         min_esdf = update_local_map_min_i_ - local_map_bound_min_i_;
         max_esdf = update_local_map_max_i_ - local_map_bound_min_i_;
 
-        for (int x = min_esdf[0]; x <= max_esdf[0]; x++) {
+        parallelForRange(min_esdf[0], max_esdf[0], [&](const int &x) {
             for (int y = min_esdf[1]; y <= max_esdf[1]; y++) {
                 fillESDF(
                         [&](int z) {
@@ -116,13 +160,13 @@ namespace rog_map {
                         [&](int z, double val) {
                             tmp_buffer1_[getEsdfLocalIndexHash(
                                     x > mem_end[0] ? x + id_l[0] - sc_.map_size_i[0] : x + id_l[0],
-                                    y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1], z)] = val;
+                                    y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1], z)] = toESDFValue(val);
                         },
                         min_esdf[2], max_esdf[2], 2, id_l[2]);
             }
-        }
+        });
 
-        for (int x = min_esdf[0]; x <= max_esdf[0]; x++) {
+        parallelForRange(min_esdf[0], max_esdf[0], [&](const int &x) {
             for (int z = min_esdf[2]; z <= max_esdf[2]; z++) {
                 fillESDF([&](int y) {
                              return tmp_buffer1_[getEsdfLocalIndexHash(
@@ -134,14 +178,14 @@ namespace rog_map {
                              tmp_buffer2_[getEsdfLocalIndexHash(
                                      x > mem_end[0] ? x + id_l[0] - sc_.map_size_i[0] : x + id_l[0],
                                      y,
-                                     z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2])] = val;
+                                     z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2])] = toESDFValue(val);
                          },
                          min_esdf[1],
                          max_esdf[1], 1, id_l[1]);
             }
-        }
+        });
 
-        for (int y = min_esdf[1]; y <= max_esdf[1]; y++) {
+        parallelForRange(min_esdf[1], max_esdf[1], [&](const int &y) {
             for (int z = min_esdf[2]; z <= max_esdf[2]; z++) {
                 fillESDF([&](int x) {
                              return tmp_buffer2_[getEsdfLocalIndexHash(
@@ -156,13 +200,13 @@ namespace rog_map {
                                      y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1],
                                      z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2]
                              )] =
-                                     sc_.resolution * std::sqrt(val);
+                                     toESDFValue(sc_.resolution * std::sqrt(val));
                          },
                          min_esdf[0], max_esdf[0], 0, id_l[0]);
             }
-        }
+        });
 
-        for (int x = min_esdf[0]; x <= max_esdf[0]; x++) {
+        parallelForRange(min_esdf[0], max_esdf[0], [&](const int &x) {
             for (int y = min_esdf[1]; y <= max_esdf[1]; y++) {
                 fillESDF(
                         [&](int z) {
@@ -175,13 +219,13 @@ namespace rog_map {
                         [&](int z, double val) {
                             tmp_buffer1_[getEsdfLocalIndexHash(
                                     x > mem_end[0] ? x + id_l[0] - sc_.map_size_i[0] : x + id_l[0],
-                                    y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1], z)] = val;
+                                    y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1], z)] = toESDFValue(val);
                         },
                         min_esdf[2], max_esdf[2], 2, id_l[2]);
             }
-        }
+        });
 
-        for (int x = min_esdf[0]; x <= max_esdf[0]; x++) {
+        parallelForRange(min_esdf[0], max_esdf[0], [&](const int &x) {
             for (int z = min_esdf[2]; z <= max_esdf[2]; z++) {
                 fillESDF([&](int y) {
                              return tmp_buffer1_[getEsdfLocalIndexHash(
@@ -193,14 +237,14 @@ namespace rog_map {
                              tmp_buffer2_[getEsdfLocalIndexHash(
                                      x > mem_end[0] ? x + id_l[0] - sc_.map_size_i[0] : x + id_l[0],
                                      y,
-                                     z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2])] = val;
+                                     z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2])] = toESDFValue(val);
                          },
                          min_esdf[1],
                          max_esdf[1], 1, id_l[1]);
             }
-        }
+        });
 
-        for (int y = min_esdf[1]; y <= max_esdf[1]; y++) {
+        parallelForRange(min_esdf[1], max_esdf[1], [&](const int &y) {
             for (int z = min_esdf[2]; z <= max_esdf[2]; z++) {
                 fillESDF([&](int x) {
                              return tmp_buffer2_[getEsdfLocalIndexHash(
@@ -215,15 +259,15 @@ namespace rog_map {
                                      y > mem_end[1] ? y + id_l[1] - sc_.map_size_i[1] : y + id_l[1],
                                      z > mem_end[2] ? z + id_l[2] - sc_.map_size_i[2] : z + id_l[2]
                              )] =
-                                     sc_.resolution * std::sqrt(val);
+                                     toESDFValue(sc_.resolution * std::sqrt(val));
                          },
                          min_esdf[0], max_esdf[0], 0, id_l[0]);
             }
-        }
+        });
 
 
         /* ========== combine pos and neg DT ========== */
-        for (int x = min_esdf(0); x <= max_esdf(0); ++x)
+        parallelForRange(min_esdf(0), max_esdf(0), [&](const int &x) {
             for (int y = min_esdf(1); y <= max_esdf(1); ++y)
                 for (int z = min_esdf(2); z <= max_esdf(2); ++z) {
 
@@ -234,6 +278,7 @@ namespace rog_map {
                     }
 
                 }
+        });
 
         double dt = up_t.stop();
         if(dt > 0.1) {
@@ -248,9 +293,356 @@ namespace rog_map {
 #endif
     }
 
-    void ESDFMap::resetOneCell(const int &hash_id) {
+    int ESDFMap::getBoxHash(const Vec3i &id_g) const {
+        int hash_id = 0;
+        for (int i = 0; i < 3; i++) {
+            int id = id_g(i) % inc_.box_size_i(i);
+            id += id < 0 ? inc_.box_size_i(i) : 0;
+            hash_id = hash_id * inc_.box_size_i(i) + id;
+        }
+        return hash_id;
     }
 
+    template<typename F>
+    void ESDFMap::forEachBoxNeighbor(const Vec3i &id_g, F &&f) const {
+        /* The box index of a neighbor is the one of id_g plus the offset, wrapped at
+         * the box size, which saves a modulo per neighbor */
+        Vec3i id_b, nei;
+        for (int i = 0; i < 3; i++) {
+            id_b(i) = id_g(i) % inc_.box_size_i(i);
+            id_b(i) += id_b(i) < 0 ? inc_.box_size_i(i) : 0;
+        }
+        const auto wrap = [this](const int &b, const int &i) {
+            return b < 0 ? b + inc_.box_size_i(i) : b >= inc_.box_size_i(i) ? b - inc_.box_size_i(i) : b;
+        };
+        for (int dx = -1; dx <= 1; dx++) {
+            nei.x() = id_g.x() + dx;
+            if (nei.x() < inc_.box_min.x() || nei.x() > inc_.box_max.x()) {
+                continue;
+            }
+            const int hash_x = wrap(id_b.x() + dx, 0) * inc_.box_size_i.y();
+            for (int dy = -1; dy <= 1; dy++) {
+                nei.y() = id_g.y() + dy;
+                if (nei.y() < inc_.box_min.y() || nei.y() > inc_.box_max.y()) {
+                    continue;
+                }
+                const int hash_xy = (hash_x + wrap(id_b.y() + dy, 1)) * inc_.box_size_i.z();
+                for (int dz = -1; dz <= 1; dz++) {
+                    nei.z() = id_g.z() + dz;
+                    if (nei.z() < inc_.box_min.z() || nei.z() > inc_.box_max.z()) {
+                        continue;
+                    }
+                    f(nei, hash_xy + wrap(id_b.z() + dz, 2));
+                }
+            }
+        }
+    }
+
+    void ESDFMap::triggerJumpingEdge(const rog_map::Vec3i &id_g, const rog_map::GridType &from_type,
+                                     const rog_map::GridType &to_type) {
+        if (!inc_.enable || (from_type == OCCUPIED) == (to_type == OCCUPIED)) {
+            return;
+        }
+        if (insideBox(id_g, inc_.last_min, inc_.last_max)) {
+            inc_.edge_num++;
+        }
+        if (!insideBox(id_g, inc_.valid_min, inc_.valid_max)) {
+            return;
+        }
+        inc_.occupied[getBoxHash(id_g)] = to_type == OCCUPIED;
+        if (to_type == OCCUPIED) {
+            setBrushfireSource(inc_.pos, id_g);
+            removeBrushfireSource(inc_.neg, id_g);
+        } else {
+            removeBrushfireSource(inc_.pos, id_g);
+            setBrushfireSource(inc_.neg, id_g);
+        }
+    }
+
+    void ESDFMap::resetBrushfire(BrushfireField &field) {
+        std::fill(field.sqr_dist.begin(), field.sqr_dist.end(), std::numeric_limits<int>::max());
+        std::fill(field.is_source.begin(), field.is_source.end(), 0);
+        std::fill(field.to_raise.begin(), field.to_raise.end(), 0);
+        field.open.assign(inc_.sqr_dist_cap + 1, {});
+        field.open_min = 0;
+        field.open_size = 0;
+    }
+
+    void ESDFMap::clearBoxCell(const int &box_hash) {
+        for (auto *field: {&inc_.pos, &inc_.neg}) {
+            field->sqr_dist[box_hash] = std::numeric_limits<int>::max();
+            field->is_source[box_hash] = 0;
+            field->to_raise[box_hash] = 0;
+        }
+        inc_.occupied[box_hash] = 0;
+    }
+
+    void ESDFMap::pushBrushfire(BrushfireField &field, const int &sqr_dist, const Vec3i &id_g) {
+        field.open[sqr_dist].push_back(id_g);
+        field.open_min = std::min(field.open_min, sqr_dist);
+        field.open_size++;
+    }
+
+    void ESDFMap::setBrushfireSource(BrushfireField &field, const Vec3i &id_g) {
+        const int box_hash = getBoxHash(id_g);
+        field.source[box_hash] = id_g;
+        field.sqr_dist[box_hash] = 0;
+        field.is_source[box_hash] = 1;
+        field.to_raise[box_hash] = 0;
+        pushBrushfire(field, 0, id_g);
+        inc_.changed.push_back(id_g);
+    }
+
+    void ESDFMap::removeBrushfireSource(BrushfireField &field, const Vec3i &id_g) {
+        const int box_hash = getBoxHash(id_g);
+        field.sqr_dist[box_hash] = std::numeric_limits<int>::max();
+        field.is_source[box_hash] = 0;
+        field.to_raise[box_hash] = 1;
+        pushBrushfire(field, 0, id_g);
+        inc_.changed.push_back(id_g);
+    }
+
+    bool ESDFMap::isBrushfireSourceValid(const BrushfireField &field, const Vec3i &id_g) const {
+        return insideBox(id_g, inc_.valid_min, inc_.valid_max) && field.is_source[getBoxHash(id_g)];
+    }
+
+    void ESDFMap::processBrushfire(BrushfireField &field) {
+        while (field.open_size > 0) {
+            while (field.open[field.open_min].empty()) {
+                field.open_min++;
+            }
+            const int item_dist = field.open_min;
+            const Vec3i id_g = field.open[item_dist].back();
+            field.open[item_dist].pop_back();
+            field.open_size--;
+            const int box_hash = getBoxHash(id_g);
+            if (field.to_raise[box_hash]) {
+                /* Raise: clear the neighbors whose source is gone, and queue the others
+                 * to lower the cleared cells again */
+                field.to_raise[box_hash] = 0;
+                forEachBoxNeighbor(id_g, [&](const Vec3i &nei, const int &nei_hash) {
+                    const int nei_dist = field.sqr_dist[nei_hash];
+                    if (field.to_raise[nei_hash] || nei_dist == std::numeric_limits<int>::max()) {
+                        return;
+                    }
+                    if (!field.is_source[nei_hash] && !isBrushfireSourceValid(field, field.source[nei_hash])) {
+                        field.sqr_dist[nei_hash] = std::numeric_limits<int>::max();
+                        field.to_raise[nei_hash] = 1;
+                        inc_.changed.push_back(nei);
+                    }
+                    pushBrushfire(field, nei_dist, nei);
+                });
+            } else if (item_dist == field.sqr_dist[box_hash] &&
+                       (field.is_source[box_hash] || isBrushfireSourceValid(field, field.source[box_hash]))) {
+                /* Lower: pass the source to the neighbors that get closer */
+                const Vec3i source = field.is_source[box_hash] ? id_g : field.source[box_hash];
+                forEachBoxNeighbor(id_g, [&](const Vec3i &nei, const int &nei_hash) {
+                    if (field.to_raise[nei_hash] || (field.occupied_only && !inc_.occupied[nei_hash])) {
+                        return;
+                    }
+                    const int sqr_dist = (nei - source).squaredNorm();
+                    if (sqr_dist < field.sqr_dist[nei_hash] && sqr_dist <= inc_.sqr_dist_cap) {
+                        field.sqr_dist[nei_hash] = sqr_dist;
+                        field.source[nei_hash] = source;
+                        pushBrushfire(field, sqr_dist, nei);
+                        inc_.changed.push_back(nei);
+                    }
+                });
+            }
+        }
+        field.open_min = 0;
+    }
+
+    void ESDFMap::seedBoxCell(BrushfireField &field, const Vec3i &id_g) {
+        /* A cell entering the box takes the nearest source of its neighbors, the
+         * lower step then spreads it to the other entering cells */
+        const int box_hash = getBoxHash(id_g);
+        forEachBoxNeighbor(id_g, [&](const Vec3i &nei, const int &nei_hash) {
+            if (field.sqr_dist[nei_hash] == std::numeric_limits<int>::max()) {
+                return;
+            }
+            const Vec3i source = field.is_source[nei_hash] ? nei : field.source[nei_hash];
+            if (!isBrushfireSourceValid(field, source)) {
+                return;
+            }
+            const int sqr_dist = (id_g - source).squaredNorm();
+            if (sqr_dist < field.sqr_dist[box_hash] && sqr_dist <= inc_.sqr_dist_cap) {
+                field.sqr_dist[box_hash] = sqr_dist;
+                field.source[box_hash] = source;
+            }
+        });
+        if (field.sqr_dist[box_hash] != std::numeric_limits<int>::max()) {
+            pushBrushfire(field, field.sqr_dist[box_hash], id_g);
+        }
+        inc_.changed.push_back(id_g);
+    }
+
+    void ESDFMap::updateESDFIncremental(const Vec3f &cur_odom) {
+        Vec3i cur_odom_i;
+        posToGlobalIndex(cur_odom, cur_odom_i);
+        const Vec3i new_min = (cur_odom_i - half_local_update_box_i_).cwiseMax(local_map_bound_min_i_);
+        const Vec3i new_max = (cur_odom_i + half_local_update_box_i_).cwiseMin(local_map_bound_max_i_) -
+                              Vec3i::Ones();
+
+        /* The raise and seed steps cost more than the full update once a large part of the
+         * box changes, the fields are then dropped until the box slows down */
+        const int box_num = (new_max - new_min + Vec3i::Ones()).cwiseMax(0).prod();
+        const int last_num = (inc_.last_max.cwiseMin(new_max) - inc_.last_min.cwiseMax(new_min) +
+                              Vec3i::Ones()).cwiseMax(0).prod();
+        const bool fallback = box_num - last_num + inc_.edge_num > inc_.fallback_ratio * box_num;
+        inc_.slow_num = fallback ? 0 : inc_.slow_num + 1;
+        inc_.last_min = new_min;
+        inc_.last_max = new_max;
+        inc_.edge_num = 0;
+        if (fallback || (inc_.stale && inc_.slow_num < REBUILD_SLOW_NUM)) {
+            if (!inc_.stale) {
+                resetBrushfire(inc_.pos);
+                resetBrushfire(inc_.neg);
+                inc_.changed.clear();
+                inc_.box_min = inc_.valid_min = Vec3i::Zero();
+                inc_.box_max = inc_.valid_max = -Vec3i::Ones();
+                inc_.stale = true;
+            }
+            updateESDFFull(cur_odom);
+            return;
+        }
+
+        TimeConsuming up_t("updateESDF3D", false);
+        if (inc_.stale) {
+            rebuildBrushfire(new_min, new_max);
+            inc_.stale = false;
+            update_local_map_min_i_ = new_min;
+            update_local_map_max_i_ = new_max;
+            double dt = up_t.stop();
+            if (dt > 0.1) {
+                std::cout << "updateESDF3D time: " << dt << std::endl;
+            }
+            return;
+        }
+        const Vec3i stay_min = inc_.box_min.cwiseMax(new_min);
+        const Vec3i stay_max = inc_.box_max.cwiseMin(new_max);
+
+        const auto forEachCellOutOfStay = [&](const Vec3i &box_min, const Vec3i &box_max,
+                                              const std::function<void(const Vec3i &)> &f) {
+            Vec3i id_g;
+            for (id_g.x() = box_min.x(); id_g.x() <= box_max.x(); id_g.x()++) {
+                for (id_g.y() = box_min.y(); id_g.y() <= box_max.y(); id_g.y()++) {
+                    for (id_g.z() = box_min.z(); id_g.z() <= box_max.z(); id_g.z()++) {
+                        if (!insideBox(id_g, stay_min, stay_max)) {
+                            f(id_g);
+                        }
+                    }
+                }
+            }
+        };
+
+        // 1. The cells leaving the box drop their sources, the cells they reached are raised
+        const Vec3i old_min = inc_.box_min, old_max = inc_.box_max;
+        inc_.valid_min = stay_min;
+        inc_.valid_max = stay_max;
+        forEachCellOutOfStay(old_min, old_max, [&](const Vec3i &id_g) {
+            const int box_hash = getBoxHash(id_g);
+            for (auto *field: {&inc_.pos, &inc_.neg}) {
+                if (field->is_source[box_hash]) {
+                    removeBrushfireSource(*field, id_g);
+                }
+            }
+        });
+        processBrushfire(inc_.pos);
+        processBrushfire(inc_.neg);
+        forEachCellOutOfStay(old_min, old_max, [&](const Vec3i &id_g) {
+            clearBoxCell(getBoxHash(id_g));
+        });
+
+        // 2. The cells entering the box become sources by their occupancy, the others are seeded
+        inc_.box_min = inc_.valid_min = new_min;
+        inc_.box_max = inc_.valid_max = new_max;
+        forEachCellOutOfStay(new_min, new_max, [&](const Vec3i &id_g) {
+            const int box_hash = getBoxHash(id_g);
+            clearBoxCell(box_hash);
+            inc_.occupied[box_hash] = isOccupied(getHashIndexFromGlobalIndex(id_g));
+            setBrushfireSource(inc_.occupied[box_hash] ? inc_.pos : inc_.neg, id_g);
+        });
+        forEachCellOutOfStay(new_min, new_max, [&](const Vec3i &id_g) {
+            seedBoxCell(inc_.occupied[getBoxHash(id_g)] ? inc_.neg : inc_.pos, id_g);
+        });
+
+        // 3. Spread the changes, and refresh the distances of the changed cells in the box
+        processBrushfire(inc_.pos);
+        processBrushfire(inc_.neg);
+        for (const auto &id_g: inc_.changed) {
+            if (insideBox(id_g, new_min, new_max)) {
+                refreshDistance(id_g);
+            }
+        }
+        inc_.changed.clear();
+        update_local_map_min_i_ = new_min;
+        update_local_map_max_i_ = new_max;
+        double dt = up_t.stop();
+        if (dt > 0.1) {
+            std::cout << "updateESDF3D time: " << dt << std::endl;
+        }
+    }
+
+    void ESDFMap::rebuildBrushfire(const Vec3i &box_min, const Vec3i &box_max) {
+        resetBrushfire(inc_.pos);
+        resetBrushfire(inc_.neg);
+        inc_.changed.clear();
+        inc_.box_min = inc_.valid_min = box_min;
+        inc_.box_max = inc_.valid_max = box_max;
+        const auto forEachBoxCell = [&](const std::function<void(const Vec3i &, const int &)> &f) {
+            Vec3i id_g;
+            for (id_g.x() = box_min.x(); id_g.x() <= box_max.x(); id_g.x()++) {
+                for (id_g.y() = box_min.y(); id_g.y() <= box_max.y(); id_g.y()++) {
+                    for (id_g.z() = box_min.z(); id_g.z() <= box_max.z(); id_g.z()++) {
+                        f(id_g, getBoxHash(id_g));
+                    }
+                }
+            }
+        };
+
+        // Every cell is a source, of the positive field if occupied and of the negative one if not
+        forEachBoxCell([&](const Vec3i &id_g, const int &box_hash) {
+            inc_.occupied[box_hash] = isOccupied(getHashIndexFromGlobalIndex(id_g));
+            BrushfireField &field = inc_.occupied[box_hash] ? inc_.pos : inc_.neg;
+            field.source[box_hash] = id_g;
+            field.sqr_dist[box_hash] = 0;
+            field.is_source[box_hash] = 1;
+        });
+        // A source surrounded by sources of its field cannot lower any neighbor
+        forEachBoxCell([&](const Vec3i &id_g, const int &box_hash) {
+            const uint8_t occupied = inc_.occupied[box_hash];
+            bool boundary = false;
+            forEachBoxNeighbor(id_g, [&](const Vec3i &nei, const int &nei_hash) {
+                boundary = boundary || inc_.occupied[nei_hash] != occupied;
+            });
+            if (boundary) {
+                pushBrushfire(occupied ? inc_.pos : inc_.neg, 0, id_g);
+            }
+        });
+        processBrushfire(inc_.pos);
+        processBrushfire(inc_.neg);
+        inc_.changed.clear();
+        forEachBoxCell([&](const Vec3i &id_g, const int &box_hash) {
+            refreshDistance(id_g);
+        });
+    }
+
+    void ESDFMap::refreshDistance(const Vec3i &id_g) {
+        /* The same signed distance as the full update, the distance to the nearest
+         * occupied cell outside, and one cell minus the distance to the nearest
+         * not occupied cell inside */
+        const int box_hash = getBoxHash(id_g);
+        ESDFValue &dist = distance_buffer[getHashIndexFromGlobalIndex(id_g)];
+        if (inc_.occupied[box_hash]) {
+            const int sqr_dist = inc_.neg.sqr_dist[box_hash];
+            dist = sqr_dist > inc_.sqr_dist_cap ? sc_.resolution - inc_.max_dist :
+                   sc_.resolution * (1.0 - std::sqrt(sqr_dist));
+        } else {
+            const int sqr_dist = inc_.pos.sqr_dist[box_hash];
+            dist = sqr_dist > inc_.sqr_dist_cap ? inc_.max_dist : sc_.resolution * std::sqrt(sqr_dist);
+        }
+    }
 
     void ESDFMap::getPositiveESDFPointCloud(const rog_map::Vec3f &box_min_d, const rog_map::Vec3f &box_max_d,
                                      const double &visualize_z, pcl::PointCloud<pcl::PointXYZI> & pcl_pc) {
@@ -317,6 +709,13 @@ namespace rog_map {
         pcl_pc.is_dense = true;
     }
 
+    template<typename F>
+    void ESDFMap::parallelForRange(const int &start, const int &end, F &&f) {
+        thread_pool_->parallelFor(end - start + 1, [&](const int &task_id) {
+            f(start + task_id);
+        });
+    }
+
     template<typename F_get_val, typename F_set_val>
     void ESDFMap::fillESDF(F_get_val f_get_val, F_set_val f_set_val, const int &start, const int &end, const int &dim,
                            const int &id_l) {
@@ -461,6 +860,59 @@ namespace rog_map {
         interpolateTrilinearSecondGrad(first_grad, diff, grad);
     }
 
+    void ESDFMap::evaluateEDTBatch(const Mat3Df &pos, VecDf &dist, Mat3Df &grad) const {
+        const Eigen::Index pt_num = pos.cols();
+        /* 1) Gather the 8 surrounding distances of each point, row x * 4 + y * 2 + z.
+         * The lower corner is indexed once, and the upper one is its next local index,
+         * wrapped at the border of the memory. The ESDF map always has the flat layout.
+         * */
+        Eigen::Matrix<double, 8, Eigen::Dynamic> corner(8, pt_num);
+        Eigen::Array<double, 3, Eigen::Dynamic> diff(3, pt_num);
+        const Vec3f half_res = 0.5 * sc_.resolution * Vec3f::Ones();
+        for (Eigen::Index i = 0; i < pt_num; i++) {
+            Vec3i idx, id_l[2];
+            Vec3f idx_pos;
+            posToGlobalIndex(Vec3f(pos.col(i) - half_res), idx);
+            globalIndexToPos(idx, idx_pos);
+            diff.col(i) = (pos.col(i) - idx_pos) * sc_.resolution_inv;
+            globalIndexToLocalIndex(idx, id_l[0]);
+            for (int a = 0; a < 3; a++) {
+                id_l[1](a) = id_l[0](a) == sc_.half_map_size_i(a) ? -sc_.half_map_size_i(a) : id_l[0](a) + 1;
+            }
+            int hash_x[2], hash_y[2], hash_z[2];
+            for (int k = 0; k < 2; k++) {
+                hash_x[k] = (id_l[k].x() + sc_.half_map_size_i.x()) * sc_.map_size_i.y() * sc_.map_size_i.z();
+                hash_y[k] = (id_l[k].y() + sc_.half_map_size_i.y()) * sc_.map_size_i.z();
+                hash_z[k] = id_l[k].z() + sc_.half_map_size_i.z();
+            }
+            for (int x = 0; x < 2; x++) {
+                for (int y = 0; y < 2; y++) {
+                    for (int z = 0; z < 2; z++) {
+                        corner(x * 4 + y * 2 + z, i) = distance_buffer[hash_x[x] + hash_y[y] + hash_z[z]];
+                    }
+                }
+            }
+        }
+
+        /* 2) Interpolate all points at once, the same as interpolateTrilinearEDT and
+         * interpolateTrilinearFirstGrad */
+        const auto dx = diff.row(0), dy = diff.row(1), dz = diff.row(2);
+        const auto c = [&corner](const int &row) { return corner.row(row).array(); };
+        const Eigen::Array<double, 1, Eigen::Dynamic> v00 = (1 - dx) * c(0) + dx * c(4);
+        const Eigen::Array<double, 1, Eigen::Dynamic> v01 = (1 - dx) * c(1) + dx * c(5);
+        const Eigen::Array<double, 1, Eigen::Dynamic> v10 = (1 - dx) * c(2) + dx * c(6);
+        const Eigen::Array<double, 1, Eigen::Dynamic> v11 = (1 - dx) * c(3) + dx * c(7);
+        const Eigen::Array<double, 1, Eigen::Dynamic> v0 = (1 - dy) * v00 + dy * v10;
+        const Eigen::Array<double, 1, Eigen::Dynamic> v1 = (1 - dy) * v01 + dy * v11;
+
+        dist = ((1 - dz) * v0 + dz * v1).transpose().matrix();
+        grad.resize(3, pt_num);
+        grad.row(2) = ((v1 - v0) * sc_.resolution_inv).matrix();
+        grad.row(1) = (((1 - dz) * (v10 - v00) + dz * (v11 - v01)) * sc_.resolution_inv).matrix();
+        grad.row(0) = (((1 - dz) * ((1 - dy) * (c(4) - c(0)) + dy * (c(6) - c(2))) +
+                        dz * ((1 - dy) * (c(5) - c(1)) + dy * (c(7) - c(3)))) * sc_.resolution_inv).matrix();
+    }
+
     void ESDFMap::interpolateTrilinearEDT(double values[2][2][2],
                                                  const Eigen::Vector3d& diff,
                                                  double& value){
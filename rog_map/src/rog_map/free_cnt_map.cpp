@@ -0,0 +1,305 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <rog_map/free_cnt_map.h>
+
+using namespace rog_map;
+
+namespace {
+    template<typename F>
+    void forEachNeighbor26(const Vec3i &id_g, F &&f) {
+        Vec3i nb;
+        for (int i = -1; i <= 1; ++i) {
+            nb.x() = id_g.x() + i;
+            for (int j = -1; j <= 1; ++j) {
+                nb.y() = id_g.y() + j;
+                for (int k = -1; k <= 1; ++k) {
+                    if (i == 0 && j == 0 && k == 0) {
+                        continue;
+                    }
+                    nb.z() = id_g.z() + k;
+                    f(nb);
+                }
+            }
+        }
+    }
+
+    /* Visit the cells inside box a but outside box b */
+    template<typename F>
+    void forEachBoxDifference(const Vec3i &a_min, const Vec3i &a_max,
+                              const Vec3i &b_min, const Vec3i &b_max, F &&f) {
+        auto inside_b = [&](const int &axis, const int &v) {
+            return v >= b_min[axis] && v <= b_max[axis];
+        };
+        const bool y_covered = a_min.y() >= b_min.y() && a_max.y() <= b_max.y();
+        const bool z_covered = a_min.z() >= b_min.z() && a_max.z() <= b_max.z();
+        Vec3i id_g;
+        auto visit_z_range = [&](const int &z_min, const int &z_max) {
+            for (id_g.z() = z_min; id_g.z() <= z_max; id_g.z()++) {
+                f(id_g);
+            }
+        };
+        for (id_g.x() = a_min.x(); id_g.x() <= a_max.x(); id_g.x()++) {
+            const bool x_in = inside_b(0, id_g.x());
+            if (x_in && y_covered && z_covered) {
+                continue;
+            }
+            for (id_g.y() = a_min.y(); id_g.y() <= a_max.y(); id_g.y()++) {
+                if (!x_in || !inside_b(1, id_g.y())) {
+                    visit_z_range(a_min.z(), a_max.z());
+                } else if (!z_covered) {
+                    visit_z_range(a_min.z(), std::min(a_max.z(), b_min.z() - 1));
+                    visit_z_range(std::max(a_min.z(), b_max.z() + 1), a_max.z());
+                }
+            }
+        }
+    }
+}
+
+void FreeCntMap::initFrontierIndex() {
+    frontier_index_.enable = true;
+    frontier_index_.known.assign(sc_.map_vox_num, 0);
+    frontier_index_.label.assign(sc_.map_vox_num, -1);
+    clearFrontierIndex();
+    std::cout << GREEN << " -- [Fro-Map] Incremental frontier clustering enabled." << RESET << std::endl;
+}
+
+void FreeCntMap::clearFrontierIndex() {
+    std::fill(frontier_index_.label.begin(), frontier_index_.label.end(), -1);
+    frontier_index_.clusters.clear();
+    frontier_index_.frontier_num = 0;
+    // All counters are zero after a reset, the next box update does not need to scan the box
+    frontier_index_.box_valid = false;
+}
+
+void FreeCntMap::updateKnownFlag(const Vec3i &id_g, const bool &known) {
+    if (!frontier_index_.enable || !insideLocalMap(id_g)) {
+        return;
+    }
+    const int hash_id = getHashIndexFromGlobalIndex(id_g);
+    frontier_index_.known[hash_id] = known;
+    refreshFrontier(hash_id, id_g);
+}
+
+void FreeCntMap::setFrontierIndexBox(const Vec3i &box_min, const Vec3i &box_max) {
+    if (!frontier_index_.enable) {
+        return;
+    }
+    auto &fi = frontier_index_;
+    const Vec3i new_min = box_min.cwiseMax(local_map_bound_min_i_);
+    const Vec3i new_max = box_max.cwiseMin(local_map_bound_max_i_);
+    if (!fi.box_valid) {
+        fi.box_min = new_min;
+        fi.box_max = new_max;
+        fi.box_valid = true;
+        return;
+    }
+    if (new_min == fi.box_min && new_max == fi.box_max) {
+        return;
+    }
+    const Vec3i old_min = fi.box_min, old_max = fi.box_max;
+    // 1) Drop the frontiers leaving the box, the ones leaving the map are dropped by resetSlab
+    forEachBoxDifference(old_min, old_max, new_min, new_max, [&](const Vec3i &id_g) {
+        if (insideLocalMap(id_g)) {
+            removeFrontier(getHashIndexFromGlobalIndex(id_g));
+        }
+    });
+    fi.box_min = new_min;
+    fi.box_max = new_max;
+    // 2) Evaluate the cells entering the box
+    forEachBoxDifference(new_min, new_max, old_min, old_max, [&](const Vec3i &id_g) {
+        refreshFrontier(getHashIndexFromGlobalIndex(id_g), id_g);
+    });
+}
+
+void FreeCntMap::refreshFrontier(const int &hash_id, const Vec3i &id_g) {
+    const bool is_frontier = insideFrontierBox(id_g) &&
+                             !frontier_index_.known[hash_id] &&
+                             neighbor_free_cnt[hash_id] > 0;
+    const bool indexed = frontier_index_.label[hash_id] >= 0;
+    if (is_frontier && !indexed) {
+        insertFrontier(hash_id, id_g);
+    } else if (!is_frontier && indexed) {
+        removeFrontier(hash_id);
+    }
+}
+
+void FreeCntMap::insertFrontier(const int &hash_id, const Vec3i &id_g) {
+    auto &fi = frontier_index_;
+    // Collect the distinct clusters of the neighbor frontiers
+    int neighbor_cluster[26];
+    int neighbor_num = 0;
+    forEachNeighbor26(id_g, [&](const Vec3i &nb) {
+        if (!insideFrontierBox(nb)) {
+            return;
+        }
+        const int cluster_id = fi.label[getHashIndexFromGlobalIndex(nb)];
+        if (cluster_id >= 0 && std::find(neighbor_cluster, neighbor_cluster + neighbor_num, cluster_id) ==
+                               neighbor_cluster + neighbor_num) {
+            neighbor_cluster[neighbor_num++] = cluster_id;
+        }
+    });
+
+    int cluster_id;
+    if (neighbor_num == 0) {
+        cluster_id = fi.next_cluster_id++;
+    } else {
+        // Merge the smaller clusters into the largest one, each cell is relabeled O(log n) times
+        cluster_id = neighbor_cluster[0];
+        for (int i = 1; i < neighbor_num; i++) {
+            if (fi.clusters[neighbor_cluster[i]].members.size() > fi.clusters[cluster_id].members.size()) {
+                cluster_id = neighbor_cluster[i];
+            }
+        }
+        for (int i = 0; i < neighbor_num; i++) {
+            if (neighbor_cluster[i] != cluster_id) {
+                mergeCluster(neighbor_cluster[i], cluster_id);
+            }
+        }
+    }
+
+    fi.label[hash_id] = cluster_id;
+    fi.frontier_num++;
+    auto &cluster = fi.clusters[cluster_id];
+    Vec3f pos;
+    globalIndexToPos(id_g, pos);
+    cluster.members.push_back(id_g);
+    cluster.size++;
+    cluster.pos_sum += pos;
+    if (cluster.members.size() > 2 * static_cast<size_t>(cluster.size) + 64) {
+        compactCluster(cluster, cluster_id);
+    }
+}
+
+void FreeCntMap::removeFrontier(const int &hash_id) {
+    auto &fi = frontier_index_;
+    const int cluster_id = fi.label[hash_id];
+    if (cluster_id < 0) {
+        return;
+    }
+    fi.label[hash_id] = -1;
+    fi.frontier_num--;
+    // The position sum of a dirty cluster is recomputed by the split
+    const auto it = fi.clusters.find(cluster_id);
+    it->second.size--;
+    it->second.dirty = true;
+    if (it->second.size == 0) {
+        fi.clusters.erase(it);
+    }
+}
+
+void FreeCntMap::mergeCluster(const int &from_id, const int &to_id) {
+    auto &fi = frontier_index_;
+    const auto from_it = fi.clusters.find(from_id);
+    auto &from = from_it->second;
+    auto &to = fi.clusters[to_id];
+    for (const auto &id_g: from.members) {
+        if (isClusterMember(id_g, from_id)) {
+            fi.label[getHashIndexFromGlobalIndex(id_g)] = to_id;
+            to.members.push_back(id_g);
+        }
+    }
+    to.size += from.size;
+    to.pos_sum += from.pos_sum;
+    to.dirty = to.dirty || from.dirty;
+    fi.clusters.erase(from_it);
+}
+
+void FreeCntMap::compactCluster(ClusterData &cluster, const int &cluster_id) {
+    // Relabel the kept members to -2 on the fly to drop the duplicates
+    auto &members = cluster.members;
+    size_t kept = 0;
+    for (const auto &id_g: members) {
+        if (isClusterMember(id_g, cluster_id)) {
+            frontier_index_.label[getHashIndexFromGlobalIndex(id_g)] = -2;
+            members[kept++] = id_g;
+        }
+    }
+    members.resize(kept);
+    for (const auto &id_g: members) {
+        frontier_index_.label[getHashIndexFromGlobalIndex(id_g)] = cluster_id;
+    }
+}
+
+void FreeCntMap::splitCluster(const int &cluster_id) {
+    auto &fi = frontier_index_;
+    const auto old_it = fi.clusters.find(cluster_id);
+    const vec_E<Vec3i> old_members = std::move(old_it->second.members);
+    fi.clusters.erase(old_it);
+    for (const auto &seed: old_members) {
+        // Stale members, or cells already flooded from a previous seed
+        if (!isClusterMember(seed, cluster_id)) {
+            continue;
+        }
+        // Flood the connected component of the seed into a new cluster, the members are the queue
+        const int new_id = fi.next_cluster_id++;
+        auto &cluster = fi.clusters[new_id];
+        fi.label[getHashIndexFromGlobalIndex(seed)] = new_id;
+        cluster.members.push_back(seed);
+        for (size_t i = 0; i < cluster.members.size(); i++) {
+            const Vec3i id_g = cluster.members[i];
+            Vec3f pos;
+            globalIndexToPos(id_g, pos);
+            cluster.size++;
+            cluster.pos_sum += pos;
+            forEachNeighbor26(id_g, [&](const Vec3i &nb) {
+                if (isClusterMember(nb, cluster_id)) {
+                    fi.label[getHashIndexFromGlobalIndex(nb)] = new_id;
+                    cluster.members.push_back(nb);
+                }
+            });
+        }
+    }
+}
+
+void FreeCntMap::getFrontierClusters(std::vector<FrontierCluster> &clusters) {
+    clusters.clear();
+    if (!frontier_index_.enable) {
+        return;
+    }
+    auto &fi = frontier_index_;
+    // The caller keeps the map updates out, the concurrent readers are serialized here
+    std::lock_guard<std::mutex> lck(fi.query_mtx);
+    std::vector<int> dirty_ids;
+    for (const auto &cluster: fi.clusters) {
+        if (cluster.second.dirty) {
+            dirty_ids.push_back(cluster.first);
+        }
+    }
+    for (const auto &cluster_id: dirty_ids) {
+        splitCluster(cluster_id);
+    }
+
+    clusters.reserve(fi.clusters.size());
+    for (const auto &cluster: fi.clusters) {
+        const auto &data = cluster.second;
+        FrontierCluster out;
+        out.size = data.size;
+        out.centroid = data.pos_sum / data.size;
+        out.cells.resize(data.members.size());
+        for (size_t i = 0; i < data.members.size(); i++) {
+            globalIndexToPos(data.members[i], out.cells[i]);
+        }
+        clusters.push_back(std::move(out));
+    }
+}
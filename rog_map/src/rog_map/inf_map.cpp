@@ -27,18 +27,45 @@ using namespace super_utils;
 
 namespace rog_map {
     // Public Query Function ========================================================================
-    bool InfMap::isOccupiedInflate(const Vec3f& pos) const {
+    bool InfMap::isOccupiedInflate(const Vec3f& pos, const int& layer_id) const {
         if (!insideLocalMap(pos)) return false;
-        if (pos.z() > cfg_.virtual_ceil_height) return true;
-        if (pos.z() < cfg_.virtual_ground_height) return true;
-        return imd_.occ_inflate_cnt[getHashIndexFromPos(pos)] > 0;
+        // The virtual ceil and ground were inflated by inflation_step
+        const double extra_h = (getLayerStep(layer_id) - cfg_.inflation_step) * cfg_.inflation_resolution;
+        if (pos.z() > cfg_.virtual_ceil_height - extra_h) return true;
+        if (pos.z() < cfg_.virtual_ground_height + extra_h) return true;
+        return getOccInflateCnt(getHashIndexFromPos(pos), layer_id) > 0;
     }
 
-    bool InfMap::isOccupiedInflate(const Vec3i& id_g) const {
+    bool InfMap::isOccupiedInflate(const Vec3i& id_g, const int& layer_id) const {
         if (!insideLocalMap(id_g)) return false;
-        if (id_g.z() > cfg_.inf_virtual_ceil_height_id_g) return true;
-        if (id_g.z() < cfg_.inf_virtual_ground_height_id_g) return true;
-        return imd_.occ_inflate_cnt[getHashIndexFromGlobalIndex(id_g)] > 0;
+        const int extra_step = getLayerStep(layer_id) - cfg_.inflation_step;
+        if (id_g.z() > cfg_.inf_virtual_ceil_height_id_g - extra_step) return true;
+        if (id_g.z() < cfg_.inf_virtual_ground_height_id_g + extra_step) return true;
+        return getOccInflateCnt(getHashIndexFromGlobalIndex(id_g), layer_id) > 0;
+    }
+
+    int InfMap::getInflationLayerId(const double& radius) const {
+        int best_id = -1, max_id = 0;
+        for (int i = 0; i < getInflationLayerNum(); i++) {
+            if (getLayerStep(i) > getLayerStep(max_id)) {
+                max_id = i;
+            }
+            if (getLayerStep(i) * sc_.resolution >= radius &&
+                (best_id < 0 || getLayerStep(i) < getLayerStep(best_id))) {
+                best_id = i;
+            }
+        }
+        return best_id < 0 ? max_id : best_id;
+    }
+
+    void InfMap::getSnapshotBuffers(std::vector<SnapshotBuffer>& buffers) {
+        buffers.push_back(makeSnapshotBuffer(md_.occupied_cnt));
+        buffers.push_back(makeSnapshotBuffer(md_.unknown_cnt));
+        buffers.push_back(makeSnapshotBuffer(imd_.occ_inflate_cnt));
+        buffers.push_back(makeSnapshotBuffer(imd_.unk_inflate_cnt));
+        for (auto& layer: imd_.layers) {
+            buffers.push_back(makeSnapshotBuffer(layer.cnt));
+        }
     }
 
     bool InfMap::isKnownFreeInflate(const Vec3f& pos) const {
@@ -80,6 +107,10 @@ namespace rog_map {
         if (cfg_.unk_inflation_en) {
             max_step = std::max(max_step, cfg_.unk_inflation_step);
         }
+        for (const auto& step : cfg_.inflation_layer_steps) {
+            max_step = std::max(max_step, step);
+        }
+        max_inflation_step_ = max_step;
 
         initCounterMap(cfg.half_map_size_i,
                        cfg.resolution,
@@ -88,14 +119,29 @@ namespace rog_map {
                        cfg.map_sliding_en,
                        cfg.map_sliding_thresh,
                        cfg.fix_map_origin,
-                       cfg.unk_thresh);
+                       cfg.unk_thresh,
+                       cfg.brick_layout_en);
 
         posToGlobalIndex(cfg.visualization_range, sc_.visualization_range_i);
 
         imd_.occ_inflate_cnt.resize(sc_.map_vox_num);
         imd_.occ_neighbor_num = cfg.inf_spherical_neighbor.size();
+        buildNeighborRuns(cfg.inf_spherical_neighbor, imd_.occ_neighbor_runs);
+        // The same kernel as inf_spherical_neighbor, a step of 1 is the whole 3x3x3 cube
+        rid_.radius = cfg.inflation_step;
+        rid_.sqr_radius = cfg.inflation_step == 1 ? 3 : cfg.inflation_step * cfg.inflation_step;
+        rid_.sqr_dist_cap = rid_.sqr_radius + 1;
+        imd_.layers.resize(cfg.inflation_layer_steps.size());
+        for (size_t i = 0; i < imd_.layers.size(); i++) {
+            auto& layer = imd_.layers[i];
+            layer.step = cfg.inflation_layer_steps[i];
+            layer.neighbor_num = cfg.inf_layer_spherical_neighbor[i].size();
+            buildNeighborRuns(cfg.inf_layer_spherical_neighbor[i], layer.runs);
+            layer.cnt.resize(sc_.map_vox_num);
+        }
         if (cfg.unk_inflation_en) {
             imd_.unk_neighbor_num = cfg.unk_inf_spherical_neighbor.size();
+            buildNeighborRuns(cfg.unk_inf_spherical_neighbor, imd_.unk_neighbor_runs);
             // Considering the all grids are unknown at the beginning
             // the unk inf cnt should be the size of inflation queue
             imd_.unk_inflate_cnt.resize(sc_.map_vox_num);
@@ -143,14 +189,7 @@ namespace rog_map {
             out_points.reserve(box_size.prod());
             for (int i = box_min_id_g.x(); i <= box_max_id_g.x(); i++) {
                 for (int j = box_min_id_g.y(); j <= box_max_id_g.y(); j++) {
-                    for (int k = box_min_id_g.z(); k <= box_max_id_g.z(); k++) {
-                        Vec3i id_g(i, j, k);
-                        if (isUnknown(id_g)) {
-                            Vec3f pos;
-                            globalIndexToPos(id_g, pos);
-                            out_points.push_back(pos);
-                        }
-                    }
+                    searchZRun(i, j, box_min_id_g.z(), box_max_id_g.z(), UNKNOWN, out_points);
                 }
             }
         }
@@ -158,14 +197,7 @@ namespace rog_map {
             out_points.reserve(box_size.prod() / 3);
             for (int i = box_min_id_g.x(); i <= box_max_id_g.x(); i++) {
                 for (int j = box_min_id_g.y(); j <= box_max_id_g.y(); j++) {
-                    for (int k = box_min_id_g.z(); k <= box_max_id_g.z(); k++) {
-                        Vec3i id_g(i, j, k);
-                        if (isOccupiedInflate(id_g)) {
-                            Vec3f pos;
-                            globalIndexToPos(id_g, pos);
-                            out_points.push_back(pos);
-                        }
-                    }
+                    searchZRun(i, j, box_min_id_g.z(), box_max_id_g.z(), OCCUPIED, out_points);
                 }
             }
         }
@@ -174,41 +206,227 @@ namespace rog_map {
         }
     }
 
+    void InfMap::searchZRun(const int& x, const int& y, const int& z_min, const int& z_max,
+                            const GridType& gt, vec_E<Vec3f>& out_points) const {
+        auto slow_search = [&](const int& z_start, const int& z_end) {
+            for (int k = z_start; k <= z_end; k++) {
+                const Vec3i id_g(x, y, k);
+                if (gt == OCCUPIED ? isOccupiedInflate(id_g) : isUnknown(id_g)) {
+                    Vec3f pos;
+                    globalIndexToPos(id_g, pos);
+                    out_points.push_back(pos);
+                }
+            }
+        };
+        // Outside the local map and the virtual ceil and ground, the cells are checked one by one
+        int run_z_min = std::max(z_min, local_map_bound_min_i_.z());
+        int run_z_max = std::min(z_max, local_map_bound_max_i_.z());
+        if (gt == OCCUPIED) {
+            run_z_min = std::max(run_z_min, cfg_.inf_virtual_ground_height_id_g);
+            run_z_max = std::min(run_z_max, cfg_.inf_virtual_ceil_height_id_g);
+        }
+        if (run_z_min > run_z_max || !insideLocalMap(Vec3i(x, y, run_z_min))) {
+            slow_search(z_min, z_max);
+            return;
+        }
+        slow_search(z_min, run_z_min - 1);
+        int k = run_z_min;
+        forEachHashInZRun(Vec3i(x, y, run_z_min), run_z_max - run_z_min + 1, [&](const int& addr) {
+            if (gt == OCCUPIED ? imd_.occ_inflate_cnt[addr] > 0 : isUnknown(addr)) {
+                Vec3f pos;
+                globalIndexToPos(Vec3i(x, y, k), pos);
+                out_points.push_back(pos);
+            }
+            k++;
+        });
+        slow_search(run_z_max + 1, z_max);
+    }
+
+
+    bool InfMap::areLinesFree(const vec_Vec3f& starts, const vec_Vec3f& ends, std::vector<double>& blocked_t,
+                              const int& layer_id, const double& max_dis,
+                              const bool& stop_at_first_blocked) const {
+        const int seg_num = static_cast<int>(starts.size());
+        blocked_t.assign(seg_num, -1.0);
+        if (seg_num == 0) {
+            return true;
+        }
+        if (ends.size() != starts.size()) {
+            throw std::invalid_argument(" -- [InfMap] areLinesFree needs the same number of starts and ends.");
+        }
+        /* The segments with the same start as the previous one share its start cell, whose
+         * state is evaluated once. The start cell is the first cell visited on a segment.
+         * */
+        std::vector<int> group_of(seg_num);
+        vec_E<Vec3i> group_start_id;
+        std::vector<int8_t> group_start_blocked;
+        for (int i = 0; i < seg_num; i++) {
+            if (i == 0 || starts[i] != starts[i - 1]) {
+                Vec3i id_g;
+                posToGlobalIndex(starts[i], id_g);
+                group_start_id.push_back(id_g);
+                group_start_blocked.push_back(isOccupiedInflate(id_g, layer_id));
+            }
+            group_of[i] = static_cast<int>(group_start_id.size()) - 1;
+        }
+
+        // Parameter where the segment enters the cell id_g
+        auto entry_param = [&](const int& i, const Vec3i& id_g) {
+            Vec3f center;
+            globalIndexToPos(id_g, center);
+            const Vec3f dir = ends[i] - starts[i];
+            double t_enter = 0.0;
+            for (int axis = 0; axis < 3; axis++) {
+                if (std::fabs(dir[axis]) < 1e-12) {
+                    continue;
+                }
+                const double t0 = (center[axis] - 0.5 * sc_.resolution - starts[i][axis]) / dir[axis];
+                const double t1 = (center[axis] + 0.5 * sc_.resolution - starts[i][axis]) / dir[axis];
+                t_enter = std::max(t_enter, std::min(t0, t1));
+            }
+            return std::min(t_enter, 1.0);
+        };
+
+        const double max_dis_sqr = max_dis * max_dis;
+        int first_blocked = seg_num;
+        raycaster::BatchRayCaster raycaster;
+        raycaster.setResolution(sc_.resolution);
+        raycaster.walk(starts, ends, [&](const int& i, const Vec3i& id_g) {
+            if (stop_at_first_blocked && i > first_blocked) {
+                return false;
+            }
+            const int group = group_of[i];
+            bool blocked;
+            if (id_g == group_start_id[group]) {
+                blocked = group_start_blocked[group];
+            } else {
+                Vec3f center;
+                globalIndexToPos(id_g, center);
+                blocked = (center - starts[i]).squaredNorm() > max_dis_sqr || isOccupiedInflate(id_g, layer_id);
+            }
+            if (!blocked) {
+                return true;
+            }
+            blocked_t[i] = entry_param(i, id_g);
+            first_blocked = std::min(first_blocked, i);
+            return false;
+        });
+
+        if (stop_at_first_blocked) {
+            for (int i = first_blocked + 1; i < seg_num; i++) {
+                blocked_t[i] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+        return first_blocked == seg_num;
+    }
 
     void InfMap::resetLocalMap() {
         std::cout << YELLOW << " -- [Inf-Map] Clear all local map." << RESET << std::endl;
         std::fill(md_.unknown_cnt.begin(), md_.unknown_cnt.end(), md_.sub_grid_num);
         std::fill(md_.occupied_cnt.begin(), md_.occupied_cnt.end(), 0);
         std::fill(imd_.occ_inflate_cnt.begin(), imd_.occ_inflate_cnt.end(), 0);
+        for (auto& layer : imd_.layers) {
+            std::fill(layer.cnt.begin(), layer.cnt.end(), 0);
+        }
         if (cfg_.unk_inflation_en) {
             std::fill(imd_.unk_inflate_cnt.begin(), imd_.unk_inflate_cnt.end(), imd_.unk_neighbor_num);
         }
+        clearEdgeLog();
+    }
+
+    bool InfMap::getJumpingEdgesSince(uint64_t& seq, std::vector<JumpingEdge>& edges) const {
+        std::lock_guard<std::mutex> lck(edge_log_.mtx);
+        const uint64_t end_seq = edge_log_.begin_seq + edge_log_.edges.size();
+        if (!edge_log_.enabled.exchange(true) || seq < edge_log_.begin_seq || seq > end_seq) {
+            seq = end_seq;
+            return false;
+        }
+        edges.insert(edges.end(), edge_log_.edges.begin() + static_cast<long>(seq - edge_log_.begin_seq),
+                     edge_log_.edges.end());
+        seq = end_seq;
+        return true;
+    }
+
+    void InfMap::logJumpingEdges(const JumpingEdge* edges, const size_t& num) {
+        if (!edge_log_.enabled.load(std::memory_order_relaxed) || num == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lck(edge_log_.mtx);
+        if (edge_log_.edges.size() + num > MAX_EDGE_LOG_SIZE) {
+            // Drop the older half, the users behind it start over
+            const size_t drop_num = std::min(edge_log_.edges.size(),
+                                             std::max(edge_log_.edges.size() / 2,
+                                                      edge_log_.edges.size() + num - MAX_EDGE_LOG_SIZE));
+            edge_log_.edges.erase(edge_log_.edges.begin(), edge_log_.edges.begin() + static_cast<long>(drop_num));
+            edge_log_.begin_seq += drop_num;
+        }
+        edge_log_.edges.insert(edge_log_.edges.end(), edges, edges + num);
+    }
+
+    void InfMap::clearEdgeLog() {
+        std::lock_guard<std::mutex> lck(edge_log_.mtx);
+        // One past the end, so that a user at the end also sees the edges as lost
+        edge_log_.begin_seq += edge_log_.edges.size() + 1;
+        edge_log_.edges.clear();
+    }
+
+    void InfMap::buildNeighborRuns(const std::vector<Vec3i>& neighbors, std::vector<NeighborRun>& runs) {
+        std::vector<Vec3i> sorted_neighbors = neighbors;
+        std::sort(sorted_neighbors.begin(), sorted_neighbors.end(), [](const Vec3i& a, const Vec3i& b) {
+            return a.x() != b.x() ? a.x() < b.x() : (a.y() != b.y() ? a.y() < b.y() : a.z() < b.z());
+        });
+        runs.clear();
+        for (const auto& nei : sorted_neighbors) {
+            if (!runs.empty()) {
+                NeighborRun& last = runs.back();
+                if (last.start.x() == nei.x() && last.start.y() == nei.y() &&
+                    last.start.z() + last.len == nei.z()) {
+                    last.len++;
+                    continue;
+                }
+            }
+            runs.push_back({nei, 1});
+        }
     }
 
     void InfMap::updateInflation(const Vec3i& id_g, const bool is_hit) {
         TimeConsuming tc("updateInflation", false);
-        for (const auto& nei : cfg_.inf_spherical_neighbor) {
-            const Vec3i& id_shift = id_g + nei;
+        const int16_t delta = is_hit ? 1 : -1;
+        for (const auto& run : imd_.occ_neighbor_runs) {
+            const Vec3i id_shift = id_g + run.start;
 #ifdef COUNTER_MAP_DEBUG
-            if (!insideLocalMap(id_shift)) {
+            if (!insideLocalMap(id_shift) || !insideLocalMap(Vec3i(id_shift + Vec3i(0, 0, run.len - 1)))) {
                 throw std::runtime_error(" -- [IM] inflation out of map.");
             }
 #endif
-            inf_num_++;
-            const int& addr = getHashIndexFromGlobalIndex(id_shift);
-            if (is_hit) {
-                imd_.occ_inflate_cnt[addr]++;
-            }
-            else {
-                imd_.occ_inflate_cnt[addr]--;
-            }
-
+            forEachHashInZRun(id_shift, run.len, [&](const int& addr) {
+                imd_.occ_inflate_cnt[addr] += delta;
 #ifdef COUNTER_MAP_DEBUG
-            if (imd_.occ_inflate_cnt[addr] < 0 || imd_.occ_inflate_cnt[addr] > imd_.occ_neighbor_num) {
-                imd_.occ_inflate_cnt[addr] = 0;
-                throw std::runtime_error(" -- [IM] Negative occupancy counter, which should not happened.!");
-            }
+                if (imd_.occ_inflate_cnt[addr] < 0 || imd_.occ_inflate_cnt[addr] > imd_.occ_neighbor_num) {
+                    imd_.occ_inflate_cnt[addr] = 0;
+                    throw std::runtime_error(" -- [IM] Negative occupancy counter, which should not happened.!");
+                }
 #endif
+            });
+        }
+        inf_num_ += imd_.occ_neighbor_num;
+        inf_t_ += tc.stop();
+        updateLayerInflation(id_g, is_hit);
+    }
+
+    void InfMap::updateLayerInflation(const Vec3i& id_g, const bool is_hit) {
+        if (imd_.layers.empty()) {
+            return;
+        }
+        TimeConsuming tc("updateInflation", false);
+        const int16_t delta = is_hit ? 1 : -1;
+        for (auto& layer : imd_.layers) {
+            for (const auto& run : layer.runs) {
+                forEachHashInZRun(Vec3i(id_g + run.start), run.len, [&](const int& addr) {
+                    layer.cnt[addr] += delta;
+                });
+            }
+            inf_num_ += layer.neighbor_num;
         }
         inf_t_ += tc.stop();
     }
@@ -221,37 +439,39 @@ namespace rog_map {
             return;
         }
 
-        for (const auto& nei : cfg_.unk_inf_spherical_neighbor) {
-            const Vec3i& id_shift = id_g + nei;
+        const int16_t delta = is_add ? 1 : -1;
+        for (const auto& run : imd_.unk_neighbor_runs) {
+            const Vec3i id_shift = id_g + run.start;
 #ifdef COUNTER_MAP_DEBUG
-            if (!insideLocalMap(id_shift)) {
+            if (!insideLocalMap(id_shift) || !insideLocalMap(Vec3i(id_shift + Vec3i(0, 0, run.len - 1)))) {
                 throw std::runtime_error(" -- [IM] Unknown inflation out of map.");
             }
 #endif
-            inf_num_++;
-            const int& addr = getHashIndexFromGlobalIndex(id_shift);
-            if (is_add) {
-                imd_.unk_inflate_cnt[addr]++;
-            }
-            else {
-                imd_.unk_inflate_cnt[addr]--;
-            }
-
+            forEachHashInZRun(id_shift, run.len, [&](const int& addr) {
+                imd_.unk_inflate_cnt[addr] += delta;
 #ifdef COUNTER_MAP_DEBUG
-            // only for bug report
-            if (imd_.unk_inflate_cnt[addr] < 0 || imd_.unk_inflate_cnt[addr] > imd_.unk_neighbor_num) {
-                std::cout << "unk_inflate_cnt: " << imd_.unk_inflate_cnt[addr] << " unk_neighbor_num: "
-                          << imd_.unk_neighbor_num << std::endl;
-                throw std::runtime_error(" -- [IM] Negative occupancy counter, which should not happened.!");
-            }
+                // only for bug report
+                if (imd_.unk_inflate_cnt[addr] < 0 || imd_.unk_inflate_cnt[addr] > imd_.unk_neighbor_num) {
+                    std::cout << "unk_inflate_cnt: " << imd_.unk_inflate_cnt[addr] << " unk_neighbor_num: "
+                              << imd_.unk_neighbor_num << std::endl;
+                    throw std::runtime_error(" -- [IM] Negative occupancy counter, which should not happened.!");
+                }
 #endif
+            });
         }
+        inf_num_ += imd_.unk_neighbor_num;
         inf_t_ += tc.stop();
     }
 
     void InfMap::triggerJumpingEdge(const rog_map::Vec3i& id_g,
                                     const rog_map::GridType& from_type,
                                     const rog_map::GridType& to_type) {
+        if (cfg_.region_inflation_en) {
+            triggerJumpingEdgeBatch({{id_g, from_type, to_type}});
+            return;
+        }
+        const JumpingEdge edge{id_g, from_type, to_type};
+        logJumpingEdges(&edge, 1);
         if (from_type == GridType::OCCUPIED) {
             updateInflation(id_g, false);
         }
@@ -268,27 +488,264 @@ namespace rog_map {
         }
     }
 
-    void InfMap::resetOneCell(const int& hash_id) {
-        GridType cur_grid_type = CounterMap::getGridType(hash_id);
-        if (cur_grid_type != GridType::UNKNOWN) {
-            Vec3i id_g;
-            hashIdToGlobalIndex(hash_id, id_g);
-            triggerJumpingEdge(id_g, cur_grid_type, GridType::UNKNOWN);
+    void InfMap::triggerJumpingEdgeBatch(const std::vector<JumpingEdge>& edges) {
+        if (!cfg_.region_inflation_en) {
+            // Each edge is logged by triggerJumpingEdge
+            CounterMap::triggerJumpingEdgeBatch(edges);
+            return;
+        }
+        logJumpingEdges(edges.data(), edges.size());
+        TimeConsuming tc("updateInflation", false);
+        /* 1) Split the occupancy edges, the blocks within the inflation radius of an edge are dirty */
+        const int r = rid_.radius;
+        rid_.add_cells.clear();
+        rid_.all_blocks.clear();
+        rid_.removal_blocks.clear();
+        auto push_blocks = [r](const Vec3i& id_g, std::vector<Vec3i>& blocks) {
+            for (int bx = (id_g.x() - r) >> INF_BLOCK_BIT; bx <= (id_g.x() + r) >> INF_BLOCK_BIT; bx++) {
+                for (int by = (id_g.y() - r) >> INF_BLOCK_BIT; by <= (id_g.y() + r) >> INF_BLOCK_BIT; by++) {
+                    for (int bz = (id_g.z() - r) >> INF_BLOCK_BIT; bz <= (id_g.z() + r) >> INF_BLOCK_BIT; bz++) {
+                        blocks.emplace_back(bx, by, bz);
+                    }
+                }
+            }
+        };
+        auto sort_unique = [](std::vector<Vec3i>& blocks) {
+            std::sort(blocks.begin(), blocks.end(), [](const Vec3i& a, const Vec3i& b) {
+                return a.x() != b.x() ? a.x() < b.x() : (a.y() != b.y() ? a.y() < b.y() : a.z() < b.z());
+            });
+            blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        };
+        for (const auto& edge : edges) {
+            const bool from_occ = edge.from_type == GridType::OCCUPIED;
+            const bool to_occ = edge.to_type == GridType::OCCUPIED;
+            if (from_occ == to_occ) {
+                continue;
+            }
+            push_blocks(edge.id_g, rid_.all_blocks);
+            if (to_occ) {
+                rid_.add_cells.push_back(edge.id_g);
+            } else {
+                push_blocks(edge.id_g, rid_.removal_blocks);
+            }
+        }
+        sort_unique(rid_.all_blocks);
+        sort_unique(rid_.removal_blocks);
+
+        /* 2) Recompute all dirty blocks if it is cheaper than inflating the added cells one by one */
+        const long dense_cost = recomputeCost(rid_.all_blocks);
+        const long sparse_cost = static_cast<long>(rid_.add_cells.size()) * imd_.occ_neighbor_num +
+                                 recomputeCost(rid_.removal_blocks);
+        if (dense_cost < sparse_cost) {
+            recomputeBlocks(rid_.all_blocks);
+        } else {
+            for (const auto& id_g : rid_.add_cells) {
+                inflateOccCell(id_g);
+            }
+            recomputeBlocks(rid_.removal_blocks);
+        }
+        inf_t_ += tc.stop();
+
+        /* 3) The extra layers and the unknown inflation are still updated per cell */
+        if (!imd_.layers.empty()) {
+            for (const auto& edge : edges) {
+                if (edge.from_type == GridType::OCCUPIED) {
+                    updateLayerInflation(edge.id_g, false);
+                }
+                if (edge.to_type == GridType::OCCUPIED) {
+                    updateLayerInflation(edge.id_g, true);
+                }
+            }
+        }
+        if (cfg_.unk_inflation_en) {
+            for (const auto& edge : edges) {
+                if (edge.from_type == GridType::UNKNOWN) {
+                    updateUnkInflation(edge.id_g, false);
+                }
+                if (edge.to_type == GridType::UNKNOWN) {
+                    updateUnkInflation(edge.id_g, true);
+                }
+            }
+        }
+    }
+
+    void InfMap::inflateOccCell(const Vec3i& id_g) {
+        for (const auto& run : imd_.occ_neighbor_runs) {
+            const Vec3i id_shift = id_g + run.start;
+#ifdef COUNTER_MAP_DEBUG
+            if (!insideLocalMap(id_shift) || !insideLocalMap(Vec3i(id_shift + Vec3i(0, 0, run.len - 1)))) {
+                throw std::runtime_error(" -- [IM] inflation out of map.");
+            }
+#endif
+            forEachHashInZRun(id_shift, run.len, [&](const int& addr) {
+                imd_.occ_inflate_cnt[addr] = 1;
+            });
         }
+        inf_num_ += imd_.occ_neighbor_num;
     }
 
-    GridType InfMap::getGridType(const Vec3i& id_g) const {
+    template<class F>
+    void InfMap::forEachBlockRun(const std::vector<Vec3i>& blocks, F&& f) const {
+        /* The blocks are sorted by x, y and z, the z-consecutive blocks share one buffer */
+        for (size_t i = 0; i < blocks.size();) {
+            size_t j = i + 1;
+            while (j < blocks.size() && j - i < MAX_BLOCK_RUN && blocks[j].x() == blocks[i].x() &&
+                   blocks[j].y() == blocks[i].y() && blocks[j].z() == blocks[j - 1].z() + 1) {
+                j++;
+            }
+            f(blocks[i], static_cast<int>(j - i));
+            i = j;
+        }
+    }
+
+    long InfMap::recomputeCost(const std::vector<Vec3i>& blocks) const {
+        const long ext_xy = INF_BLOCK_SIZE + 2 * rid_.radius;
+        long cost = 0;
+        forEachBlockRun(blocks, [&](const Vec3i&, const int& block_num) {
+            const long ext_z = block_num * INF_BLOCK_SIZE + 2 * rid_.radius;
+            cost += (ext_xy + INF_BLOCK_SIZE) * ext_xy * ext_z;
+        });
+        return cost;
+    }
+
+    void InfMap::recomputeBlocks(const std::vector<Vec3i>& blocks) {
+        forEachBlockRun(blocks, [this](const Vec3i& block, const int& block_num) {
+            recomputeOccInflation(block, block_num);
+        });
+    }
+
+    void InfMap::recomputeOccInflation(const Vec3i& block, const int& block_num) {
+        const int r = rid_.radius;
+        const int ext_xy = INF_BLOCK_SIZE + 2 * r;
+        const int ext_z = block_num * INF_BLOCK_SIZE + 2 * r;
+        const Vec3i block_min = block * INF_BLOCK_SIZE;
+        const Vec3i block_max = block_min + Vec3i(INF_BLOCK_SIZE - 1, INF_BLOCK_SIZE - 1,
+                                                  block_num * INF_BLOCK_SIZE - 1);
+        const Vec3i cell_min = block_min.cwiseMax(local_map_bound_min_i_);
+        const Vec3i cell_max = block_max.cwiseMin(local_map_bound_max_i_);
+        if ((cell_min.array() > cell_max.array()).any()) {
+            return;
+        }
+        const Vec3i ext_min = block_min - Vec3i::Constant(r);
+        const Vec3i ext_max = block_max + Vec3i::Constant(r);
+
+        /* 1) Load the occupancy of the blocks extended by the radius, the cells out of the
+         *    local map are free. The buffer is x-major, the same as the flat layout. A cell
+         *    farther than the radius from the blocks never changes the capped distance.
+         * */
+        auto& dist = rid_.block_dist;
+        dist.assign(ext_xy * ext_xy * ext_z, rid_.sqr_dist_cap);
+        const int z_lo = std::max(ext_min.z(), local_map_bound_min_i_.z());
+        const int z_hi = std::min(ext_max.z(), local_map_bound_max_i_.z());
+        for (int ex = 0; ex < ext_xy; ex++) {
+            for (int ey = 0; ey < ext_xy; ey++) {
+                const Vec3i col(ext_min.x() + ex, ext_min.y() + ey, z_lo);
+                if (z_lo > z_hi || !insideLocalMap(col)) {
+                    continue;
+                }
+                int* line = &dist[(ex * ext_xy + ey) * ext_z];
+                int k = z_lo - ext_min.z();
+                forEachHashInZRun(col, z_hi - z_lo + 1, [&](const int& addr) {
+                    if (CounterMap::isOccupied(addr)) {
+                        line[k] = 0;
+                    }
+                    k++;
+                });
+            }
+        }
+
+        /* 2) The separable squared distance transform along z, y and x, each pass only
+         *    computes the lines read by the next one
+         * */
+        const int xy_lo = r, xy_hi = r + INF_BLOCK_SIZE;
+        const int z_in_lo = cell_min.z() - ext_min.z(), z_in_hi = cell_max.z() - ext_min.z() + 1;
+        for (int ex = 0; ex < ext_xy; ex++) {
+            for (int ey = 0; ey < ext_xy; ey++) {
+                sqrDistTransform1D(&dist[(ex * ext_xy + ey) * ext_z], ext_z, 1);
+            }
+        }
+        for (int ex = 0; ex < ext_xy; ex++) {
+            for (int ez = z_in_lo; ez < z_in_hi; ez++) {
+                sqrDistTransform1D(&dist[ex * ext_xy * ext_z + ez], ext_xy, ext_z);
+            }
+        }
+        for (int ey = xy_lo; ey < xy_hi; ey++) {
+            for (int ez = z_in_lo; ez < z_in_hi; ez++) {
+                sqrDistTransform1D(&dist[ey * ext_z + ez], ext_xy, ext_xy * ext_z);
+            }
+        }
+
+        /* 3) Write back the cells of the blocks inside the local map */
+        for (int x = cell_min.x(); x <= cell_max.x(); x++) {
+            for (int y = cell_min.y(); y <= cell_max.y(); y++) {
+                const int* line = &dist[((x - ext_min.x()) * ext_xy + (y - ext_min.y())) * ext_z];
+                int k = z_in_lo;
+                forEachHashInZRun(Vec3i(x, y, cell_min.z()), cell_max.z() - cell_min.z() + 1, [&](const int& addr) {
+                    imd_.occ_inflate_cnt[addr] = line[k] <= rid_.sqr_radius ? 1 : 0;
+                    k++;
+                });
+                inf_num_ += cell_max.z() - cell_min.z() + 1;
+            }
+        }
+    }
+
+    void InfMap::sqrDistTransform1D(int* data, const int& n, const int& stride) {
+        /* The lower envelope of parabolas by Felzenszwalb and Huttenlocher, the result is
+         * capped at sqr_dist_cap, so a line without a closer cell is left untouched
+         * */
+        auto& f = rid_.line_f;
+        auto& v = rid_.env_v;
+        auto& z = rid_.env_z;
+        f.resize(n);
+        v.resize(n);
+        z.resize(n + 1);
+        bool has_near{false};
+        for (int q = 0; q < n; q++) {
+            f[q] = data[q * stride];
+            has_near |= f[q] < rid_.sqr_dist_cap;
+        }
+        if (!has_near) {
+            return;
+        }
+        int k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::max();
+        z[1] = std::numeric_limits<double>::max();
+        for (int q = 1; q < n; q++) {
+            double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+            while (s <= z[k]) {
+                k--;
+                s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = std::numeric_limits<double>::max();
+        }
+        k = 0;
+        for (int q = 0; q < n; q++) {
+            while (z[k + 1] < q) {
+                k++;
+            }
+            data[q * stride] = std::min((q - v[k]) * (q - v[k]) + f[v[k]], rid_.sqr_dist_cap);
+        }
+    }
+
+    GridType InfMap::getGridType(const Vec3i& id_g, const int& layer_id) const {
         if (!insideLocalMap(id_g)) {
             return OUT_OF_MAP;
         }
         Vec3i id_l;
         globalIndexToLocalIndex(id_g, id_l);
-        int addr = getLocalIndexHash(id_l);
+        return getGridTypeOfHash(getLocalIndexHash(id_l), layer_id);
+    }
+
+    GridType InfMap::getGridTypeOfHash(const int& hash_id, const int& layer_id) const {
         // The Occupied is defined by inflation layer
-        if (imd_.occ_inflate_cnt[addr] > 0) {
+        if (getOccInflateCnt(hash_id, layer_id) > 0) {
             return OCCUPIED;
         }
-        else if (cfg_.unk_inflation_en && imd_.unk_inflate_cnt[addr] > 0) {
+        else if (cfg_.unk_inflation_en && imd_.unk_inflate_cnt[hash_id] > 0) {
             return UNKNOWN;
         }
         else {
@@ -296,15 +753,20 @@ namespace rog_map {
         }
     }
 
-    GridType InfMap::getGridType(const Vec3f& pos) const {
-        Vec3i id_g, id_l;
+    bool InfMap::isInflatedVirtualHeight(const double& z, const int& layer_id) const {
+        // Same as the base layer, the virtual ceil and ground are inflated by the step of the layer
+        const double margin = cfg_.inflation_resolution * (1 + getLayerStep(layer_id));
+        return z >= cfg_.virtual_ceil_height - margin || z <= cfg_.virtual_ground_height + margin;
+    }
+
+    GridType InfMap::getGridType(const Vec3f& pos, const int& layer_id) const {
+        Vec3i id_g;
         // 1. check virtual ceil and ground
-        if (pos.z() >= cfg_.virtual_ceil_height - cfg_.inflation_resolution * (1 + cfg_.inflation_step) ||
-            pos.z() <= cfg_.virtual_ground_height + cfg_.inflation_resolution * (1 + cfg_.inflation_step)) {
+        if (isInflatedVirtualHeight(pos.z(), layer_id)) {
             return OCCUPIED;
         }
         posToGlobalIndex(pos, id_g);
         // 2. get true grid type
-        return getGridType(id_g);
+        return getGridType(id_g, layer_id);
     }
 }
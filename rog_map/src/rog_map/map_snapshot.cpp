@@ -0,0 +1,168 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <rog_map/rog_map_core/map_snapshot.h>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace color_text;
+
+namespace rog_map {
+
+    MapSnapshot::~MapSnapshot() {
+        close();
+    }
+
+    void MapSnapshot::close() {
+        if (addr_ != nullptr) {
+            munmap(addr_, file_size_);
+            addr_ = nullptr;
+        }
+        file_size_ = 0;
+        offsets_.clear();
+    }
+
+    bool MapSnapshot::save(const std::string &file_name, const Vec3i &origin_i,
+                           const std::vector<double> &params, const std::vector<SnapshotBuffer> &buffers) {
+        const std::string tmp_name = file_name + ".tmp";
+        {
+            std::ofstream file(tmp_name, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return false;
+            }
+            FileHeader header;
+            for (int i = 0; i < 3; i++) {
+                header.origin_i[i] = origin_i[i];
+            }
+            header.param_num = static_cast<uint32_t>(params.size());
+            header.buffer_num = buffers.size();
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(params.data()), params.size() * sizeof(double));
+            for (const auto &buffer: buffers) {
+                const uint64_t size = buffer.size;
+                file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            }
+            for (const auto &buffer: buffers) {
+                file.write(buffer.data, buffer.size);
+            }
+            file.flush();
+            if (!file.good()) {
+                std::remove(tmp_name.c_str());
+                return false;
+            }
+        }
+        return std::rename(tmp_name.c_str(), file_name.c_str()) == 0;
+    }
+
+    bool MapSnapshot::open(const std::string &file_name, const std::vector<double> &params,
+                           const std::vector<SnapshotBuffer> &buffers) {
+        close();
+        const int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << YELLOW << " -- [MapSnapshot] Cannot open [" << file_name << "]." << RESET << std::endl;
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+            std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] is not a snapshot." << RESET << std::endl;
+            ::close(fd);
+            return false;
+        }
+        file_size_ = static_cast<size_t>(st.st_size);
+        addr_ = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the file is closed
+        ::close(fd);
+        if (addr_ == MAP_FAILED) {
+            addr_ = nullptr;
+            std::cout << YELLOW << " -- [MapSnapshot] Cannot map [" << file_name << "]." << RESET << std::endl;
+            return false;
+        }
+
+        const char *base = static_cast<const char *>(addr_);
+        FileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, FileHeader().magic, sizeof(header.magic)) != 0) {
+            std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] is not a snapshot." << RESET << std::endl;
+            close();
+            return false;
+        }
+        if (header.param_num != params.size() || header.buffer_num != buffers.size()) {
+            std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] was saved with another map config."
+                      << RESET << std::endl;
+            close();
+            return false;
+        }
+        size_t offset = sizeof(header);
+        const size_t table_size = params.size() * sizeof(double) + buffers.size() * sizeof(uint64_t);
+        if (file_size_ < offset + table_size) {
+            std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] is truncated." << RESET << std::endl;
+            close();
+            return false;
+        }
+        for (size_t i = 0; i < params.size(); i++) {
+            double value;
+            std::memcpy(&value, base + offset, sizeof(value));
+            offset += sizeof(value);
+            if (value != params[i]) {
+                std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] was saved with another map config, "
+                          << "param " << i << " is " << value << " instead of " << params[i] << "." << RESET
+                          << std::endl;
+                close();
+                return false;
+            }
+        }
+        size_t data_offset = offset + buffers.size() * sizeof(uint64_t);
+        offsets_.resize(buffers.size());
+        for (size_t i = 0; i < buffers.size(); i++) {
+            uint64_t size;
+            std::memcpy(&size, base + offset, sizeof(size));
+            offset += sizeof(size);
+            if (size != buffers[i].size) {
+                std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] was saved with another map size."
+                          << RESET << std::endl;
+                close();
+                return false;
+            }
+            offsets_[i] = data_offset;
+            data_offset += size;
+        }
+        if (data_offset != file_size_) {
+            std::cout << YELLOW << " -- [MapSnapshot] [" << file_name << "] is truncated." << RESET << std::endl;
+            close();
+            return false;
+        }
+        origin_i_ = Vec3i(header.origin_i[0], header.origin_i[1], header.origin_i[2]);
+        return true;
+    }
+
+    void MapSnapshot::copyTo(const std::vector<SnapshotBuffer> &buffers) const {
+        const char *base = static_cast<const char *>(addr_);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            std::memcpy(buffers[i].data, base + offsets_[i], buffers[i].size);
+        }
+    }
+}
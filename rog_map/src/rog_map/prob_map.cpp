@@ -33,8 +33,10 @@ void ProbMap::initProbMap() {
     init_once = true;
     initSlidingMap(cfg_.half_map_size_i, cfg_.resolution,
                    cfg_.map_sliding_en, cfg_.map_sliding_thresh,
-                   cfg_.fix_map_origin);
+                   cfg_.fix_map_origin, cfg_.brick_layout_en);
     time_consuming_.resize(7);
+    last_map_save_t_ = std::chrono::steady_clock::now();
+    initLogOddsParam();
     inf_map_ = std::make_shared<InfMap>(cfg_);
 
 
@@ -55,7 +57,27 @@ void ProbMap::initProbMap() {
                                cfg_.map_sliding_en,
                                cfg_.map_sliding_thresh,
                                cfg_.fix_map_origin,
-                               cfg_.unk_thresh);
+                               cfg_.unk_thresh,
+                               cfg_.esdf_incremental_update_en,
+                               cfg_.esdf_max_dist,
+                               cfg_.esdf_thread_num,
+                               cfg_.esdf_incremental_fallback_ratio);
+    }
+
+    if (cfg_.global_map_en) {
+        global_map_ = std::make_shared<GlobalMap<LogOdds>>();
+    }
+
+    if (cfg_.clearance_en) {
+        clr_map_ = std::make_shared<ClearanceMap>();
+        clr_map_->initClearanceMap(cfg_.half_map_size_i,
+                                   cfg_.resolution,
+                                   cfg_.clearance_max_step,
+                                   cfg_.map_sliding_en,
+                                   cfg_.map_sliding_thresh,
+                                   cfg_.fix_map_origin,
+                                   cfg_.unk_thresh,
+                                   cfg_.brick_layout_en);
     }
 
 
@@ -69,6 +91,10 @@ void ProbMap::initProbMap() {
     cout<<"[ProbMap] virtual_ceil_height: "<<cfg_.virtual_ceil_height<<endl;
     cout<< "[ProbMap] virtual_ground_height: "<<cfg_.virtual_ground_height<<endl;
 
+    if (cfg_.frontier_extraction_en && cfg_.frontier_cluster_en) {
+        fcnt_map_->initFrontierIndex();
+    }
+
     if (!cfg_.map_sliding_en) {
         std::cout << YELLOW << " -- [ProbMap] Map sliding disabled, set origin to [" << cfg_.fix_map_origin.transpose()
             << "] -- " << RESET << std::endl;
@@ -76,13 +102,32 @@ void ProbMap::initProbMap() {
     }
 
 
-    int map_size = sc_.map_size_i.prod();
+    int map_size = sc_.map_vox_num;
 
 
     occupancy_buffer_.resize(map_size, 0);
+    occupied_bits_.resize((map_size + 63) / 64, 0);
+    unknown_bits_.resize((map_size + 63) / 64, ~uint64_t(0));
     raycast_data_.raycaster.setResolution(cfg_.resolution);
-    raycast_data_.operation_cnt.resize(map_size, 0);
-    raycast_data_.hit_cnt.resize(map_size, 0);
+    raycast_data_.cell_counter.resize(map_size, RaycastData::CellCounter{0, 0, 0});
+
+    raycast_data_.thread_pool = std::make_shared<ThreadPool>(cfg_.raycast_thread_num);
+    const int worker_num = raycast_data_.thread_pool->size();
+    raycast_data_.workers.resize(worker_num);
+    raycast_data_.hash_range_per_worker = (map_size + worker_num - 1) / worker_num;
+    for (auto &worker: raycast_data_.workers) {
+        worker.raycaster.setResolution(cfg_.resolution);
+        worker.buckets.resize(worker_num);
+    }
+    if (worker_num > 1) {
+        std::cout << GREEN << " -- [ProbMap] Parallel raycasting with " << worker_num << " threads." << RESET
+                  << std::endl;
+    }
+
+    if (cfg_.pipeline_update_en) {
+        pipeline_.apply_thread = std::thread(&ProbMap::applyThreadLoop, this);
+        std::cout << GREEN << " -- [ProbMap] Pipelined map update enabled." << RESET << std::endl;
+    }
 
     resetLocalMap();
 
@@ -90,6 +135,56 @@ void ProbMap::initProbMap() {
     printMapInformation();
 }
 
+void ProbMap::initLogOddsParam() {
+#if ROG_MAP_LOG_ODDS_BITS == 32
+    log_odds_.hit = cfg_.l_hit;
+    log_odds_.miss = cfg_.l_miss;
+    log_odds_.min = cfg_.l_min;
+    log_odds_.max = cfg_.l_max;
+    log_odds_.occ = cfg_.l_occ;
+    log_odds_.free = cfg_.l_free;
+    log_odds_.scale = 1.0;
+#else
+    // Use the whole range of the storage type for the clamped log-odds
+    const double l_abs_max = std::max(std::fabs(cfg_.l_min), std::fabs(cfg_.l_max));
+    log_odds_.scale = std::numeric_limits<LogOdds>::max() / l_abs_max;
+    auto quantize = [this](const float& l) {
+        return static_cast<LogOddsAcc>(std::lround(l * log_odds_.scale));
+    };
+    log_odds_.hit = quantize(cfg_.l_hit);
+    log_odds_.miss = quantize(cfg_.l_miss);
+    log_odds_.min = quantize(cfg_.l_min);
+    log_odds_.max = quantize(cfg_.l_max);
+    log_odds_.occ = quantize(cfg_.l_occ);
+    log_odds_.free = quantize(cfg_.l_free);
+    if (log_odds_.hit == 0 || log_odds_.miss == 0) {
+        throw std::invalid_argument(" -- [ProbMap] l_hit or l_miss is too small for the quantized log-odds.");
+    }
+    const double miss_err = std::fabs(log_odds_.miss / log_odds_.scale - cfg_.l_miss) / std::fabs(cfg_.l_miss);
+    const double hit_err = std::fabs(log_odds_.hit / log_odds_.scale - cfg_.l_hit) / std::fabs(cfg_.l_hit);
+    if (std::max(miss_err, hit_err) > 0.05) {
+        std::cout << YELLOW << " -- [ProbMap] The quantized l_hit/l_miss error is larger than 5%, "
+                  << "consider using more log-odds bits." << RESET << std::endl;
+    }
+    std::cout << GREEN << " -- [ProbMap] " << ROG_MAP_LOG_ODDS_BITS << " bits log-odds, hit: " << log_odds_.hit
+              << " miss: " << log_odds_.miss << " occ: " << log_odds_.occ << " free: " << log_odds_.free
+              << " scale: " << log_odds_.scale << RESET << std::endl;
+#endif
+}
+
+ProbMap::~ProbMap() {
+    // The save waits for the pending update, so it runs before the apply thread stops
+    autoSaveMaps(true);
+    if (pipeline_.apply_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lck(pipeline_.mtx);
+            pipeline_.stop = true;
+        }
+        pipeline_.cv.notify_all();
+        pipeline_.apply_thread.join();
+    }
+}
+
 Vec3f ProbMap::getLocalMapOrigin() const {
     return local_map_origin_d_;
 }
@@ -166,6 +261,32 @@ bool ProbMap::isOccupied(const Vec3i& id_g) const {
     return isOccupied(occupancy_buffer_[getHashIndexFromGlobalIndex(id_g)]);
 }
 
+bool ProbMap::isSphereFree(const Vec3i& id_g, const int& step) const {
+    const Vec3i step_v = Vec3i::Constant(step);
+    if (cfg_.clearance_en && step <= clr_map_->getMaxStep() &&
+        (id_g - step_v - local_map_bound_min_i_).minCoeff() >= 0 &&
+        (local_map_bound_max_i_ - id_g - step_v).minCoeff() >= 0) {
+        // The nearest cells of the virtual ceil and ground are straight above and below
+        if (id_g.z() + step > sc_.virtual_ceil_height_id_g ||
+            id_g.z() - step < sc_.virtual_ground_height_id_g + sc_.safe_margin_i) {
+            return false;
+        }
+        return clr_map_->getClearanceSqr(id_g) > step * step;
+    }
+    const int sqr_step = step * step;
+    Vec3i nei;
+    for (nei.x() = -step; nei.x() <= step; nei.x()++) {
+        for (nei.y() = -step; nei.y() <= step; nei.y()++) {
+            for (nei.z() = -step; nei.z() <= step; nei.z()++) {
+                if (nei.squaredNorm() <= sqr_step && isOccupied(Vec3i(id_g + nei))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 bool ProbMap::isUnknown(const Vec3i& id_g) const {
     if (!insideLocalMap(id_g)) {
         return true;
@@ -206,13 +327,23 @@ bool ProbMap::isFrontier(const Vec3i& id_g) const {
     return false;
 }
 
+void ProbMap::getFrontierClusters(std::vector<FreeCntMap::FrontierCluster>& clusters) const {
+    if (!cfg_.frontier_extraction_en || !cfg_.frontier_cluster_en) {
+        clusters.clear();
+        return;
+    }
+    // The lazy split mutates the clusters, which the map thread inserts and erases under the write lock
+    const auto view = getReadView();
+    fcnt_map_->getFrontierClusters(clusters);
+}
+
 bool ProbMap::isKnownFreeInflate(const Vec3f& pos) const {
     return inf_map_->isKnownFreeInflate(pos);
 }
 
 
-bool ProbMap::isOccupiedInflate(const Vec3f& pos) const {
-    return inf_map_->isOccupiedInflate(pos);
+bool ProbMap::isOccupiedInflate(const Vec3f& pos, const int& layer_id) const {
+    return inf_map_->isOccupiedInflate(pos, layer_id);
 }
 
 bool ProbMap::isUnknownInflate(const Vec3f& pos) const {
@@ -223,6 +354,7 @@ bool ProbMap::isUnknownInflate(const Vec3f& pos) const {
 
 
 void ProbMap::writeTimeConsumingToLog(std::ofstream& log_file) {
+    std::lock_guard<std::mutex> lck(time_mtx_);
     for (long unsigned int i = 0; i < time_consuming_.size(); i++) {
         log_file << time_consuming_[i];
         if (i != time_consuming_.size() - 1)
@@ -252,6 +384,7 @@ void ProbMap::writeMapInfoToLog(std::ofstream& log_file) {
     log_file << "\tvirtual_ground_height: " << cfg_.virtual_ground_height << std::endl;
     log_file << "\tbatch_update_size: " << cfg_.batch_update_size << std::endl;
     log_file << "\tfrontier_extraction_en: " << cfg_.frontier_extraction_en << std::endl;
+    log_file << "\tfrontier_cluster_en: " << cfg_.frontier_cluster_en << std::endl;
     inf_map_->writeMapInfoToLog(log_file);
 }
 
@@ -278,7 +411,7 @@ void ProbMap::updateOccPointCloud(const PointCloud& input_cloud) {
             continue;
         }
         if (insideLocalMap(pt_id_g)) {
-            const int occ_hit_num = ceil(cfg_.l_occ / cfg_.l_hit);
+            const int occ_hit_num = ceil(static_cast<float>(log_odds_.occ) / log_odds_.hit);
             for (int j = 0; j < occ_hit_num; j++) {
                 insertUpdateCandidate(pt_id_g, true);
             }
@@ -295,24 +428,314 @@ void ProbMap::updateOccPointCloud(const PointCloud& input_cloud) {
 }
 
 void ProbMap::slideAllMap(const rog_map::Vec3f& pos) {
+    const Vec3i old_bound_min = local_map_bound_min_i_, old_bound_max = local_map_bound_max_i_;
+    if (cfg_.global_map_en) {
+        // A jump farther than the map size clears the whole map instead of sliding the slabs
+        Vec3i new_origin_i;
+        posToGlobalIndex(pos, new_origin_i);
+        if (((new_origin_i - local_map_origin_i_).cwiseAbs() - sc_.map_size_i).maxCoeff() > 0) {
+            writeBackLocalMap();
+        }
+    }
     mapSliding(pos);
     inf_map_->mapSliding(pos);
     if (cfg_.frontier_extraction_en) {
         fcnt_map_->mapSliding(pos);
+        updateFrontierIndexBox();
     }
     if (cfg_.esdf_en) {
         esdf_map_->mapSliding(pos);
     }
+    if (cfg_.clearance_en) {
+        clr_map_->mapSliding(pos);
+    }
+    // All maps have slid, so the paged in cells can trigger their jumping edges
+    if (cfg_.global_map_en) {
+        pageInGlobalMap(local_map_bound_min_i_, local_map_bound_max_i_, old_bound_min, old_bound_max);
+    }
+}
+
+void ProbMap::updateFrontierIndexBox() {
+    // Same height range as isFrontier
+    Vec3i box_min = local_map_bound_min_i_, box_max = local_map_bound_max_i_;
+    box_min.z() = std::max(box_min.z(), sc_.virtual_ground_height_id_g + sc_.safe_margin_i);
+    box_max.z() = std::min(box_max.z(), sc_.virtual_ceil_height_id_g);
+    fcnt_map_->setFrontierIndexBox(box_min, box_max);
+}
+
+void ProbMap::writeBackLocalMap() {
+    Vec3i id_g;
+    const int z_len = local_map_bound_max_i_.z() - local_map_bound_min_i_.z() + 1;
+    for (id_g.x() = local_map_bound_min_i_.x(); id_g.x() <= local_map_bound_max_i_.x(); id_g.x()++) {
+        for (id_g.y() = local_map_bound_min_i_.y(); id_g.y() <= local_map_bound_max_i_.y(); id_g.y()++) {
+            id_g.z() = local_map_bound_min_i_.z();
+            forEachHashInZRun(id_g, z_len, [&](const int& hash_id) {
+                const LogOdds& ret = occupancy_buffer_[hash_id];
+                global_map_->writeCell(id_g, isUnknown(ret) ? LogOdds(0) : ret);
+                id_g.z()++;
+            });
+        }
+    }
+}
+
+void ProbMap::pageInGlobalMap(const Vec3i& box_min, const Vec3i& box_max,
+                              const Vec3i& skip_min, const Vec3i& skip_max) {
+    using Store = GlobalMap<LogOdds>;
+    auto inside_skip = [&](const Vec3i& id_min, const Vec3i& id_max) {
+        return (id_min - skip_min).minCoeff() >= 0 && (skip_max - id_max).minCoeff() >= 0;
+    };
+    const Vec3i brick_min = Store::brickIndex(box_min), brick_max = Store::brickIndex(box_max);
+    Vec3i brick_id;
+    for (brick_id.x() = brick_min.x(); brick_id.x() <= brick_max.x(); brick_id.x()++) {
+        for (brick_id.y() = brick_min.y(); brick_id.y() <= brick_max.y(); brick_id.y()++) {
+            for (brick_id.z() = brick_min.z(); brick_id.z() <= brick_max.z(); brick_id.z()++) {
+                const Vec3i cell_min = (brick_id * Store::BRICK_SIZE).cwiseMax(box_min);
+                const Vec3i cell_max = (brick_id * Store::BRICK_SIZE + Vec3i::Constant(Store::BRICK_MASK)).cwiseMin(box_max);
+                if (inside_skip(cell_min, cell_max)) {
+                    continue;
+                }
+                const Store::Brick* brick = global_map_->findBrick(brick_id);
+                if (brick == nullptr) {
+                    continue;
+                }
+                Vec3i id_g;
+                for (id_g.x() = cell_min.x(); id_g.x() <= cell_max.x(); id_g.x()++) {
+                    for (id_g.y() = cell_min.y(); id_g.y() <= cell_max.y(); id_g.y()++) {
+                        for (id_g.z() = cell_min.z(); id_g.z() <= cell_max.z(); id_g.z()++) {
+                            const LogOdds value = (*brick)[Store::cellOffset(id_g)];
+                            if (value == 0 || inside_skip(id_g, id_g)) {
+                                continue;
+                            }
+                            const int hash_id = getHashIndexFromGlobalIndex(id_g);
+                            LogOdds& ret = occupancy_buffer_[hash_id];
+                            if (!isUnknown(ret)) {
+                                continue;
+                            }
+                            ret = value;
+                            const GridType to_type = isOccupied(ret) ? OCCUPIED : KNOWN_FREE;
+                            setStateBits(hash_id, to_type);
+                            triggerJumpingEdge(hash_id, UNKNOWN, to_type);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    flushJumpingEdges();
+}
+
+bool ProbMap::saveGlobalMap(const std::string& file_name) {
+    if (!cfg_.global_map_en) {
+        std::cout << YELLOW << " -- [ProbMap] Global map is not enabled, cannot save it." << RESET << std::endl;
+        return false;
+    }
+    waitForPendingUpdate();
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_);
+    applyDeferredBatches();
+    return writeGlobalMap(file_name);
+}
+
+bool ProbMap::writeGlobalMap(const std::string& file_name) {
+    writeBackLocalMap();
+    if (!global_map_->save(file_name, sc_.resolution, log_odds_.scale)) {
+        std::cout << YELLOW << " -- [ProbMap] Save global map to [" << file_name << "] failed." << RESET << std::endl;
+        return false;
+    }
+    std::cout << GREEN << " -- [ProbMap] Save " << global_map_->getBrickNum() << " global map bricks to ["
+              << file_name << "]." << RESET << std::endl;
+    return true;
+}
+
+bool ProbMap::loadGlobalMap(const std::string& file_name) {
+    if (!cfg_.global_map_en) {
+        std::cout << YELLOW << " -- [ProbMap] Global map is not enabled, cannot load it." << RESET << std::endl;
+        return false;
+    }
+    waitForPendingUpdate();
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_);
+    if (!global_map_->load(file_name, sc_.resolution, log_odds_.scale)) {
+        std::cout << YELLOW << " -- [ProbMap] Load global map from [" << file_name
+                  << "] failed, the file is missing or built with another resolution." << RESET << std::endl;
+        return false;
+    }
+    // An empty skip box, all unknown cells of the local map are filled
+    pageInGlobalMap(local_map_bound_min_i_, local_map_bound_max_i_, Vec3i::Ones(), Vec3i::Zero());
+    map_empty_ = false;
+    map_epoch_++;
+    std::cout << GREEN << " -- [ProbMap] Load " << global_map_->getBrickNum() << " global map bricks from ["
+              << file_name << "]." << RESET << std::endl;
+    return true;
+}
+
+void ProbMap::autoSaveMaps(const bool& on_exit) {
+    if ((!cfg_.save_snapshot_en && !cfg_.save_global_map_en) || map_empty_) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (!on_exit && (cfg_.map_save_period <= 0 ||
+                     std::chrono::duration<double>(now - last_map_save_t_).count() < cfg_.map_save_period)) {
+        return;
+    }
+    waitForPendingUpdate();
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_, std::defer_lock);
+    if (on_exit) {
+        lck.lock();
+    }
+    else if (!lck.try_lock()) {
+        // Same as the sliding, a read view is alive, so the save is left to a later frame
+        return;
+    }
+    last_map_save_t_ = now;
+    applyDeferredBatches();
+    if (cfg_.save_snapshot_en) {
+        writeSnapshot(cfg_.snapshot_name);
+    }
+    if (cfg_.save_global_map_en) {
+        writeGlobalMap(cfg_.global_map_name);
+    }
+}
+
+std::vector<double> ProbMap::getSnapshotParams() const {
+    std::vector<double> params;
+    params.push_back(sizeof(LogOdds));
+    params.push_back(cfg_.resolution);
+    params.push_back(cfg_.inflation_resolution);
+    params.push_back(cfg_.inflation_step);
+    params.push_back(cfg_.unk_inflation_en ? cfg_.unk_inflation_step : 0);
+    params.push_back(cfg_.region_inflation_en);
+    params.push_back(cfg_.brick_layout_en);
+    for (int i = 0; i < 3; i++) {
+        params.push_back(sc_.map_size_i[i]);
+    }
+    for (const auto& value : {log_odds_.hit, log_odds_.miss, log_odds_.min, log_odds_.max,
+                              log_odds_.occ, log_odds_.free}) {
+        params.push_back(static_cast<double>(value));
+    }
+    params.push_back(log_odds_.scale);
+    for (const auto& step : cfg_.inflation_layer_steps) {
+        params.push_back(step);
+    }
+    return params;
+}
+
+void ProbMap::getSnapshotBuffers(std::vector<SnapshotBuffer>& buffers) {
+    buffers.push_back(makeSnapshotBuffer(occupancy_buffer_));
+    buffers.push_back(makeSnapshotBuffer(occupied_bits_));
+    buffers.push_back(makeSnapshotBuffer(unknown_bits_));
+    inf_map_->getSnapshotBuffers(buffers);
+}
+
+bool ProbMap::saveSnapshot(const std::string& file_name) {
+    waitForPendingUpdate();
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_);
+    applyDeferredBatches();
+    return writeSnapshot(file_name);
+}
+
+bool ProbMap::writeSnapshot(const std::string& file_name) {
+    std::vector<SnapshotBuffer> buffers;
+    getSnapshotBuffers(buffers);
+    if (!MapSnapshot::save(file_name, local_map_origin_i_, getSnapshotParams(), buffers)) {
+        std::cout << YELLOW << " -- [ProbMap] Save snapshot to [" << file_name << "] failed." << RESET << std::endl;
+        return false;
+    }
+    std::cout << GREEN << " -- [ProbMap] Save snapshot to [" << file_name << "]." << RESET << std::endl;
+    return true;
+}
+
+bool ProbMap::loadSnapshot(const std::string& file_name) {
+    waitForPendingUpdate();
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_);
+    std::vector<SnapshotBuffer> buffers;
+    getSnapshotBuffers(buffers);
+    MapSnapshot snapshot;
+    if (!snapshot.open(file_name, getSnapshotParams(), buffers)) {
+        std::cout << YELLOW << " -- [ProbMap] Load snapshot from [" << file_name << "] failed." << RESET << std::endl;
+        return false;
+    }
+    const Vec3i& origin_i = snapshot.getOrigin();
+    if (!cfg_.map_sliding_en && origin_i != local_map_origin_i_) {
+        std::cout << YELLOW << " -- [ProbMap] Load snapshot from [" << file_name
+                  << "] failed, it was saved at another fixed map origin." << RESET << std::endl;
+        return false;
+    }
+
+    /* 1) Clear all layers at the origin of the snapshot. The prob map is moved without
+     * sliding, which would write its reset cells back to the global map.
+     * */
+    Vec3f origin_pos;
+    globalIndexToPos(origin_i, origin_pos);
+    resetLocalMap();
+    updateLocalMapOriginAndBound(origin_i.cast<double>() * sc_.resolution, origin_i);
+    inf_map_->resetLocalMap();
+    inf_map_->mapSliding(origin_pos);
+    if (cfg_.frontier_extraction_en) {
+        fcnt_map_->resetLocalMap();
+        fcnt_map_->mapSliding(origin_pos);
+        updateFrontierIndexBox();
+    }
+    if (cfg_.esdf_en) {
+        esdf_map_->resetLocalMap();
+        esdf_map_->mapSliding(origin_pos);
+    }
+    if (cfg_.clearance_en) {
+        clr_map_->resetLocalMap();
+        clr_map_->mapSliding(origin_pos);
+    }
+
+    /* 2) The prob map and the inflation counters are copied from the mapped file */
+    snapshot.copyTo(buffers);
+
+    /* 3) The other layers take the jumping edges of the known cells, in chunks to bound
+     * the memory of the edges. The inflation counters are loaded, so they are skipped.
+     * */
+    if (cfg_.frontier_extraction_en || cfg_.esdf_en || cfg_.clearance_en) {
+        static constexpr size_t EDGE_CHUNK_SIZE = 1 << 16;
+        auto flush_edges = [&]() {
+            if (cfg_.esdf_en) {
+                esdf_map_->updateGridCounterBatch(jumping_edges_);
+            }
+            if (cfg_.clearance_en) {
+                clr_map_->updateGridCounterBatch(jumping_edges_);
+            }
+            jumping_edges_.clear();
+        };
+        forEachCellHash([&](const int& hash_id) {
+            const LogOdds& ret = occupancy_buffer_[hash_id];
+            if (isUnknown(ret)) {
+                return;
+            }
+            triggerJumpingEdge(hash_id, UNKNOWN, isOccupied(ret) ? OCCUPIED : KNOWN_FREE);
+            if (jumping_edges_.size() >= EDGE_CHUNK_SIZE) {
+                flush_edges();
+            }
+        });
+        flush_edges();
+    }
+    map_empty_ = false;
+    map_epoch_++;
+    std::cout << GREEN << " -- [ProbMap] Load snapshot from [" << file_name << "] at origin ["
+              << origin_pos.transpose() << "]." << RESET << std::endl;
+    return true;
 }
 
 void ProbMap::updateProbMap(const PointCloud& cloud, const Pose& pose) {
     TimeConsuming tc("updateMap", false);
     const Vec3f& pos = pose.first;
-    time_consuming_[4] = cloud.size();
+    setTimeConsuming(4, cloud.size());
     if (cfg_.map_sliding_en && !insideLocalMap(pos) && raycast_data_.batch_update_counter == 0) {
-        std::cout << YELLOW << " -- [ROGMapCore] cur_pose out of map range, reset the map." << RESET << std::endl;
-        std::cout << YELLOW << " -- [ROGMapCore] Sliding to map center at: " << pos.transpose() << RESET << std::endl;
-        slideAllMap(pos);
+        // The sliding changes the hash layout, so it waits for the pending and queued updates,
+        // and it is left to a later frame while a read view is alive
+        waitForPendingUpdate();
+        std::unique_lock<std::shared_mutex> lck(map_rw_mtx_, std::try_to_lock);
+        if (lck.owns_lock()) {
+            std::cout << YELLOW << " -- [ROGMapCore] cur_pose out of map range, reset the map." << RESET << std::endl;
+            std::cout << YELLOW << " -- [ROGMapCore] Sliding to map center at: " << pos.transpose() << RESET
+                << std::endl;
+            applyDeferredBatches();
+            slideAllMap(pos);
+            map_epoch_++;
+        }
         return;
     }
 
@@ -331,34 +754,91 @@ void ProbMap::updateProbMap(const PointCloud& cloud, const Pose& pose) {
         cfg_.map_sliding_en  &&
         (map_empty_ || (pos - local_map_origin_d_).norm() > cfg_.map_sliding_thresh)
         ) {
-        slideAllMap(pos);
+        waitForPendingUpdate();
+        std::unique_lock<std::shared_mutex> lck(map_rw_mtx_, std::try_to_lock);
+        if (lck.owns_lock()) {
+            applyDeferredBatches();
+            slideAllMap(pos);
+            map_epoch_++;
+        }
     }
 
+    /* The raycasting only touches the update cache, it runs without blocking the readers */
     updateLocalBox(pos);
     TimeConsuming t_raycast("raycast", false);
     raycastProcess(cloud, pos);
-    time_consuming_[1] = t_raycast.stop();
+    setTimeConsuming(1, t_raycast.stop());
     raycast_data_.batch_update_counter++;
+
+    UpdateBatch& batch = pipeline_.ingest_batch;
+    batch.clear();
+    batch.pos = pos;
     if (raycast_data_.batch_update_counter >= cfg_.batch_update_size) {
         raycast_data_.batch_update_counter = 0;
-        time_consuming_[5] = raycast_data_.update_cache_id_g.size();
+        setTimeConsuming(5, raycast_data_.update_cache_hash.size());
+        drainUpdateCache(batch);
+    }
+
+    if (cfg_.pipeline_update_en) {
+        submitUpdateBatch();
+    }
+    else {
+        applyUpdateBatch(batch);
+    }
+    setTimeConsuming(0, tc.stop());
+    autoSaveMaps(false);
+}
+
+void ProbMap::setTimeConsuming(const int& id, const double& value) {
+    std::lock_guard<std::mutex> lck(time_mtx_);
+    time_consuming_[id] = value;
+}
+
+void ProbMap::applyUpdateBatch(UpdateBatch& batch) {
+    std::unique_lock<std::shared_mutex> lck(map_rw_mtx_, std::try_to_lock);
+    if (!lck.owns_lock()) {
+        if (pipeline_.deferred.size() < MAX_DEFERRED_BATCH_NUM) {
+            // A planner is reading the map, the batch is applied at the next update after it
+            pipeline_.deferred.emplace_back();
+            std::swap(pipeline_.deferred.back(), batch);
+            return;
+        }
+        // The views kept the map behind for too many frames, wait for them
+        lck.lock();
+    }
+    applyDeferredBatches();
+    applyLockedBatch(batch);
+}
+
+void ProbMap::applyDeferredBatches() {
+    for (const auto& batch : pipeline_.deferred) {
+        applyLockedBatch(batch);
+    }
+    pipeline_.deferred.clear();
+}
+
+void ProbMap::applyLockedBatch(const UpdateBatch& batch) {
+    if (batch.probability_update) {
         TimeConsuming t_update("update", false);
-        probabilisticMapFromCache();
-        time_consuming_[2] = t_update.stop();
+        probabilisticMapFromBatch(batch);
+        setTimeConsuming(2, t_update.stop());
         map_empty_ = false;
     }
-    inf_map_->getInflationNumAndTime(time_consuming_[6], time_consuming_[3]);
-    time_consuming_[0] = tc.stop();
+    double inf_num, inf_t;
+    inf_map_->getInflationNumAndTime(inf_num, inf_t);
+    setTimeConsuming(6, inf_num);
+    setTimeConsuming(3, inf_t);
 
     /* Update ESDF map */
     if (cfg_.esdf_en) {
-        esdf_map_->updateESDF3D(pos);
+        esdf_map_->updateESDF3D(batch.pos);
     }
 
     /* For the first frame, clear all unknown around the robot */
     static bool first = true;
     if (first) {
         first = false;
+        const Vec3f& pos = batch.pos;
         for (double dx = -cfg_.raycast_range_min; dx <= cfg_.raycast_range_min; dx += cfg_.resolution) {
             for (double dy = -cfg_.raycast_range_min; dy <= cfg_.raycast_range_min; dy += cfg_.resolution) {
                 for (double dz = -cfg_.raycast_range_min; dz <= cfg_.raycast_range_min; dz += cfg_.resolution) {
@@ -366,11 +846,45 @@ void ProbMap::updateProbMap(const PointCloud& cloud, const Pose& pose) {
                     if (p.norm() <= cfg_.raycast_range_min) {
                         Vec3f pp = pos + p;
                         int hash_id = getHashIndexFromPos(pp);
-                        missPointUpdate(pp, hash_id, 999);
+                        missPointUpdate(hash_id, 999);
                     }
                 }
             }
         }
+        flushJumpingEdges();
+    }
+    map_epoch_++;
+}
+
+void ProbMap::submitUpdateBatch() {
+    std::unique_lock<std::mutex> lck(pipeline_.mtx);
+    // at most one batch is in flight, wait until the previous one is applied
+    pipeline_.cv.wait(lck, [this] { return !pipeline_.pending; });
+    std::swap(pipeline_.ingest_batch, pipeline_.apply_batch);
+    pipeline_.pending = true;
+    pipeline_.cv.notify_all();
+}
+
+void ProbMap::waitForPendingUpdate() {
+    if (!cfg_.pipeline_update_en) {
+        return;
+    }
+    std::unique_lock<std::mutex> lck(pipeline_.mtx);
+    pipeline_.cv.wait(lck, [this] { return !pipeline_.pending; });
+}
+
+void ProbMap::applyThreadLoop() {
+    std::unique_lock<std::mutex> lck(pipeline_.mtx);
+    while (true) {
+        pipeline_.cv.wait(lck, [this] { return pipeline_.pending || pipeline_.stop; });
+        if (!pipeline_.pending) {
+            return;
+        }
+        lck.unlock();
+        applyUpdateBatch(pipeline_.apply_batch);
+        lck.lock();
+        pipeline_.pending = false;
+        pipeline_.cv.notify_all();
     }
 }
 
@@ -410,19 +924,19 @@ GridType ProbMap::getGridType(const Vec3f& pos) const {
     return getGridType(id_g);
 }
 
-GridType ProbMap::getInfGridType(const Vec3f& pos) const {
+GridType ProbMap::getInfGridType(const Vec3f& pos, const int& layer_id) const {
     // NOTE, we consider, if the pos is not inside prob map, it is also out of inf map.
     if(!insideLocalMap(pos)) {
         return OUT_OF_MAP;
     }
-    return inf_map_->getGridType(pos);
+    return inf_map_->getGridType(pos, layer_id);
 }
 
 double ProbMap::getMapValue(const Vec3f& pos) const {
     if (!insideLocalMap(pos)) {
         return 0;
     }
-    return occupancy_buffer_[getHashIndexFromPos(pos)];
+    return occupancy_buffer_[getHashIndexFromPos(pos)] / log_odds_.scale;
 }
 
 void
@@ -450,14 +964,7 @@ ProbMap::boxSearch(const Vec3f& _box_min, const Vec3f& _box_max, const GridType&
         out_points.reserve(box_size.prod());
         for (int i = box_min_id_g.x() + 1; i < box_max_id_g.x(); i++) {
             for (int j = box_min_id_g.y() + 1; j < box_max_id_g.y(); j++) {
-                for (int k = box_min_id_g.z() + 1; k < box_max_id_g.z(); k++) {
-                    Vec3i id_g(i, j, k);
-                    if (isUnknown(id_g)) {
-                        Vec3f pos;
-                        globalIndexToPos(id_g, pos);
-                        out_points.push_back(pos);
-                    }
-                }
+                searchZRun(i, j, box_min_id_g.z() + 1, box_max_id_g.z() - 1, UNKNOWN, out_points);
             }
         }
     }
@@ -465,14 +972,7 @@ ProbMap::boxSearch(const Vec3f& _box_min, const Vec3f& _box_max, const GridType&
         out_points.reserve(box_size.prod() / 3);
         for (int i = box_min_id_g.x() + 1; i < box_max_id_g.x(); i++) {
             for (int j = box_min_id_g.y() + 1; j < box_max_id_g.y(); j++) {
-                for (int k = box_min_id_g.z() + 1; k < box_max_id_g.z(); k++) {
-                    Vec3i id_g(i, j, k);
-                    if (isOccupied(id_g)) {
-                        Vec3f pos;
-                        globalIndexToPos(id_g, pos);
-                        out_points.push_back(pos);
-                    }
-                }
+                searchZRun(i, j, box_min_id_g.z() + 1, box_max_id_g.z() - 1, OCCUPIED, out_points);
             }
         }
     }
@@ -496,6 +996,38 @@ ProbMap::boxSearch(const Vec3f& _box_min, const Vec3f& _box_max, const GridType&
     }
 }
 
+void ProbMap::searchZRun(const int& x, const int& y, const int& z_min, const int& z_max,
+                         const GridType& gt, vec_E<Vec3f>& out_points) const {
+    auto slow_search = [&](const int& z_start, const int& z_end) {
+        for (int k = z_start; k <= z_end; k++) {
+            const Vec3i id_g(x, y, k);
+            if (gt == OCCUPIED ? isOccupied(id_g) : isUnknown(id_g)) {
+                Vec3f pos;
+                globalIndexToPos(id_g, pos);
+                out_points.push_back(pos);
+            }
+        }
+    };
+    // The bitset only holds the cells inside the local map and between the virtual ground and ceil
+    int bit_z_min = std::max(z_min, sc_.virtual_ground_height_id_g + sc_.safe_margin_i);
+    int bit_z_max = std::min(z_max, sc_.virtual_ceil_height_id_g);
+    bit_z_min = std::max(bit_z_min, local_map_bound_min_i_.z());
+    bit_z_max = std::min(bit_z_max, local_map_bound_max_i_.z());
+    if (bit_z_min > bit_z_max || !insideLocalMap(Vec3i(x, y, bit_z_min))) {
+        slow_search(z_min, z_max);
+        return;
+    }
+    slow_search(z_min, bit_z_min - 1);
+    const Vec3i run_start(x, y, bit_z_min);
+    forEachSetBitInZRun(gt == OCCUPIED ? occupied_bits_ : unknown_bits_, run_start,
+                        bit_z_max - bit_z_min + 1, [&](const int& k) {
+                            Vec3f pos;
+                            globalIndexToPos(Vec3i(x, y, bit_z_min + k), pos);
+                            out_points.push_back(pos);
+                        });
+    slow_search(bit_z_max + 1, z_max);
+}
+
 void ProbMap::boxSearchInflate(const Vec3f& box_min, const Vec3f& box_max, const GridType& gt,
                                vec_E<Vec3f>& out_points) const {
     inf_map_->boxSearch(box_min, box_max, gt, out_points);
@@ -515,7 +1047,7 @@ void ProbMap::boundBoxByLocalMap(Vec3f& box_min, Vec3f& box_max) const {
 }
 
 void ProbMap::resetCell(const int& hash_id) {
-    float& ret = occupancy_buffer_[hash_id];
+    LogOdds& ret = occupancy_buffer_[hash_id];
     if (isOccupied(ret)) {
         /// if current state is occupied
         Vec3f pos;
@@ -524,6 +1056,14 @@ void ProbMap::resetCell(const int& hash_id) {
         if (cfg_.esdf_en) {
             esdf_map_->updateGridCounter(pos, OCCUPIED, UNKNOWN);
         }
+        if (cfg_.clearance_en) {
+            clr_map_->updateGridCounter(pos, OCCUPIED, UNKNOWN);
+        }
+        if (cfg_.frontier_extraction_en) {
+            Vec3i id_g;
+            posToGlobalIndex(pos, id_g);
+            fcnt_map_->updateKnownFlag(id_g, false);
+        }
     }
     else if (isKnownFree(ret)) {
         /// if current state is free
@@ -533,11 +1073,15 @@ void ProbMap::resetCell(const int& hash_id) {
         if (cfg_.esdf_en) {
             esdf_map_->updateGridCounter(pos, KNOWN_FREE, UNKNOWN);
         }
+        if (cfg_.clearance_en) {
+            clr_map_->updateGridCounter(pos, KNOWN_FREE, UNKNOWN);
+        }
         if (cfg_.frontier_extraction_en) {
             Vec3i id_g;
             posToGlobalIndex(pos, id_g);
             if (cfg_.frontier_extraction_en) {
                 fcnt_map_->updateFrontierCounter(id_g, false);
+                fcnt_map_->updateKnownFlag(id_g, false);
             }
         }
     }
@@ -545,36 +1089,143 @@ void ProbMap::resetCell(const int& hash_id) {
         // nothing need to do
     }
     ret = 0;
+    setStateBits(hash_id, UNKNOWN);
+}
+
+void ProbMap::resetSlab(const vector<int>& slab_hash, const vec_E<Vec3i>& slab_id_g) {
+    for (size_t i = 0; i < slab_hash.size(); i++) {
+        LogOdds& ret = occupancy_buffer_[slab_hash[i]];
+        if (cfg_.global_map_en) {
+            global_map_->writeCell(slab_id_g[i], isUnknown(ret) ? LogOdds(0) : ret);
+        }
+        if (isOccupied(ret)) {
+            Vec3f pos;
+            globalIndexToPos(slab_id_g[i], pos);
+            jumping_edges_.push_back({pos, OCCUPIED, UNKNOWN});
+            if (cfg_.frontier_extraction_en) {
+                fcnt_map_->updateKnownFlag(slab_id_g[i], false);
+            }
+        }
+        else if (isKnownFree(ret)) {
+            Vec3f pos;
+            globalIndexToPos(slab_id_g[i], pos);
+            jumping_edges_.push_back({pos, KNOWN_FREE, UNKNOWN});
+            if (cfg_.frontier_extraction_en) {
+                fcnt_map_->updateFrontierCounter(slab_id_g[i], false);
+                fcnt_map_->updateKnownFlag(slab_id_g[i], false);
+            }
+        }
+        ret = 0;
+        setStateBits(slab_hash[i], UNKNOWN);
+    }
+    flushJumpingEdges();
+}
+
+void ProbMap::resetBricks(const vector<int>& brick_hash) {
+    static constexpr int BRICK_VOX_NUM = 1 << (3 * BRICK_BIT);
+    for (const int& brick : brick_hash) {
+        const int start = brick << (3 * BRICK_BIT);
+        if (cfg_.global_map_en) {
+            // The unknown cells are written too, they clear the stale cells of the global map
+            forEachCellInBrick(brick, [this](const int& hash_id) {
+                Vec3i id_g;
+                hashIdToGlobalIndex(hash_id, id_g);
+                const LogOdds& ret = occupancy_buffer_[hash_id];
+                global_map_->writeCell(id_g, isUnknown(ret) ? LogOdds(0) : ret);
+            });
+        }
+        // A brick is 64-aligned in the state bits, the known cells are the clear unknown bits
+        for (int w = start >> 6; w < (start + BRICK_VOX_NUM) >> 6; w++) {
+            uint64_t known = ~unknown_bits_[w];
+            while (known) {
+                const int hash_id = (w << 6) + __builtin_ctzll(known);
+                known &= known - 1;
+                Vec3i id_g;
+                Vec3f pos;
+                hashIdToGlobalIndex(hash_id, id_g);
+                globalIndexToPos(id_g, pos);
+                if (isOccupied(occupancy_buffer_[hash_id])) {
+                    jumping_edges_.push_back({pos, OCCUPIED, UNKNOWN});
+                    if (cfg_.frontier_extraction_en) {
+                        fcnt_map_->updateKnownFlag(id_g, false);
+                    }
+                }
+                else {
+                    jumping_edges_.push_back({pos, KNOWN_FREE, UNKNOWN});
+                    if (cfg_.frontier_extraction_en) {
+                        fcnt_map_->updateFrontierCounter(id_g, false);
+                        fcnt_map_->updateKnownFlag(id_g, false);
+                    }
+                }
+            }
+            occupied_bits_[w] = 0;
+            unknown_bits_[w] = ~uint64_t(0);
+        }
+        std::fill_n(occupancy_buffer_.begin() + start, BRICK_VOX_NUM, 0);
+    }
+    flushJumpingEdges();
 }
 
 void ProbMap::probabilisticMapFromCache() {
-    //    int addr = getHashIndexFromGlobalIndex(Vec3i(41,
-    //                                                 -216,
-    //                                                 -6));
-    //    float ret = occupancy_buffer_[addr];
-    //    std::cout << "ret: " << ret << std::endl;
-    while (!raycast_data_.update_cache_id_g.empty()) {
-        Vec3f pos;
-        Vec3i id_g = raycast_data_.update_cache_id_g.front();
-        raycast_data_.update_cache_id_g.pop();
-        Vec3i id_l;
-        globalIndexToLocalIndex(id_g, id_l);
-        int hash_id = getLocalIndexHash(id_l);
-        globalIndexToPos(id_g, pos);
-        if (raycast_data_.hit_cnt[hash_id] > 0) {
-            hitPointUpdate(pos, hash_id, raycast_data_.hit_cnt[hash_id]);
+    UpdateBatch batch;
+    drainUpdateCache(batch);
+    probabilisticMapFromBatch(batch);
+}
+
+void ProbMap::drainUpdateCache(UpdateBatch& batch) {
+    auto& cache = raycast_data_.update_cache_hash;
+    // Visit the cells in the order of hash id, so that the buffers are accessed sequentially
+    std::sort(cache.begin(), cache.end());
+    batch.probability_update = true;
+    batch.hash_id.reserve(cache.size());
+    batch.operation_cnt.reserve(cache.size());
+    batch.hit_cnt.reserve(cache.size());
+    for (const int& hash_id : cache) {
+        batch.hash_id.push_back(hash_id);
+        auto& counter = raycast_data_.cell_counter[hash_id];
+        batch.operation_cnt.push_back(counter.operation_cnt);
+        batch.hit_cnt.push_back(counter.hit_cnt);
+        counter.hit_cnt = 0;
+        counter.operation_cnt = 0;
+    }
+    clearUpdateCache();
+}
+
+void ProbMap::probabilisticMapFromBatch(const UpdateBatch& batch) {
+    const int cell_num = static_cast<int>(batch.hash_id.size());
+    for (int i = 0; i < cell_num; i++) {
+        if (batch.hit_cnt[i] > 0) {
+            hitPointUpdate(batch.hash_id[i], batch.hit_cnt[i]);
         }
         else {
-            missPointUpdate(pos, hash_id,
-                            raycast_data_.operation_cnt[hash_id] - raycast_data_.hit_cnt[hash_id]);
+            missPointUpdate(batch.hash_id[i], batch.operation_cnt[i]);
         }
-        raycast_data_.hit_cnt[hash_id] = 0;
-        raycast_data_.operation_cnt[hash_id] = 0;
     }
+    flushJumpingEdges();
+}
+
+void ProbMap::clearUpdateCache() {
+    raycast_data_.update_cache_hash.clear();
+    raycast_data_.cache_generation++;
+    if (raycast_data_.cache_generation == 0) {
+        // the generation wrapped around, the stamps should be cleared once
+        for (auto& counter : raycast_data_.cell_counter) {
+            counter.cache_stamp = 0;
+        }
+        raycast_data_.cache_generation = 1;
+    }
+}
+
+void ProbMap::setStateBits(const int& hash_id, const GridType& type) {
+    const uint64_t mask = uint64_t(1) << (hash_id & 63);
+    uint64_t& occ_word = occupied_bits_[hash_id >> 6];
+    uint64_t& unk_word = unknown_bits_[hash_id >> 6];
+    occ_word = type == OCCUPIED ? occ_word | mask : occ_word & ~mask;
+    unk_word = type == UNKNOWN ? unk_word | mask : unk_word & ~mask;
 }
 
-void ProbMap::hitPointUpdate(const Vec3f& pos, const int& hash_id, const int& hit_num) {
-    float& ret = occupancy_buffer_[hash_id];
+void ProbMap::hitPointUpdate(const int& hash_id, const int& hit_num) {
+    LogOdds& ret = occupancy_buffer_[hash_id];
     GridType from_type = UNDEFINED;
 
     if (isOccupied(ret)) {
@@ -588,10 +1239,11 @@ void ProbMap::hitPointUpdate(const Vec3f& pos, const int& hash_id, const int& hi
     }
 
 
-    ret += cfg_.l_hit * hit_num;
-    if (ret > cfg_.l_max) {
-        ret = cfg_.l_max;
+    LogOddsAcc value = ret + log_odds_.hit * hit_num;
+    if (value > log_odds_.max) {
+        value = log_odds_.max;
     }
+    ret = static_cast<LogOdds>(value);
 
     GridType to_type;
     if (isOccupied(ret)) {
@@ -605,24 +1257,13 @@ void ProbMap::hitPointUpdate(const Vec3f& pos, const int& hash_id, const int& hi
     }
 
     if (from_type != to_type) {
-        Vec3f center_pos;
-        Vec3i id_g;
-        posToGlobalIndex(pos, id_g);
-        globalIndexToPos(id_g, center_pos);
-        inf_map_->updateGridCounter(center_pos, from_type, to_type);
-        if (cfg_.esdf_en) {
-            esdf_map_->updateGridCounter(center_pos, from_type, to_type);
-        }
-        if (cfg_.frontier_extraction_en && from_type == KNOWN_FREE) {
-            Vec3i id_g;
-            posToGlobalIndex(pos, id_g);
-            fcnt_map_->updateFrontierCounter(id_g, false);
-        }
+        setStateBits(hash_id, to_type);
+        triggerJumpingEdge(hash_id, from_type, to_type);
     }
 }
 
-void ProbMap::missPointUpdate(const Vec3f& pos, const int& hash_id, const int& hit_num) {
-    float& ret = occupancy_buffer_[hash_id];
+void ProbMap::missPointUpdate(const int& hash_id, const int& hit_num) {
+    LogOdds& ret = occupancy_buffer_[hash_id];
     GridType from_type;
     if (isOccupied(ret)) {
         from_type = GridType::OCCUPIED;
@@ -633,10 +1274,11 @@ void ProbMap::missPointUpdate(const Vec3f& pos, const int& hash_id, const int& h
     else {
         from_type = GridType::UNKNOWN;
     }
-    ret += cfg_.l_miss * hit_num;
-    if (ret < cfg_.l_min) {
-        ret = cfg_.l_min;
+    LogOddsAcc value = ret + log_odds_.miss * hit_num;
+    if (value < log_odds_.min) {
+        value = log_odds_.min;
     }
+    ret = static_cast<LogOdds>(value);
 
     GridType to_type;
     if (isOccupied(ret)) {
@@ -650,25 +1292,44 @@ void ProbMap::missPointUpdate(const Vec3f& pos, const int& hash_id, const int& h
     }
     // Catch the jump edge
     if (from_type != to_type) {
-        Vec3f center_pos;
-        Vec3i id_g;
-        posToGlobalIndex(pos, id_g);
-        globalIndexToPos(id_g, center_pos);
-        // Update inf map
-        inf_map_->updateGridCounter(center_pos, from_type, to_type);
-        if (cfg_.esdf_en) {
-            esdf_map_->updateGridCounter(center_pos, from_type, to_type);
-        }
+        setStateBits(hash_id, to_type);
+        triggerJumpingEdge(hash_id, from_type, to_type);
+    }
+}
 
+void ProbMap::triggerJumpingEdge(const int& hash_id, const GridType& from_type, const GridType& to_type) {
+    /* The cell center is only recovered from the hash id when the cell type really changes */
+    Vec3f center_pos;
+    hashIdToPos(hash_id, center_pos);
+    // The inf, esdf and clearance maps are updated in flushJumpingEdges
+    jumping_edges_.push_back({center_pos, from_type, to_type});
 
-        if (cfg_.frontier_extraction_en && to_type == KNOWN_FREE) {
-            Vec3i id_g;
-            posToGlobalIndex(pos, id_g);
-            fcnt_map_->updateFrontierCounter(id_g, true);
+    if (cfg_.frontier_extraction_en) {
+        Vec3i id_g;
+        posToGlobalIndex(center_pos, id_g);
+        if (from_type == KNOWN_FREE || to_type == KNOWN_FREE) {
+            fcnt_map_->updateFrontierCounter(id_g, to_type == KNOWN_FREE);
+        }
+        if (from_type == UNKNOWN || to_type == UNKNOWN) {
+            fcnt_map_->updateKnownFlag(id_g, to_type != UNKNOWN);
         }
     }
 }
 
+void ProbMap::flushJumpingEdges() {
+    /* The edges of a batch are merged per counter cell, so the inflation of a counter
+     * cell runs at most once, and the opposite edges of its sub-cells cancel out.
+     * */
+    inf_map_->updateGridCounterBatch(jumping_edges_);
+    if (cfg_.esdf_en) {
+        esdf_map_->updateGridCounterBatch(jumping_edges_);
+    }
+    if (cfg_.clearance_en) {
+        clr_map_->updateGridCounterBatch(jumping_edges_);
+    }
+    jumping_edges_.clear();
+}
+
 void ProbMap::raycastProcess(const PointCloud& input_cloud, const Vec3f& cur_odom) {
     // bounding box of updated region
     raycast_data_.cache_box_min = cur_odom;
@@ -686,6 +1347,8 @@ void ProbMap::raycastProcess(const PointCloud& input_cloud, const Vec3f& cur_odo
     // new version of raycasting process
     auto raycasting_cloud = vec_Vec3f{};
     raycasting_cloud.reserve(cloud_in_size);
+    auto raycasting_start = vec_Vec3f{};
+    raycasting_start.reserve(cloud_in_size);
 
     // 1) process all non-inf points, update occupied probability
     int temperol_cnt{0};
@@ -767,6 +1430,7 @@ void ProbMap::raycastProcess(const PointCloud& input_cloud, const Vec3f& cur_odo
 
         // 1.4) for all validate hit points, update probability
         raycasting_cloud.push_back(p);
+        raycasting_start.push_back((p - cur_odom).normalized() * cfg_.raycast_range_min + cur_odom);
 
         if (update_hit) {
             posToGlobalIndex(p, pt_id_g);
@@ -774,32 +1438,81 @@ void ProbMap::raycastProcess(const PointCloud& input_cloud, const Vec3f& cur_odo
         }
     }
 
-    if (cfg_.raycasting_en) {
+    if (cfg_.raycasting_en && raycast_data_.thread_pool->size() > 1) {
+        parallelRaycast(raycasting_start, raycasting_cloud);
+    }
+    else if (cfg_.raycasting_en) {
         // 4) process all inf points, updae free probability
-        for (const auto& p : raycasting_cloud) {
-            Vec3f raycast_start = (p - cur_odom).normalized() * cfg_.raycast_range_min + cur_odom;
-            raycast_data_.raycaster.setInput(raycast_start, p);
-            Vec3f ray_pt;
-            while (raycast_data_.raycaster.step(ray_pt)) {
-                Vec3i cur_ray_id_g;
-                posToGlobalIndex(ray_pt, cur_ray_id_g);
-                if (!insideLocalMap(cur_ray_id_g)) {
-                    break;
+        raycast_data_.raycaster.walk(raycasting_start, raycasting_cloud, [&](const int&, const Vec3i& cur_ray_id_g) {
+            if (!insideLocalMap(cur_ray_id_g)) {
+                return false;
+            }
+            insertUpdateCandidate(cur_ray_id_g, false);
+            return true;
+        });
+    }
+}
+
+void ProbMap::parallelRaycast(const vec_Vec3f& raycast_starts, const vec_Vec3f& raycast_ends) {
+    /* The free update of a cell only depends on how many rays passed it, so the rays
+     * can be walked in any order. Each worker walks an interleaved subset of rays with
+     * its own BatchRayCaster and buckets the hash ids by the worker owning that hash range.
+     * Then each worker merges the buckets of its own range, so no two threads ever
+     * touch the same counter and the result is identical to the serial raycasting.
+     * */
+    auto& workers = raycast_data_.workers;
+    const int worker_num = static_cast<int>(workers.size());
+
+    // 1) walk the rays
+    raycast_data_.thread_pool->parallelFor(worker_num, [&](const int& w) {
+        RaycastWorker& worker = workers[w];
+        for (auto& bucket : worker.buckets) {
+            bucket.clear();
+        }
+        worker.raycaster.walk(raycast_starts, raycast_ends, [&](const int&, const Vec3i& cur_ray_id_g) {
+            if (!insideLocalMap(cur_ray_id_g)) {
+                return false;
+            }
+            const int hash_id = getHashIndexFromGlobalIndex(cur_ray_id_g);
+            worker.buckets[hash_id / raycast_data_.hash_range_per_worker].push_back(hash_id);
+            return true;
+        }, w, worker_num);
+    });
+
+    // 2) merge the buckets, each worker only touches the counters inside its own hash range
+    raycast_data_.thread_pool->parallelFor(worker_num, [&](const int& owner) {
+        auto& new_cache = workers[owner].new_cache_hash;
+        new_cache.clear();
+        const uint16_t generation = raycast_data_.cache_generation;
+        for (const auto& worker : workers) {
+            for (const int& hash_id : worker.buckets[owner]) {
+                auto& counter = raycast_data_.cell_counter[hash_id];
+                counter.operation_cnt++;
+                if (counter.cache_stamp != generation) {
+                    counter.cache_stamp = generation;
+                    new_cache.push_back(hash_id);
                 }
-                insertUpdateCandidate(cur_ray_id_g, false);
             }
         }
+    });
+
+    // 3) append the newly touched cells to the update cache
+    for (const auto& worker : workers) {
+        raycast_data_.update_cache_hash.insert(raycast_data_.update_cache_hash.end(),
+                                               worker.new_cache_hash.begin(), worker.new_cache_hash.end());
     }
 }
 
 void ProbMap::insertUpdateCandidate(const Vec3i& id_g, bool is_hit) {
     const auto& hash_id = getHashIndexFromGlobalIndex(id_g);
-    raycast_data_.operation_cnt[hash_id]++;
-    if (raycast_data_.operation_cnt[hash_id] == 1) {
-        raycast_data_.update_cache_id_g.push(id_g);
+    auto& counter = raycast_data_.cell_counter[hash_id];
+    counter.operation_cnt++;
+    if (counter.cache_stamp != raycast_data_.cache_generation) {
+        counter.cache_stamp = raycast_data_.cache_generation;
+        raycast_data_.update_cache_hash.push_back(hash_id);
     }
     if (is_hit) {
-        raycast_data_.hit_cnt[hash_id]++;
+        counter.hit_cnt++;
     }
 }
 
@@ -836,13 +1549,16 @@ void ProbMap::updateLocalBox(const Vec3f& cur_odom) {
 
 void ProbMap::resetLocalMap() {
     std::cout << YELLOW << " -- [Prob-Map] Clear all local map." << RESET << std::endl;
-    double unk_value = (cfg_.l_free + cfg_.l_occ)/2.0;
+    double unk_value = (log_odds_.free + log_odds_.occ)/2.0;
+#if ROG_MAP_LOG_ODDS_BITS != 32
+    // keep the unknown value inside [free, occ) after the rounding
+    unk_value = std::floor(unk_value);
+#endif
     // Clear local map
-    std::fill(occupancy_buffer_.begin(), occupancy_buffer_.end(), unk_value);
-    while (!raycast_data_.update_cache_id_g.empty()) {
-        raycast_data_.update_cache_id_g.pop();
-    }
+    std::fill(occupancy_buffer_.begin(), occupancy_buffer_.end(), static_cast<LogOdds>(unk_value));
+    std::fill(occupied_bits_.begin(), occupied_bits_.end(), 0);
+    std::fill(unknown_bits_.begin(), unknown_bits_.end(), ~uint64_t(0));
+    clearUpdateCache();
     raycast_data_.batch_update_counter = 0;
-    std::fill(raycast_data_.operation_cnt.begin(), raycast_data_.operation_cnt.end(), 0);
-    std::fill(raycast_data_.hit_cnt.begin(), raycast_data_.hit_cnt.end(), 0);
+    std::fill(raycast_data_.cell_counter.begin(), raycast_data_.cell_counter.end(), RaycastData::CellCounter{0, 0, 0});
 }
@@ -59,7 +59,13 @@ void ROGMap::init() {
     time_log_file_ << endl;
 
 
-    if (cfg_.load_pcd_en) {
+    if (cfg_.load_snapshot_en && loadSnapshot(cfg_.snapshot_name)) {
+        if (cfg_.esdf_en) {
+            esdf_map_->updateESDF3D(robot_state_.p);
+        }
+        cout << BLUE << " -- [ROGMap]Load snapshot success from [" << cfg_.snapshot_name << "]." << RESET << endl;
+    }
+    else if (cfg_.load_pcd_en) {
         string pcd_path = cfg_.pcd_name;
         PointCloud::Ptr pcd_map(new PointCloud);
         if (pcl::io::loadPCDFile(pcd_path, *pcd_map) == -1) {
@@ -75,6 +81,125 @@ void ROGMap::init() {
         cout << BLUE << " -- [ROGMap]Load pcd file success with " << pcd_map->size() << " pts." << RESET << endl;
         map_empty_ = false;
     }
+
+    // The global map only fills the cells left unknown by the snapshot or the pcd
+    if (cfg_.load_global_map_en && loadGlobalMap(cfg_.global_map_name) && cfg_.esdf_en) {
+        esdf_map_->updateESDF3D(robot_state_.p);
+    }
+}
+
+int ROGMap::getNearestSearchNum(const double& max_dis, int& radius) const {
+    // A cell center within max_dis of a position is within max_dis / resolution + sqrt(3) / 2
+    // cells of the cell containing the position
+    const double max_step = std::max(0.0, max_dis) / cfg_.resolution + 0.5 * std::sqrt(3.0);
+    const double sqr_lim = std::min(max_step * max_step, static_cast<double>(std::numeric_limits<int>::max()));
+    const auto& neighbors = cfg_.spherical_neighbor;
+    const int nei_num = static_cast<int>(std::upper_bound(
+            neighbors.begin(), neighbors.end(), static_cast<int>(sqr_lim),
+            [](const int& sqr, const Vec3i& nei) { return sqr < nei.squaredNorm(); }) - neighbors.begin());
+    radius = nei_num > 0 ? static_cast<int>(std::sqrt(neighbors[nei_num - 1].squaredNorm())) : 0;
+    return nei_num;
+}
+
+template<class F>
+bool ROGMap::searchNearestColumn(const Vec3i& start_id, const Vec3f& start_pos, const double& max_dis,
+                                 const int& nei_num, const int& radius, F&& fill_column, Vec3f& nearest_pt) const {
+    const int window_size = 2 * radius + 1;
+    std::vector<uint64_t> target((window_size + 63) / 64);
+
+    // The lowest set bit of words in [from, to], or -1
+    auto lowest_bit = [&](const std::vector<uint64_t>& words, const int& from, const int& to) {
+        for (int w = from >> 6; w <= to >> 6; w++) {
+            uint64_t word = words[w];
+            if (w == from >> 6) {
+                word &= ~uint64_t(0) << (from & 63);
+            }
+            if (w == to >> 6 && (to & 63) < 63) {
+                word &= (uint64_t(1) << ((to & 63) + 1)) - 1;
+            }
+            if (word) {
+                return (w << 6) + __builtin_ctzll(word);
+            }
+        }
+        return -1;
+    };
+    // The highest set bit of words in [from, to], or -1
+    auto highest_bit = [&](const std::vector<uint64_t>& words, const int& from, const int& to) {
+        for (int w = to >> 6; w >= from >> 6; w--) {
+            uint64_t word = words[w];
+            if (w == from >> 6) {
+                word &= ~uint64_t(0) << (from & 63);
+            }
+            if (w == to >> 6 && (to & 63) < 63) {
+                word &= (uint64_t(1) << ((to & 63) + 1)) - 1;
+            }
+            if (word) {
+                return (w << 6) + 63 - __builtin_clzll(word);
+            }
+        }
+        return -1;
+    };
+
+    Vec3f start_center;
+    globalIndexToPos(start_id, start_center);
+    const Vec3f start_offset = start_center - start_pos;
+    const double max_dis_sqr = max_dis * max_dis;
+    const int max_sqr = cfg_.spherical_neighbor[nei_num - 1].squaredNorm();
+    int best_sqr = std::numeric_limits<int>::max();
+    Vec3i best_nei = Vec3i::Zero();
+    for (const auto& column : cfg_.circular_neighbor) {
+        const int column_sqr = column.squaredNorm();
+        if (column_sqr > max_sqr || column_sqr >= best_sqr) {
+            break;
+        }
+        // The z range of the column within max_dis of start_pos
+        auto within = [&](const int& dz) {
+            const Vec3i nei(column.x(), column.y(), dz);
+            return (start_offset + nei.cast<double>() * cfg_.resolution).squaredNorm() <= max_dis_sqr;
+        };
+        const double horizontal_sqr = (start_offset.head<2>() + column.cast<double>() * cfg_.resolution).squaredNorm();
+        if (horizontal_sqr > max_dis_sqr) {
+            continue;
+        }
+        const int dz_lim = static_cast<int>(std::sqrt(static_cast<double>(max_sqr - column_sqr)));
+        const double half_len = std::sqrt(max_dis_sqr - horizontal_sqr);
+        // Rounded outward, then trimmed by the exact check
+        int dz_min = std::max(-dz_lim, static_cast<int>(std::floor((-start_offset.z() - half_len) * sc_.resolution_inv)));
+        int dz_max = std::min(dz_lim, static_cast<int>(std::ceil((-start_offset.z() + half_len) * sc_.resolution_inv)));
+        while (dz_min <= dz_max && !within(dz_min)) {
+            dz_min++;
+        }
+        while (dz_max >= dz_min && !within(dz_max)) {
+            dz_max--;
+        }
+        if (dz_min > dz_max) {
+            continue;
+        }
+
+        const int bit_min = dz_min + radius, bit_max = dz_max + radius;
+        fill_column(column, bit_min, bit_max, target);
+        const int up = lowest_bit(target, std::max(radius, bit_min), bit_max);
+        const int down = highest_bit(target, bit_min, std::min(radius - 1, bit_max));
+        int dz;
+        if (up >= 0 && (down < 0 || up - radius <= radius - down)) {
+            dz = up - radius;
+        }
+        else if (down >= 0) {
+            dz = down - radius;
+        }
+        else {
+            continue;
+        }
+        if (column_sqr + dz * dz < best_sqr) {
+            best_sqr = column_sqr + dz * dz;
+            best_nei = Vec3i(column.x(), column.y(), dz);
+        }
+    }
+    if (best_sqr == std::numeric_limits<int>::max()) {
+        return false;
+    }
+    globalIndexToPos(Vec3i(start_id + best_nei), nearest_pt);
+    return true;
 }
 
 bool ROGMap::findNearestCellThat(const bool & is, const GridType& target_type,
@@ -84,22 +209,104 @@ bool ROGMap::findNearestCellThat(const bool & is, const GridType& target_type,
     posToGlobalIndex(start_pos, start_id);
     nearest_pt.setConstant(NAN);
 
-
-    for(const auto & nei_id: cfg_.spherical_neighbor) {
-        const Vec3i q_id =start_id + nei_id;
+    int radius;
+    const int nei_num = getNearestSearchNum(max_dis, radius);
+    if (nei_num == 0) {
+        return false;
+    }
+    /* A cell of the window is outside the local map if one of its axis terms is negative,
+     * and the virtual ceil and ground only depend on z.
+     * */
+    const int window_size = 2 * radius + 1;
+    std::vector<int> axis_term(3 * window_size);
+    std::vector<uint8_t> virtual_occupied(window_size, 0);
+    for (int d = -radius; d <= radius; d++) {
+        for (int axis = 0; axis < 3; axis++) {
+            axis_term[axis * window_size + d + radius] = getAxisHashTerm(start_id(axis) + d, axis);
+        }
+        // Same as getGridType(pos), 2 for the check before the local map bound and 1 for the one after
+        const int z = start_id.z() + d;
         Vec3f q_pos;
-        globalIndexToPos(q_id, q_pos);
-        if((q_pos - start_pos).norm() > max_dis) {
-            return false;
+        globalIndexToPos(Vec3i(start_id.x(), start_id.y(), z), q_pos);
+        if (q_pos.z() <= cfg_.virtual_ground_height || q_pos.z() >= cfg_.virtual_ceil_height) {
+            virtual_occupied[d + radius] = 2;
         }
-
-        if((getGridType(q_pos) == target_type) == is) {
-            nearest_pt = q_pos;
-            return true;
+        else if (z <= sc_.virtual_ground_height_id_g || z >= sc_.virtual_ceil_height_id_g - sc_.safe_margin_i) {
+            virtual_occupied[d + radius] = 1;
         }
     }
-
-   return false;
+    const int* term_x = &axis_term[radius];
+    const int* term_y = term_x + window_size;
+    const int* term_z = term_y + window_size;
+
+    /* A cell inside the local map is classified by the occupied and unknown bits of the prob
+     * map, the other cells only by their z and whether their column is inside the local map.
+     * The nearest target of each column is taken from the bits of the window, 64 cells per
+     * word, so a query without a target costs a few word operations per column instead of
+     * one read per cell of the ball.
+     * */
+    const int word_num = (window_size + 63) / 64;
+    std::vector<uint64_t> fixed_target(word_num, 0), out_column_target(word_num, 0), cell_mask(word_num, 0);
+    std::vector<uint64_t> occ_run(word_num), unk_run(word_num);
+    auto set_bit = [](std::vector<uint64_t>& words, const int& k) {
+        words[k >> 6] |= uint64_t(1) << (k & 63);
+    };
+    // The cells read from the map are the z-run [cell_min, cell_max] of the window
+    int cell_min = window_size, cell_max = -1;
+    for (int k = 0; k < window_size; k++) {
+        const uint8_t virtual_type = virtual_occupied[k];
+        if (virtual_type == 0 && term_z[k - radius] >= 0) {
+            set_bit(cell_mask, k);
+            cell_min = std::min(cell_min, k);
+            cell_max = k;
+        }
+        else {
+            const GridType type = virtual_type == 2 ? OCCUPIED : (term_z[k - radius] < 0 ? OUT_OF_MAP : OCCUPIED);
+            if ((type == target_type) == is) {
+                set_bit(fixed_target, k);
+            }
+        }
+        if (((virtual_type == 2 ? OCCUPIED : OUT_OF_MAP) == target_type) == is) {
+            set_bit(out_column_target, k);
+        }
+    }
+    const bool read_occ = target_type == OCCUPIED || target_type == KNOWN_FREE;
+    const bool read_unk = target_type == UNKNOWN || target_type == KNOWN_FREE;
+
+    return searchNearestColumn(start_id, start_pos, max_dis, nei_num, radius,
+                               [&](const Vec2i& column, const int& bit_min, const int& bit_max,
+                                   std::vector<uint64_t>& target) {
+        // Only the words of the window holding [bit_min, bit_max] are filled
+        const int word_min = bit_min >> 6, word_max = bit_max >> 6;
+        if (term_x[column.x()] < 0 || term_y[column.y()] < 0) {
+            std::copy(&out_column_target[word_min], &out_column_target[word_max] + 1, &target[word_min]);
+            return;
+        }
+        std::copy(&fixed_target[word_min], &fixed_target[word_max] + 1, &target[word_min]);
+        const int run_min = std::max(cell_min, bit_min), run_max = std::min(cell_max, bit_max);
+        if (run_min > run_max) {
+            return;
+        }
+        const Vec3i run_start(start_id.x() + column.x(), start_id.y() + column.y(),
+                              start_id.z() + run_min - radius);
+        if (read_occ) {
+            std::fill(&occ_run[word_min], &occ_run[word_max] + 1, 0);
+            copyZRunBits(occupied_bits_, run_start, run_max - run_min + 1, occ_run.data(), run_min);
+        }
+        if (read_unk) {
+            std::fill(&unk_run[word_min], &unk_run[word_max] + 1, 0);
+            copyZRunBits(unknown_bits_, run_start, run_max - run_min + 1, unk_run.data(), run_min);
+        }
+        for (int w = word_min; w <= word_max; w++) {
+            uint64_t cell_target = target_type == OCCUPIED ? occ_run[w] :
+                                   target_type == UNKNOWN ? unk_run[w] :
+                                   target_type == KNOWN_FREE ? ~(occ_run[w] | unk_run[w]) : 0;
+            if (!is) {
+                cell_target = ~cell_target;
+            }
+            target[w] |= cell_target & cell_mask[w];
+        }
+    }, nearest_pt);
 }
 
 bool ROGMap::findNearestInfCellThat(const bool & is, const GridType& target_type,
@@ -109,23 +316,129 @@ bool ROGMap::findNearestInfCellThat(const bool & is, const GridType& target_type
     posToGlobalIndex(start_pos, start_id);
     nearest_pt.setConstant(NAN);
 
-
-    for(const auto & nei_id: cfg_.spherical_neighbor) {
-        const Vec3i q_id = start_id + nei_id;
+    int radius;
+    const int nei_num = getNearestSearchNum(max_dis, radius);
+    if (nei_num == 0) {
+        return false;
+    }
+    /* The candidates are the prob map cells, the inf map cell containing a candidate is found
+     * per axis, as the virtual ceil and ground of the inf map per z. The slot of a candidate
+     * is the offset of its inf map cell from the one of the window corner.
+     * */
+    const int window_size = 2 * radius + 1;
+    std::vector<int> prob_term(3 * window_size), inf_term(3 * window_size), inf_slot(3 * window_size);
+    std::vector<uint8_t> virtual_occupied(window_size);
+    Vec3i inf_id_min;
+    for (int d = -radius; d <= radius; d++) {
         Vec3f q_pos;
-        globalIndexToPos(q_id, q_pos);
-        if((q_pos - start_pos).norm() > max_dis) {
-            return false;
+        globalIndexToPos(Vec3i(start_id + Vec3i::Constant(d)), q_pos);
+        Vec3i inf_id;
+        inf_map_->infMapPosToGlobalIndex(q_pos, inf_id);
+        if (d == -radius) {
+            inf_id_min = inf_id;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            prob_term[axis * window_size + d + radius] = getAxisHashTerm(start_id(axis) + d, axis);
+            inf_term[axis * window_size + d + radius] = inf_map_->getAxisHashTermOfPos(q_pos(axis), axis);
+            inf_slot[axis * window_size + d + radius] = inf_id(axis) - inf_id_min(axis);
+        }
+        virtual_occupied[d + radius] = inf_map_->isInflatedVirtualHeight(q_pos.z());
+    }
+    const int* prob_x = &prob_term[radius];
+    const int* prob_y = prob_x + window_size;
+    const int* inf_x = &inf_term[radius];
+    const int* inf_y = inf_x + window_size;
+    const int* inf_z = inf_y + window_size;
+    const int* slot_x = &inf_slot[radius];
+    const int* slot_y = slot_x + window_size;
+
+    /* Same as getInfGridType(pos). Along a column, a cell is out of the map or occupied by its
+     * z alone, unless its column is outside one of the maps, and the other cells are read from
+     * the inf map counters. As the inf map is coarser, the target bits of these cells are
+     * computed once per inf map column, with one read per inf map cell, and shared by the
+     * columns of the window inside it.
+     * */
+    const int word_num = (window_size + 63) / 64;
+    std::vector<uint64_t> fixed_target(word_num, 0), out_column_target(word_num, 0), cell_mask(word_num, 0);
+    auto set_bit = [](std::vector<uint64_t>& words, const int& k) {
+        words[k >> 6] |= uint64_t(1) << (k & 63);
+    };
+    const bool out_is_target = (OUT_OF_MAP == target_type) == is;
+    int cell_min = window_size, cell_max = -1;
+    for (int k = 0; k < window_size; k++) {
+        const int dz = k - radius;
+        if (out_is_target) {
+            set_bit(out_column_target, k);
+        }
+        if (prob_term[2 * window_size + k] < 0 || (!virtual_occupied[k] && inf_z[dz] < 0)) {
+            if (out_is_target) {
+                set_bit(fixed_target, k);
+            }
         }
+        else if (virtual_occupied[k]) {
+            if ((OCCUPIED == target_type) == is) {
+                set_bit(fixed_target, k);
+            }
+        }
+        else {
+            set_bit(cell_mask, k);
+            cell_min = std::min(cell_min, k);
+            cell_max = k;
+        }
+    }
+    // The columns outside the inf map but inside the prob map
+    std::vector<uint64_t> inf_out_column_target(fixed_target);
+    if (out_is_target) {
+        for (int w = 0; w < word_num; w++) {
+            inf_out_column_target[w] |= cell_mask[w];
+        }
+    }
 
-        if((getInfGridType(q_pos) == target_type) == is) {
-            nearest_pt = q_pos;
-            return true;
+    const int slot_num = std::max(slot_x[radius], slot_y[radius]) + 1;
+    std::vector<uint64_t> slot_target(static_cast<size_t>(slot_num) * slot_num * word_num);
+    std::vector<uint8_t> slot_filled(static_cast<size_t>(slot_num) * slot_num, 0);
+    const bool found = searchNearestColumn(start_id, start_pos, max_dis, nei_num, radius,
+                               [&](const Vec2i& column, const int& bit_min, const int& bit_max,
+                                   std::vector<uint64_t>& target) {
+        const int word_min = bit_min >> 6, word_max = bit_max >> 6;
+        const uint64_t* column_target;
+        if (prob_x[column.x()] < 0 || prob_y[column.y()] < 0) {
+            column_target = out_column_target.data();
+        }
+        else if (inf_x[column.x()] < 0 || inf_y[column.y()] < 0) {
+            column_target = inf_out_column_target.data();
         }
+        else {
+            const int slot = slot_x[column.x()] * slot_num + slot_y[column.y()];
+            uint64_t* words = &slot_target[static_cast<size_t>(slot) * word_num];
+            if (!slot_filled[slot]) {
+                slot_filled[slot] = 1;
+                std::copy(fixed_target.begin(), fixed_target.end(), words);
+                const int column_hash = inf_x[column.x()] + inf_y[column.y()];
+                int last_term = -1;
+                bool last_target = false;
+                for (int k = cell_min; k <= cell_max; k++) {
+                    if (!(cell_mask[k >> 6] >> (k & 63) & 1)) {
+                        continue;
+                    }
+                    if (inf_z[k - radius] != last_term) {
+                        last_term = inf_z[k - radius];
+                        last_target = (inf_map_->getGridTypeOfHash(column_hash + last_term) == target_type) == is;
+                    }
+                    if (last_target) {
+                        words[k >> 6] |= uint64_t(1) << (k & 63);
+                    }
+                }
+            }
+            column_target = words;
+        }
+        std::copy(column_target + word_min, column_target + word_max + 1, &target[word_min]);
+    }, nearest_pt);
+    if (!found && nei_num == static_cast<int>(cfg_.spherical_neighbor.size())) {
+        fmt::print(fg(fmt::color::yellow), " -- [ROGMap] findNearestInfCellThat failed to find all {} neighbors at start_pos: {}, target_type: {}, is: {}\n",
+                   nei_num, start_pos.transpose(), target_type, is);
     }
-    fmt::print(fg(fmt::color::yellow), " -- [ROGMap] findNearestInfCellThat failed to find all {} neighbors at start_pos: {}, target_type: {}, is: {}\n",
-               cfg_.spherical_neighbor.size(), start_pos.transpose(), target_type, is);
-    return false;
+    return found;
 }
 
 
@@ -204,6 +517,26 @@ bool ROGMap::isLineFree(const Vec3f& start_pt, const Vec3f& end_pt, const double
     return true;
 }
 
+bool ROGMap::isSweptSphereFree(const Vec3f& start_pt, const Vec3f& end_pt,
+                               const double& radius, const double& max_dis) const {
+    const int step = static_cast<int>(ceil(radius / cfg_.resolution));
+    raycaster::RayCaster raycaster;
+    raycaster.setResolution(cfg_.resolution);
+    Vec3f ray_pt;
+    raycaster.setInput(start_pt, end_pt);
+    while (raycaster.step(ray_pt)) {
+        if (max_dis > 0 && (ray_pt - start_pt).norm() > max_dis) {
+            return false;
+        }
+        Vec3i ray_pt_id_g;
+        posToGlobalIndex(ray_pt, ray_pt_id_g);
+        if (!isSphereFree(ray_pt_id_g, step)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool ROGMap::isLineFree(const Vec3f& start_pt, const Vec3f& end_pt, Vec3f& free_local_goal, const double& max_dis,
                         const vec_Vec3i& neighbor_list) const {
     raycaster::RayCaster raycaster;
@@ -28,18 +28,19 @@ using namespace color_text;
 using namespace super_utils;
 
 SlidingMap::SlidingMap(const Vec3i &half_map_size_i, const double &resolution, const bool &map_sliding_en,
-                       const double &sliding_thresh, const Vec3f &fix_map_origin) {
+                       const double &sliding_thresh, const Vec3f &fix_map_origin, const bool &brick_layout_en) {
     std::cout<<"half_map_size_i: "<<half_map_size_i.transpose()<<std::endl;
     std::cout<<"resolution: "<<resolution<<std::endl;
     std::cout<<"map_sliding_en: "<<map_sliding_en<<std::endl;
     std::cout<<"sliding_thresh: "<<sliding_thresh<<std::endl;
     std::cout<<"fix_map_origin: "<<fix_map_origin.transpose()<<std::endl;
-    initSlidingMap(half_map_size_i, resolution, map_sliding_en, sliding_thresh, fix_map_origin);
+    initSlidingMap(half_map_size_i, resolution, map_sliding_en, sliding_thresh, fix_map_origin, brick_layout_en);
 }
 
 void
 SlidingMap::initSlidingMap(const rog_map::Vec3i &half_map_size_i, const double &resolution, const bool &map_sliding_en,
-                           const double &sliding_thresh, const rog_map::Vec3f &fix_map_origin) {
+                           const double &sliding_thresh, const rog_map::Vec3f &fix_map_origin,
+                           const bool &brick_layout_en) {
     if (had_been_initialized) {
         throw std::runtime_error(" -- [SlidingMap]: init can only be called once!");
     }
@@ -55,7 +56,13 @@ SlidingMap::initSlidingMap(const rog_map::Vec3i &half_map_size_i, const double &
     sc_.fix_map_origin = fix_map_origin;
     sc_.half_map_size_i = half_map_size_i;
     sc_.map_size_i = 2 * sc_.half_map_size_i + Vec3i::Constant(1);
-    sc_.map_vox_num = sc_.map_size_i.prod();
+    sc_.brick_layout_en = brick_layout_en;
+    if (brick_layout_en) {
+        sc_.brick_num_i = (sc_.map_size_i + Vec3i::Constant(BRICK_MASK)) / BRICK_SIZE;
+        sc_.map_vox_num = sc_.brick_num_i.prod() << (3 * BRICK_BIT);
+    } else {
+        sc_.map_vox_num = sc_.map_size_i.prod();
+    }
     if (!map_sliding_en) {
         local_map_origin_d_ = fix_map_origin;
         posToGlobalIndex(local_map_origin_d_, local_map_origin_i_);
@@ -66,6 +73,7 @@ SlidingMap::initSlidingMap(const rog_map::Vec3i &half_map_size_i, const double &
 void SlidingMap::printMapInformation() {
     std::cout << GREEN << "\tresolution: " << sc_.resolution << RESET << std::endl;
     std::cout << GREEN << "\tmap_sliding_en: " << sc_.map_sliding_en << RESET << std::endl;
+    std::cout << GREEN << "\tbrick_layout_en: " << sc_.brick_layout_en << RESET << std::endl;
     std::cout << GREEN << "\tlocal_map_size_i: " << sc_.map_size_i.transpose() << RESET << std::endl;
     std::cout << GREEN << "\tlocal_map_size_d: " << sc_.map_size_i.cast<double>().transpose() * sc_.resolution << RESET
               << std::endl;
@@ -97,19 +105,105 @@ void SlidingMap::updateLocalMapOriginAndBound(const rog_map::Vec3f &new_origin_d
     globalIndexToPos(local_map_bound_max_i_, local_map_bound_max_d_);
 }
 
+void SlidingMap::resetSlab(const vector<int> &slab_hash, const vec_E<Vec3i> &slab_id_g) {
+    for (const auto &hash_id: slab_hash) {
+        resetCell(hash_id);
+    }
+}
+
+void SlidingMap::resetBricks(const vector<int> &brick_hash) {
+    for (const auto &brick: brick_hash) {
+        forEachCellInBrick(brick, [this](const int &hash_id) { resetCell(hash_id); });
+    }
+}
+
 void SlidingMap::clearMemoryOutOfMap(const vector<int> &clear_id, const int &i) {
     vector<int> ids{i, (i + 1) % 3, (i + 2) % 3};
+    const int size_1 = sc_.map_size_i(ids[1]), size_2 = sc_.map_size_i(ids[2]);
+    // The global index of each local index on the two slab axes, the origin is not updated yet
+    vector<int> id_g_1(size_1), id_g_2(size_2);
+    for (int x = 0; x < size_1; x++) {
+        id_g_1[x] = localIndexToGlobalIndex(x - sc_.half_map_size_i(ids[1]), ids[1]);
+    }
+    for (int y = 0; y < size_2; y++) {
+        id_g_2[y] = localIndexToGlobalIndex(y - sc_.half_map_size_i(ids[2]), ids[2]);
+    }
+
+    slab_hash_.clear();
+    slab_id_g_.clear();
+    slab_brick_hash_.clear();
+    /* In the brick layout, a brick layer along axis i is evicted as a whole when all of its
+     * cell layers are cleared, its bricks are reset in bulk by resetBricks.
+     * */
+    vector<bool> brick_evicted;
+    if (sc_.brick_layout_en) {
+        vector<int> cleared_num(sc_.brick_num_i(i), 0);
+        for (const auto &idd: clear_id) {
+            cleared_num[(idd + sc_.half_map_size_i(i)) >> BRICK_BIT]++;
+        }
+        brick_evicted.resize(sc_.brick_num_i(i));
+        for (int b = 0; b < sc_.brick_num_i(i); b++) {
+            brick_evicted[b] = cleared_num[b] == std::min(BRICK_SIZE, sc_.map_size_i(i) - b * BRICK_SIZE);
+            if (!brick_evicted[b]) {
+                continue;
+            }
+            const int num_1 = sc_.brick_num_i(ids[1]), num_2 = sc_.brick_num_i(ids[2]);
+            Vec3i brick_id;
+            brick_id(i) = b;
+            for (int b1 = 0; b1 < num_1; b1++) {
+                for (int b2 = 0; b2 < num_2; b2++) {
+                    brick_id(ids[1]) = b1;
+                    brick_id(ids[2]) = b2;
+                    slab_brick_hash_.push_back((brick_id(0) * sc_.brick_num_i(1) + brick_id(1))
+                                               * sc_.brick_num_i(2) + brick_id(2));
+                }
+            }
+        }
+    }
+    slab_hash_.reserve(clear_id.size() * size_1 * size_2);
+    slab_id_g_.reserve(clear_id.size() * size_1 * size_2);
+    Vec3i temp_clear_id, temp_clear_id_g;
+    auto push_cell = [&](const int &x, const int &y) {
+        temp_clear_id(ids[1]) = x - sc_.half_map_size_i(ids[1]);
+        temp_clear_id(ids[2]) = y - sc_.half_map_size_i(ids[2]);
+        temp_clear_id_g(ids[1]) = id_g_1[x];
+        temp_clear_id_g(ids[2]) = id_g_2[y];
+        slab_hash_.push_back(getLocalIndexHash(temp_clear_id));
+        slab_id_g_.push_back(temp_clear_id_g);
+    };
+
     for (const auto &idd: clear_id) {
-        for (int x = -sc_.half_map_size_i(ids[1]); x <= sc_.half_map_size_i(ids[1]); x++) {
-            for (int y = -sc_.half_map_size_i(ids[2]); y <= sc_.half_map_size_i(ids[2]); y++) {
-                Vec3i temp_clear_id;
-                temp_clear_id(ids[0]) = idd;
-                temp_clear_id(ids[1]) = x;
-                temp_clear_id(ids[2]) = y;
-                resetCell(getLocalIndexHash(temp_clear_id));
+        temp_clear_id(ids[0]) = idd;
+        temp_clear_id_g(ids[0]) = localIndexToGlobalIndex(idd, ids[0]);
+        if (sc_.brick_layout_en) {
+            if (brick_evicted[(idd + sc_.half_map_size_i(i)) >> BRICK_BIT]) {
+                continue;
+            }
+            // Walk the slab brick by brick, so that the reset cells of a brick are close in memory
+            for (int b1 = 0; b1 < size_1; b1 += BRICK_SIZE) {
+                for (int b2 = 0; b2 < size_2; b2 += BRICK_SIZE) {
+                    const int end_1 = std::min(b1 + BRICK_SIZE, size_1), end_2 = std::min(b2 + BRICK_SIZE, size_2);
+                    for (int x = b1; x < end_1; x++) {
+                        for (int y = b2; y < end_2; y++) {
+                            push_cell(x, y);
+                        }
+                    }
+                }
+            }
+        } else {
+            for (int x = 0; x < size_1; x++) {
+                for (int y = 0; y < size_2; y++) {
+                    push_cell(x, y);
+                }
             }
         }
     }
+    if (!slab_hash_.empty()) {
+        resetSlab(slab_hash_, slab_id_g_);
+    }
+    if (!slab_brick_hash_.empty()) {
+        resetBricks(slab_brick_hash_);
+    }
 }
 
 void SlidingMap::mapSliding(const Vec3f &odom) {
@@ -169,11 +263,67 @@ void SlidingMap::mapSliding(const Vec3f &odom) {
 
 int SlidingMap::getLocalIndexHash(const Vec3i &id_in) const {
     Vec3i id = id_in + sc_.half_map_size_i;
+    if (sc_.brick_layout_en) {
+        const int brick_hash = ((id(0) >> BRICK_BIT) * sc_.brick_num_i(1) + (id(1) >> BRICK_BIT))
+                               * sc_.brick_num_i(2) + (id(2) >> BRICK_BIT);
+        return (brick_hash << (3 * BRICK_BIT)) |
+               ((id(0) & BRICK_MASK) << (2 * BRICK_BIT)) |
+               ((id(1) & BRICK_MASK) << BRICK_BIT) |
+               (id(2) & BRICK_MASK);
+    }
     return id(0) * sc_.map_size_i(1) * sc_.map_size_i(2) +
            id(1) * sc_.map_size_i(2) +
            id(2);
 }
 
+int SlidingMap::getAxisHashTerm(const int &id_g, const int &axis) const {
+    if (std::abs(id_g - local_map_origin_i_(axis)) > sc_.half_map_size_i(axis)) {
+        return -1;
+    }
+    int id_l = id_g % sc_.map_size_i(axis);
+    if (id_l > sc_.half_map_size_i(axis)) {
+        id_l -= sc_.map_size_i(axis);
+    } else if (id_l < -sc_.half_map_size_i(axis)) {
+        id_l += sc_.map_size_i(axis);
+    }
+    const int id = id_l + sc_.half_map_size_i(axis);
+    if (sc_.brick_layout_en) {
+        // The bit fields of getLocalIndexHash do not overlap, so the OR is a sum
+        int brick_stride = 1;
+        for (int i = axis + 1; i < 3; i++) {
+            brick_stride *= sc_.brick_num_i(i);
+        }
+        return ((id >> BRICK_BIT) * brick_stride << (3 * BRICK_BIT)) +
+               ((id & BRICK_MASK) << ((2 - axis) * BRICK_BIT));
+    }
+    int stride = 1;
+    for (int i = axis + 1; i < 3; i++) {
+        stride *= sc_.map_size_i(i);
+    }
+    return id * stride;
+}
+
+void SlidingMap::copyZRunBits(const vector<uint64_t> &bits, const Vec3i &id_g, const int &len,
+                              uint64_t *out, const int &out_start) const {
+    forEachZRunPiece(id_g, len, [&](const int &hash_start, const int &piece_len, const int &k_start) {
+        const int hash_end = hash_start + piece_len;
+        for (int h = hash_start; h < hash_end;) {
+            const int bit = h & 63;
+            const int num = std::min(64 - bit, hash_end - h);
+            uint64_t word = bits[h >> 6] >> bit;
+            if (num < 64) {
+                word &= (uint64_t(1) << num) - 1;
+            }
+            const int k = out_start + k_start + h - hash_start;
+            out[k >> 6] |= word << (k & 63);
+            if ((k & 63) + num > 64) {
+                out[(k >> 6) + 1] |= word >> (64 - (k & 63));
+            }
+            h += num;
+        }
+    });
+}
+
 void SlidingMap::posToGlobalIndex(const Vec3f &pos, Vec3i &id) const {
 
 #ifdef ORIGIN_AT_CENTER
@@ -221,18 +371,21 @@ void SlidingMap::globalIndexToLocalIndex(const Vec3i &id_g, Vec3i &id_l) const {
 
 void SlidingMap::localIndexToGlobalIndex(const Vec3i &id_l, Vec3i &id_g) const {
     for (int i = 0; i < 3; ++i) {
-        int min_id_g = -sc_.half_map_size_i(i) + local_map_origin_i_(i);
-        int min_id_l = min_id_g % sc_.map_size_i(i);
-        min_id_l -= min_id_l > sc_.half_map_size_i(i) ? sc_.map_size_i(i) : 0;
-        min_id_l += min_id_l < -sc_.half_map_size_i(i) ? sc_.map_size_i(i) : 0;
-        int cur_dis_to_min_id = id_l(i) - min_id_l;
-        cur_dis_to_min_id =
-                (cur_dis_to_min_id) < 0 ? (sc_.map_size_i(i) + cur_dis_to_min_id) : cur_dis_to_min_id;
-        int cur_id = cur_dis_to_min_id + min_id_g;
-        id_g(i) = cur_id;
+        id_g(i) = localIndexToGlobalIndex(id_l(i), i);
     }
 }
 
+int SlidingMap::localIndexToGlobalIndex(const int &id_l, const int &i) const {
+    int min_id_g = -sc_.half_map_size_i(i) + local_map_origin_i_(i);
+    int min_id_l = min_id_g % sc_.map_size_i(i);
+    min_id_l -= min_id_l > sc_.half_map_size_i(i) ? sc_.map_size_i(i) : 0;
+    min_id_l += min_id_l < -sc_.half_map_size_i(i) ? sc_.map_size_i(i) : 0;
+    int cur_dis_to_min_id = id_l - min_id_l;
+    cur_dis_to_min_id =
+            (cur_dis_to_min_id) < 0 ? (sc_.map_size_i(i) + cur_dis_to_min_id) : cur_dis_to_min_id;
+    return cur_dis_to_min_id + min_id_g;
+}
+
 void SlidingMap::localIndexToPos(const Vec3i &id_l, Vec3f &pos) const {
 #ifdef ORIGIN_AT_CENTER
     for (int i = 0; i < 3; ++i) {
@@ -269,6 +422,15 @@ void SlidingMap::localIndexToPos(const Vec3i &id_l, Vec3f &pos) const {
 }
 
 void SlidingMap::hashIdToLocalIndex(const int &hash_id, Vec3i &id) const {
+    if (sc_.brick_layout_en) {
+        const int brick_hash = hash_id >> (3 * BRICK_BIT);
+        const int brick_yz = sc_.brick_num_i(1) * sc_.brick_num_i(2);
+        id(0) = (brick_hash / brick_yz) << BRICK_BIT | ((hash_id >> (2 * BRICK_BIT)) & BRICK_MASK);
+        id(1) = ((brick_hash % brick_yz) / sc_.brick_num_i(2)) << BRICK_BIT | ((hash_id >> BRICK_BIT) & BRICK_MASK);
+        id(2) = (brick_hash % sc_.brick_num_i(2)) << BRICK_BIT | (hash_id & BRICK_MASK);
+        id -= sc_.half_map_size_i;
+        return;
+    }
     id(0) = hash_id / (sc_.map_size_i(1) * sc_.map_size_i(2));
     id(1) = (hash_id - id(0) * sc_.map_size_i(1) * sc_.map_size_i(2)) / sc_.map_size_i(2);
     id(2) = hash_id - id(0) * sc_.map_size_i(1) * sc_.map_size_i(2) - id(1) * sc_.map_size_i(2);
@@ -277,10 +439,7 @@ void SlidingMap::hashIdToLocalIndex(const int &hash_id, Vec3i &id) const {
 
 void SlidingMap::hashIdToGlobalIndex(const int &hash_id, rog_map::Vec3i &id_g) const {
     Vec3i id;
-    id(0) = hash_id / (sc_.map_size_i(1) * sc_.map_size_i(2));
-    id(1) = (hash_id - id(0) * sc_.map_size_i(1) * sc_.map_size_i(2)) / sc_.map_size_i(2);
-    id(2) = hash_id - id(0) * sc_.map_size_i(1) * sc_.map_size_i(2) - id(1) * sc_.map_size_i(2);
-    id -= sc_.half_map_size_i;
+    hashIdToLocalIndex(hash_id, id);
     localIndexToGlobalIndex(id, id_g);
 }
 
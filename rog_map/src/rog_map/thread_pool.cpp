@@ -0,0 +1,110 @@
+/**
+* This file is part of ROG-Map
+*
+* Copyright 2024 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/ROG-Map>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* ROG-Map is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ROG-Map is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with ROG-Map. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <rog_map/rog_map_core/thread_pool.h>
+#include <algorithm>
+
+namespace rog_map {
+
+    ThreadPool::ThreadPool(const int &thread_num) {
+        thread_num_ = std::max(1, thread_num);
+        for (int i = 1; i < thread_num_; i++) {
+            workers_.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lck(mtx_);
+            stop_ = true;
+        }
+        job_cv_.notify_all();
+        for (auto &w: workers_) {
+            w.join();
+        }
+    }
+
+    void ThreadPool::parallelFor(const int &task_num, const std::function<void(const int &)> &f) {
+        if (task_num <= 0) {
+            return;
+        }
+        if (workers_.empty() || task_num == 1) {
+            for (int i = 0; i < task_num; i++) {
+                f(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lck(mtx_);
+            job_ = &f;
+            task_num_ = task_num;
+            next_task_ = 0;
+            finished_task_ = 0;
+            job_id_++;
+        }
+        job_cv_.notify_all();
+        runTasks();
+        std::unique_lock<std::mutex> lck(mtx_);
+        done_cv_.wait(lck, [this] { return finished_task_ == task_num_; });
+        job_ = nullptr;
+    }
+
+    void ThreadPool::runTasks() {
+        while (true) {
+            int task_id;
+            const std::function<void(const int &)> *job;
+            {
+                std::lock_guard<std::mutex> lck(mtx_);
+                if (job_ == nullptr || next_task_ >= task_num_) {
+                    return;
+                }
+                task_id = next_task_++;
+                job = job_;
+            }
+            (*job)(task_id);
+            bool all_done;
+            {
+                std::lock_guard<std::mutex> lck(mtx_);
+                all_done = ++finished_task_ == task_num_;
+            }
+            if (all_done) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    void ThreadPool::workerLoop() {
+        long last_job_id = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lck(mtx_);
+                job_cv_.wait(lck, [&] { return stop_ || job_id_ != last_job_id; });
+                if (stop_) {
+                    return;
+                }
+                last_job_id = job_id_;
+            }
+            runTasks();
+        }
+    }
+}
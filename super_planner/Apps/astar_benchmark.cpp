@@ -0,0 +1,204 @@
+/**
+* This file is part of SUPER
+*
+* Copyright 2025 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/SUPER>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* SUPER is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SUPER is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SUPER. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Benchmark of the A* open sets and of jump point search on a pcd map, run the same start
+ * and goal pairs with each of them and report the expanded nodes per second. Then replan
+ * along the paths with obstacles dropped ahead, from scratch and with the incremental search.
+ * Usage: rosrun super_planner astar_benchmark [query_num] [config_file] [pcd_file]
+ * */
+
+#include "ros_interface/ros1/ros1_interface.hpp"
+#include "path_search/astar.h"
+#include <pcl/io/pcd_io.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace path_search;
+using rog_map::Vec3f;
+
+struct QueryPair {
+    Vec3f start, goal;
+};
+
+struct BenchResult {
+    double search_ms{0}, path_len{0};
+    long long iter_num{0};
+    int reach_num{0};
+};
+
+static double msSince(const std::chrono::high_resolution_clock::time_point &t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+/* Random start and goal pairs in the map, moved to the nearest free cell of the inflation map */
+static std::vector<QueryPair> samplePairs(const rog_map::ROGMapROS::Ptr &map, const Vec3f &box_min,
+                                          const Vec3f &box_max, const int &query_num) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> ux(box_min.x(), box_max.x());
+    std::uniform_real_distribution<double> uy(box_min.y(), box_max.y());
+    std::uniform_real_distribution<double> uz(box_min.z(), box_max.z());
+    std::vector<QueryPair> pairs;
+    while (static_cast<int>(pairs.size()) < query_num) {
+        QueryPair q;
+        if (!map->getNearestInfCellNot(OCCUPIED, Vec3f(ux(rng), uy(rng), uz(rng)), q.start, 1.0) ||
+            !map->getNearestInfCellNot(OCCUPIED, Vec3f(ux(rng), uy(rng), uz(rng)), q.goal, 1.0)) {
+            continue;
+        }
+        pairs.push_back(q);
+    }
+    return pairs;
+}
+
+static BenchResult runQueries(Astar &astar, const std::vector<QueryPair> &pairs, const int &flag) {
+    BenchResult res;
+    rog_map::vec_Vec3f path;
+    for (const auto &q: pairs) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        const RET_CODE ret = astar.pointToPointPathSearch(q.start, q.goal, flag, -1, path, 10.0);
+        res.search_ms += msSince(t0);
+        res.iter_num += astar.getIterNum();
+        if (ret != REACH_GOAL) {
+            continue;
+        }
+        res.reach_num++;
+        for (size_t i = 1; i < path.size(); i++) {
+            res.path_len += (path[i] - path[i - 1]).norm();
+        }
+    }
+    return res;
+}
+
+/* Walk each path a few cells per replan, and drop a small obstacle on it ahead before the next
+ * replan. Both searches run on the same map at each replan, the first search of a pair is not
+ * counted since the incremental one starts over there.
+ * */
+static void runReplans(Astar &astar, const rog_map::ROGMapROS::Ptr &map, const std::vector<QueryPair> &pairs,
+                       const int &flag, const int &replan_num, BenchResult &scratch, BenchResult &incremental) {
+    const double res = map->getInfResolution();
+    rog_map::vec_Vec3f path, inc_path;
+    for (const auto &q: pairs) {
+        Vec3f start = q.start;
+        for (int i = 0; i <= replan_num; i++) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            const RET_CODE inc_ret = astar.pointToPointPathSearch(start, q.goal, flag | USE_INCREMENTAL, -1,
+                                                                  inc_path, 10.0);
+            const double inc_ms = msSince(t0);
+            const int inc_iter = astar.getIterNum();
+            t0 = std::chrono::high_resolution_clock::now();
+            const RET_CODE ret = astar.pointToPointPathSearch(start, q.goal, flag, -1, path, 10.0);
+            if (i > 0) {
+                scratch.search_ms += msSince(t0);
+                scratch.iter_num += astar.getIterNum();
+                scratch.reach_num += ret == REACH_GOAL;
+                incremental.search_ms += inc_ms;
+                incremental.iter_num += inc_iter;
+                incremental.reach_num += inc_ret == REACH_GOAL;
+            }
+            if (ret != REACH_GOAL || path.size() < 20) {
+                break;
+            }
+            start = path[4];
+            const Vec3f center = path[15];
+            rog_map::PointCloud blob;
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dz = -1; dz <= 1; dz++) {
+                        pcl::PointXYZI pt;
+                        pt.x = center.x() + dx * res;
+                        pt.y = center.y() + dy * res;
+                        pt.z = center.z() + dz * res;
+                        blob.push_back(pt);
+                    }
+                }
+            }
+            map->updateOccPointCloud(blob);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ros::init(argc, argv, "astar_benchmark");
+    ros::NodeHandle nh("~");
+    pcl::console::setVerbosityLevel(pcl::console::L_ALWAYS);
+
+    const int query_num = argc > 1 ? std::atoi(argv[1]) : 200;
+    const std::string cfg_path = argc > 2 ? argv[2] : std::string(ROOT_DIR) + "config/static_high_speed.yaml";
+    const std::string pcd_path = argc > 3 ? argv[3] : std::string(ROOT_DIR) +
+                                                      "../mars_uav_sim/perfect_drone_sim/pcd/random_map_24_6635.pcd";
+
+    auto ros_ptr = std::make_shared<ros_interface::Ros1Interface>(nh);
+    auto map = std::make_shared<rog_map::ROGMapROS>(nh, cfg_path);
+    rog_map::PointCloud cloud;
+    if (pcl::io::loadPCDFile(pcd_path, cloud) == -1) {
+        printf(" -- [A* Benchmark] Load pcd file at [%s] failed.\n", pcd_path.c_str());
+        return -1;
+    }
+    map->updateOccPointCloud(cloud);
+    Vec3f box_min = Vec3f::Constant(1e9), box_max = Vec3f::Constant(-1e9);
+    for (const auto &pt: cloud) {
+        const Vec3f p(pt.x, pt.y, pt.z);
+        if (!p.allFinite()) {
+            continue;
+        }
+        box_min = box_min.cwiseMin(p);
+        box_max = box_max.cwiseMax(p);
+    }
+    box_min.z() = std::max(box_min.z(), 0.5);
+    box_max.z() = std::min(box_max.z(), 3.0);
+
+    Astar astar(cfg_path, ros_ptr, map);
+    const std::vector<QueryPair> pairs = samplePairs(map, box_min, box_max, query_num);
+    printf(" -- [A* Benchmark] %d start and goal pairs on [%s] --\n", query_num, pcd_path.c_str());
+    printf("%-16s %12s %12s %16s %10s %14s\n", "mode", "search(ms)", "expanded", "expanded/s", "reached",
+           "path len(m)");
+    struct SearchMode {
+        const char *name;
+        int open_set_type;
+        int flag;
+    };
+    const int flag = ON_INF_MAP | UNKNOWN_AS_FREE;
+    const SearchMode modes[] = {{"binary heap", OPEN_SET_BINARY_HEAP, flag},
+                                {"bucket queue", OPEN_SET_BUCKET_QUEUE, flag},
+                                {"jps", OPEN_SET_BINARY_HEAP, flag | USE_JPS}};
+    for (const auto &mode: modes) {
+        astar.setOpenSetType(mode.open_set_type, 0.1);
+        // The first round is a warm up
+        runQueries(astar, pairs, mode.flag);
+        const BenchResult res = runQueries(astar, pairs, mode.flag);
+        printf("%-16s %12.1f %12lld %16.0f %10d %14.2f\n", mode.name, res.search_ms, res.iter_num,
+               res.iter_num / (res.search_ms * 1e-3), res.reach_num, res.path_len);
+    }
+
+    // The replans change the map, so they run last
+    astar.setOpenSetType(OPEN_SET_BINARY_HEAP, 0.1);
+    BenchResult scratch, incremental;
+    runReplans(astar, map, pairs, flag, 8, scratch, incremental);
+    printf(" -- [A* Benchmark] Replans along the paths with obstacles dropped ahead --\n");
+    printf("%-16s %12s %12s %10s\n", "mode", "search(ms)", "expanded", "reached");
+    printf("%-16s %12.1f %12lld %10d\n", "from scratch", scratch.search_ms, scratch.iter_num, scratch.reach_num);
+    printf("%-16s %12.1f %12lld %10d\n", "incremental", incremental.search_ms, incremental.iter_num,
+           incremental.reach_num);
+    return 0;
+}
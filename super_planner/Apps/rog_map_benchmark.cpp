@@ -0,0 +1,406 @@
+/**
+* This file is part of SUPER
+*
+* Copyright 2025 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/SUPER>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* SUPER is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SUPER is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SUPER. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Micro benchmarks of ROG-Map. The batched raycaster is first checked against RayCaster,
+ * and the app exits with 1 if they visit different cells.
+ * Usage: rog_map_benchmark [step_num] [config_file] [flat|brick]
+ * The last argument is the layout of the prob map sliding benchmark, a process holds
+ * only one ProbMap.
+ * */
+
+#include <rog_map/prob_map.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+using namespace rog_map;
+using super_utils::Quatf;
+
+class BenchMap : public SlidingMap {
+public:
+    BenchMap(const Vec3i &half_map_size_i, const double &resolution, const bool &brick_layout_en) {
+        initSlidingMap(half_map_size_i, resolution, true, 0.0, Vec3f::Zero(), brick_layout_en);
+        buffer_.resize(sc_.map_vox_num, 0.0f);
+    }
+
+    /* Write every cell of the box around pos, as the raycasting does */
+    void fillBox(const Vec3f &pos, const int &half_box_i, const float &val) {
+        Vec3i center;
+        posToGlobalIndex(pos, center);
+        Vec3i id_g;
+        for (id_g.x() = center.x() - half_box_i; id_g.x() <= center.x() + half_box_i; id_g.x()++) {
+            for (id_g.y() = center.y() - half_box_i; id_g.y() <= center.y() + half_box_i; id_g.y()++) {
+                for (id_g.z() = center.z() - half_box_i; id_g.z() <= center.z() + half_box_i; id_g.z()++) {
+                    if (!insideLocalMap(id_g)) {
+                        continue;
+                    }
+                    buffer_[getHashIndexFromGlobalIndex(id_g)] = val;
+                }
+            }
+        }
+    }
+
+    /* Read every cell of the box around pos, as the box search does */
+    double sumBox(const Vec3f &pos, const int &half_box_i) const {
+        Vec3i center;
+        posToGlobalIndex(pos, center);
+        double sum = 0;
+        Vec3i id_g;
+        for (id_g.x() = center.x() - half_box_i; id_g.x() <= center.x() + half_box_i; id_g.x()++) {
+            for (id_g.y() = center.y() - half_box_i; id_g.y() <= center.y() + half_box_i; id_g.y()++) {
+                for (id_g.z() = center.z() - half_box_i; id_g.z() <= center.z() + half_box_i; id_g.z()++) {
+                    if (!insideLocalMap(id_g)) {
+                        continue;
+                    }
+                    sum += buffer_[getHashIndexFromGlobalIndex(id_g)];
+                }
+            }
+        }
+        return sum;
+    }
+
+    int memoryCellNum() const {
+        return sc_.map_vox_num;
+    }
+
+protected:
+    std::vector<float> buffer_;
+
+    void resetLocalMap() override {
+        std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+    }
+
+    void resetCell(const int &hash_id) override {
+        buffer_[hash_id] = 0.0f;
+    }
+
+    void resetBricks(const vector<int> &brick_hash) override {
+        for (const auto &brick: brick_hash) {
+            std::fill_n(buffer_.begin() + (brick << (3 * BRICK_BIT)), 1 << (3 * BRICK_BIT), 0.0f);
+        }
+    }
+};
+
+struct BenchResult {
+    double slide_ms{0}, fill_ms{0}, query_ms{0}, checksum{0};
+};
+
+static double msSince(const std::chrono::high_resolution_clock::time_point &t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+static BenchResult runBench(const bool &brick_layout_en, const int &step_num) {
+    const Vec3i half_map_size_i(200, 200, 30);
+    const double resolution = 0.1;
+    BenchMap map(half_map_size_i, resolution, brick_layout_en);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    BenchResult res;
+    Vec3f odom = Vec3f::Zero();
+    for (int step = 0; step < step_num; step++) {
+        // A drone flying at about 5 m/s with a 10 Hz map update.
+        odom += Vec3f(0.5, 0.1 * u(rng), 0.02 * u(rng));
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        map.mapSliding(odom);
+        res.slide_ms += msSince(t0);
+
+        t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 20; i++) {
+            const Vec3f p = odom + Vec3f(15 * u(rng), 15 * u(rng), 2 * u(rng));
+            map.fillBox(p, 8, 1.0f);
+        }
+        res.fill_ms += msSince(t0);
+
+        t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 200; i++) {
+            const Vec3f p = odom + Vec3f(15 * u(rng), 15 * u(rng), 2 * u(rng));
+            res.checksum += map.sumBox(p, 5);
+        }
+        res.query_ms += msSince(t0);
+    }
+    res.slide_ms /= step_num;
+    res.fill_ms /= step_num;
+    res.query_ms /= step_num;
+    return res;
+}
+
+class BenchProbMap : public ProbMap {
+public:
+    BenchProbMap(const std::string &cfg_path, const bool &brick_layout_en) {
+        cfg_ = rog_map::Config(cfg_path);
+        cfg_.brick_layout_en = brick_layout_en;
+        initProbMap();
+    }
+
+    bool per_cell_reset{false};
+
+    /* Fill the map with a scan of a cylindrical wall around pos */
+    void scanAround(const Vec3f &pos) {
+        PointCloud cloud;
+        for (int i = 0; i < 20000; i++) {
+            const double yaw = 2 * M_PI * i / 20000.0;
+            const double z = 3.0 * (i % 100) / 100.0;
+            pcl::PointXYZI pt;
+            pt.x = pos.x() + 8.0 * cos(yaw);
+            pt.y = pos.y() + 8.0 * sin(yaw);
+            pt.z = z;
+            pt.intensity = 100;
+            cloud.push_back(pt);
+        }
+        updateProbMap(cloud, Pose(pos, Quatf(1, 0, 0, 0)));
+    }
+
+    double timeSliding(const Vec3f &pos) {
+        waitForPendingUpdate();
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        slideAllMap(pos);
+        return msSince(t0);
+    }
+
+    double getResolution() const {
+        return sc_.resolution;
+    }
+
+protected:
+    void resetSlab(const vector<int> &slab_hash, const vec_E<Vec3i> &slab_id_g) override {
+        if (per_cell_reset) {
+            SlidingMap::resetSlab(slab_hash, slab_id_g);
+        } else {
+            ProbMap::resetSlab(slab_hash, slab_id_g);
+        }
+    }
+
+    void resetBricks(const vector<int> &brick_hash) override {
+        if (per_cell_reset) {
+            SlidingMap::resetBricks(brick_hash);
+        } else {
+            ProbMap::resetBricks(brick_hash);
+        }
+    }
+};
+
+/* Time the sliding of all map layers against the shift distance, with the batched
+ * slab reset and with the per-cell reset of the prob map. In the brick layout, the
+ * batched reset also fills the evicted bricks in bulk */
+static void runSlidingBench(const std::string &cfg_path, const bool &brick_layout_en) {
+    BenchProbMap map(cfg_path, brick_layout_en);
+    const double res = map.getResolution();
+    printf(" -- [ROG-Map Benchmark] map sliding, %s layout, time per slide --\n", brick_layout_en ? "brick" : "flat");
+    printf("%-12s %14s %14s\n", "shift(cell)", "batched(ms)", "per-cell(ms)");
+    Vec3f odom(0, 0, 1.0);
+    const int rep_num = 5;
+    for (const int shift: {1, 2, 4, 8, 16, 32}) {
+        double t[2] = {0, 0};
+        // The first round is a warm up
+        for (int rep = 0; rep <= rep_num; rep++) {
+            for (int mode = 0; mode < 2; mode++) {
+                map.per_cell_reset = mode == 1;
+                map.scanAround(odom);
+                odom.x() += shift * res;
+                const double dt = map.timeSliding(odom);
+                t[mode] += rep > 0 ? dt : 0.0;
+            }
+        }
+        printf("%-12d %14.3f %14.3f\n", shift, t[0] / rep_num, t[1] / rep_num);
+    }
+}
+
+/* Time the full ESDF update of a 20 m x 20 m x 5 m box at 0.1 m against the number
+ * of threads of the EDT passes. The speedup is bounded by the hardware threads, which
+ * are printed with the results. */
+static void runESDFBench() {
+    printf(" -- [ROG-Map Benchmark] full ESDF update of a 20x20x5 m box, time per update, %u hardware threads --\n",
+           std::thread::hardware_concurrency());
+    printf("%-12s %14s %10s\n", "threads", "update(ms)", "speedup");
+    const int rep_num = 5;
+    double serial_ms = 0;
+    for (const int thread_num: {1, 2, 4, 8}) {
+        ESDFMap map;
+        map.initESDFMap(Vec3i(110, 110, 30), 0.1, 0.1, Vec3f(20, 20, 5), false, 0.0,
+                        Vec3f::Zero(), 0.7, false, 3.0, thread_num);
+        map.mapSliding(Vec3f::Zero());
+        // Pillars of 0.5 m x 0.5 m over the whole height
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        for (int i = 0; i < 200; i++) {
+            const Vec3f center(10 * u(rng), 10 * u(rng), 0);
+            for (double dx = -0.25; dx < 0.25; dx += 0.1) {
+                for (double dy = -0.25; dy < 0.25; dy += 0.1) {
+                    for (double z = -2.5; z < 2.5; z += 0.1) {
+                        map.updateGridCounter(center + Vec3f(dx, dy, z), GridType::UNKNOWN, GridType::OCCUPIED);
+                    }
+                }
+            }
+        }
+        double t = 0;
+        // The first round is a warm up
+        for (int rep = 0; rep <= rep_num; rep++) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            map.updateESDF3D(Vec3f::Zero());
+            t += rep > 0 ? msSince(t0) : 0.0;
+        }
+        t /= rep_num;
+        serial_ms = thread_num == 1 ? t : serial_ms;
+        printf("%-12d %14.3f %10.2f\n", thread_num, t, serial_ms / t);
+    }
+}
+
+/* Check that BatchRayCaster visits the same cells as RayCaster, with the scalar and with the
+ * AVX2 lane update. The rays are random, axis aligned, zero length, inside one cell, and with
+ * the end points on the cell bounds. Returns false on the first ray with different cells.
+ * */
+static bool runRaycasterCheck(const int &ray_num) {
+    const double res = 0.1;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> u(-10.0, 10.0);
+    std::uniform_int_distribution<int> ui(-100, 100);
+    vec_Vec3f starts, ends;
+    for (int i = 0; i < ray_num; i++) {
+        Vec3f start(u(rng), u(rng), u(rng)), end(u(rng), u(rng), u(rng));
+        switch (i % 5) {
+            case 1:
+                // Along one axis
+                end = start;
+                end(i % 3) += u(rng);
+                break;
+            case 2:
+                // Zero length, or inside the cell of the start
+                end = i % 2 ? start : start + Vec3f::Constant(0.1 * res);
+                break;
+            case 3:
+                // On the cell bounds
+                start = Vec3f(ui(rng), ui(rng), ui(rng)) * res;
+                end = Vec3f(ui(rng), ui(rng), ui(rng)) * res;
+                break;
+            case 4:
+                // Along a diagonal through the cell corners
+                end = start + Vec3f::Constant(u(rng));
+                break;
+            default:
+                break;
+        }
+        starts.push_back(start);
+        ends.push_back(end);
+    }
+
+    // A ray through a cell corner can pass by its end cell and never stop, ProbMap stops it at
+    // the map border, here it is stopped one cell out of the box of its end points
+    raycaster::RayCaster ray_caster(res);
+    std::vector<Vec3i> box_min(ray_num), box_max(ray_num);
+    for (int i = 0; i < ray_num; i++) {
+        Vec3i start_id, end_id;
+        for (int axis = 0; axis < 3; axis++) {
+            ray_caster.posToIndex(starts[i](axis), start_id(axis));
+            ray_caster.posToIndex(ends[i](axis), end_id(axis));
+        }
+        box_min[i] = start_id.cwiseMin(end_id) - Vec3i::Ones();
+        box_max[i] = start_id.cwiseMax(end_id) + Vec3i::Ones();
+    }
+    auto inside_box = [&](const int &i, const Vec3i &id_g) {
+        return (id_g - box_min[i]).minCoeff() >= 0 && (box_max[i] - id_g).minCoeff() >= 0;
+    };
+
+    // The cells of RayCaster, as global index
+    std::vector<std::vector<Vec3i>> expect(ray_num);
+    for (int i = 0; i < ray_num; i++) {
+        if (!ray_caster.setInput(starts[i], ends[i])) {
+            continue;
+        }
+        Vec3f ray_pt;
+        while (ray_caster.step(ray_pt)) {
+            Vec3i id_g;
+            for (int axis = 0; axis < 3; axis++) {
+                ray_caster.posToIndex(ray_pt(axis), id_g(axis));
+            }
+            if (!inside_box(i, id_g)) {
+                break;
+            }
+            expect[i].push_back(id_g);
+        }
+    }
+
+    printf(" -- [ROG-Map Benchmark] batched raycaster against RayCaster, %d rays --\n", ray_num);
+    printf("%-8s %12s %12s %10s\n", "lanes", "walk(ms)", "cells", "result");
+    raycaster::BatchRayCaster batch;
+    batch.setResolution(res);
+    bool pass = true;
+    for (const bool avx2: {false, true}) {
+        batch.setAVX2Enabled(avx2);
+        if (avx2 && !batch.isAVX2Enabled()) {
+            printf("%-8s %12s %12s %10s\n", "avx2", "-", "-", "skipped");
+            continue;
+        }
+        std::vector<std::vector<Vec3i>> got(ray_num);
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        batch.walk(starts, ends, [&](const int &i, const Vec3i &id_g) {
+            if (!inside_box(i, id_g)) {
+                return false;
+            }
+            got[i].push_back(id_g);
+            return true;
+        });
+        const double walk_ms = msSince(t0);
+        long long cell_num = 0;
+        int bad_ray = -1;
+        for (int i = 0; i < ray_num; i++) {
+            cell_num += static_cast<long long>(got[i].size());
+            if (bad_ray < 0 && got[i] != expect[i]) {
+                bad_ray = i;
+            }
+        }
+        printf("%-8s %12.3f %12lld %10s\n", avx2 ? "avx2" : "scalar", walk_ms, cell_num,
+               bad_ray < 0 ? "same" : "DIFFERENT");
+        if (bad_ray >= 0) {
+            printf(" -- [ROG-Map Benchmark] ray %d from [%f %f %f] to [%f %f %f] differs.\n", bad_ray,
+                   starts[bad_ray].x(), starts[bad_ray].y(), starts[bad_ray].z(),
+                   ends[bad_ray].x(), ends[bad_ray].y(), ends[bad_ray].z());
+            pass = false;
+        }
+    }
+    return pass;
+}
+
+int main(int argc, char **argv) {
+    const int step_num = argc > 1 ? std::atoi(argv[1]) : 100;
+    const std::string cfg_path = argc > 2 ? argv[2] : std::string(ROOT_DIR) + "config/static_high_speed.yaml";
+
+    if (!runRaycasterCheck(200000)) {
+        return 1;
+    }
+
+    printf(" -- [ROG-Map Benchmark] sliding map layout, %d steps, time per step --\n", step_num);
+    printf("%-8s %12s %12s %12s %14s\n", "layout", "slide(ms)", "fill(ms)", "query(ms)", "checksum");
+    for (const bool brick : {false, true}) {
+        const BenchResult res = runBench(brick, step_num);
+        printf("%-8s %12.3f %12.3f %12.3f %14.1f\n", brick ? "brick" : "flat",
+               res.slide_ms, res.fill_ms, res.query_ms, res.checksum);
+    }
+
+    runSlidingBench(cfg_path, argc > 3 && std::string(argv[3]) == "brick");
+    runESDFBench();
+    return 0;
+}
@@ -26,10 +26,14 @@
 
 #include "Eigen/Dense"
 #include "vector"
+#include "memory"
+#include "cstdlib"
 #include "rog_map_ros/rog_map_ros1.hpp"
 #include "rog_map_ros/rog_map_ros2.hpp"
 #include "queue"
 #include "path_search/config.hpp"
+#include "path_search/open_set.h"
+#include "path_search/jps_neighbor.h"
 #include "utils/header/type_utils.hpp"
 #include <ros_interface/ros_interface.hpp>
 
@@ -41,32 +45,112 @@ namespace path_search {
     struct GridNode;
     typedef GridNode *GridNodePtr;
 
+    /* The fields of a node read at every expansion. The nodes live in a zeroed arena indexed
+     * by the local hash of the search, a node is only valid when its rounds equals the
+     * current round, so the arena is never reset between searches.
+     * */
     struct GridNode {
-        enum enum_state {
+        enum enum_state : uint8_t {
             OPENSET = 1,
             CLOSEDSET = 2,
             UNDEFINED = 3
-        } state{UNDEFINED};
+        };
+
+        double total_score, distance_score;
+        int rounds;
+        /* The position in the open set, only valid while the node is in it */
+        int heap_id;
+        enum_state state;
+        /* The cell state of the jumps, valid when jps_rounds equals the current round. The
+         * jumps of a search cross the same cells many times, and these fields fit in the
+         * padding of the node. Bit i of no_jump_dirs is set when a straight jump from the cell
+         * along the direction with straight id i meets no jump point.
+         * */
+        bool blocked;
+        uint8_t no_jump_dirs;
+        int jps_rounds;
+    };
+
+    /* The fields of a node only read when a path is retrieved or a frontier is ranked,
+     * kept apart to leave more hot nodes per cache line.
+     * */
+    struct GridNodeLink {
+        double distance_to_goal;
+        /* The arena index of the father, -1 for none */
+        int father_id;
+    };
 
-        int rounds{0};
-        rog_map::Vec3i id_g;
-        double total_score{inf}, distance_score{inf};
-        double distance_to_goal{inf};
-        GridNodePtr father_ptr{nullptr};
+    /* A node of the incremental search, which searches from the goal to the start. g is the
+     * cost from the node to the goal, rhs the lookahead of g over its neighbors, and the key
+     * of the node in the open set is (total_score, min(g, rhs)). A node is only valid when
+     * its session equals the current session, and blocked keeps the cell type it was
+     * searched with, so a change of the map is found by comparing it with the map.
+     * */
+    struct IncrementalNode {
+        double g, rhs, total_score;
+        /* The position in the open set, -1 when not in it */
+        int heap_id;
+        int session;
+        bool blocked;
     };
 
-    class NodeComparator {
+    struct IncrementalNodeLess {
+        bool operator()(const IncrementalNode *a, const IncrementalNode *b) const {
+            if (a->total_score != b->total_score) {
+                return a->total_score < b->total_score;
+            }
+            return std::min(a->g, a->rhs) < std::min(b->g, b->rhs);
+        }
+    };
+
+    /* A zeroed and cache line aligned array. calloc leaves the pages untouched until a node
+     * of them is written, so a large search map costs nothing until it is searched.
+     * */
+    template<typename T>
+    class NodeArena {
     public:
-        bool operator()(GridNodePtr node1, GridNodePtr node2) {
-            return node1->total_score > node2->total_score;
+        static constexpr size_t CACHE_LINE_SIZE = 64;
+
+        void resize(const size_t &num) {
+            raw_.reset(std::calloc(num * sizeof(T) + CACHE_LINE_SIZE, 1));
+            if (raw_ == nullptr) {
+                throw std::bad_alloc();
+            }
+            const auto addr = reinterpret_cast<uintptr_t>(raw_.get());
+            data_ = reinterpret_cast<T *>((addr + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1));
+        }
+
+        T *data() const {
+            return data_;
         }
+
+        T &operator[](const int &id) const {
+            return data_[id];
+        }
+
+    private:
+        struct FreeDeleter {
+            void operator()(void *ptr) const {
+                std::free(ptr);
+            }
+        };
+
+        std::unique_ptr<void, FreeDeleter> raw_;
+        T *data_{nullptr};
     };
 
     class FrontierComparator {
     public:
+        explicit FrontierComparator(const NodeArena<GridNode> &nodes, const NodeArena<GridNodeLink> &links)
+                : nodes_(nodes.data()), links_(links.data()) {}
+
         bool operator()(GridNodePtr node1, GridNodePtr node2) {
-            return node1->distance_to_goal > node2->distance_to_goal;
+            return links_[node1 - nodes_].distance_to_goal > links_[node2 - nodes_].distance_to_goal;
         }
+
+    private:
+        const GridNode *nodes_;
+        const GridNodeLink *links_;
     };
 
     const int ON_INF_MAP = (1 << 0);
@@ -75,6 +159,13 @@ namespace path_search {
     const int UNKNOWN_AS_FREE = (1 << 4);
     const int USE_INF_NEIGHBOR = (1 << 5);
     const int DONT_USE_INF_NEIGHBOR = (1 << 6);
+    /* Jump point search in pointToPointPathSearch, only with allow_diag */
+    const int USE_JPS = (1 << 7);
+    /* Repair the search of the last call with the same goal, see incrementalPathSearch.
+     * Only on the inf map, and it takes precedence over USE_JPS. When it finds no path,
+     * pointToPointPathSearch runs the plain search, so the return codes stay the same.
+     * */
+    const int USE_INCREMENTAL = (1 << 8);
 
     class Astar {
 
@@ -83,12 +174,43 @@ namespace path_search {
 
         PathSearchConfig cfg_;
         const double tie_breaker_ = 1.0 + 1e-5;
-        rog_map::vec_Vec3i sorted_pts;
         rog_map::vec_Vec3i neighbor_list;
 
-        vector<GridNodePtr> grid_node_buffer_;
+        NodeArena<GridNode> grid_nodes_;
+        NodeArena<GridNodeLink> grid_node_links_;
+        /* Kept between searches to reuse its memory */
+        NodeOpenSet<GridNode> open_set_;
+
+        JpsNeighbor jps_neighbor_;
+        /* The successor directions of the expanded jump point */
+        rog_map::vec_Vec3i jps_succ_dirs_;
 
         int rounds_{0};
+        /* The number of nodes expanded by the last search */
+        int num_iter_{0};
+
+        /* The incremental search kept between the calls. The search map is fixed while it is
+         * reused, and the changes of the map are read from the jumping edges of the inf map.
+         * */
+        struct IncrementalData {
+            NodeArena<IncrementalNode> nodes;
+            IndexedNodeHeap<IncrementalNode, IncrementalNodeLess> open_set;
+            /* 0 is the session of the zeroed nodes */
+            int session{0};
+            bool valid{false};
+            int flag{0};
+            rog_map::Vec3f goal_pt;
+            rog_map::Vec3i goal_idx, start_idx;
+            rog_map::Vec3i local_map_center_id_g;
+            rog_map::Vec3f local_map_center_d;
+            /* The sum of the heuristic between the starts of the calls, added to the keys */
+            double km{0};
+            rog_map::vec_Vec3i steps;
+            std::vector<double> step_costs;
+            uint64_t edge_seq{0};
+            std::vector<rog_map::CounterMap::JumpingEdge> edges;
+            rog_map::Vec3f map_origin;
+        } inc_;
 
         static constexpr int DIAG = 0;
         static constexpr int MANH = 1;
@@ -103,6 +225,8 @@ namespace path_search {
             bool unknown_as_occ{false};
             bool unknown_as_free{false};
             bool use_inf_neighbor{false};
+            bool use_jps{false};
+            bool use_incremental{false};
             double resolution;
             rog_map::Vec3i local_map_center_id_g;
             rog_map::Vec3f local_map_center_d;
@@ -113,9 +237,24 @@ namespace path_search {
 
 
 
-        double getHeu(GridNodePtr node1, GridNodePtr node2, int type = DIAG) const;
+        double getHeu(const rog_map::Vec3i &id_1, const rog_map::Vec3i &id_2, int type = DIAG) const;
+
+        int getLocalIndexHash(const rog_map::Vec3i &id_in) const;
 
-         int getLocalIndexHash(const rog_map::Vec3i &id_in) const;
+        /* The inverse of getLocalIndexHash */
+        rog_map::Vec3i getGlobalIndexFromHash(const int &hash_id) const;
+
+        int getNodeIndex(const GridNode *node) const {
+            return static_cast<int>(node - grid_nodes_.data());
+        }
+
+        GridNodeLink &getNodeLink(const GridNode *node) const {
+            return grid_node_links_[getNodeIndex(node)];
+        }
+
+        rog_map::Vec3i getNodeGlobalIndex(const GridNode *node) const {
+            return getGlobalIndexFromHash(getNodeIndex(node));
+        }
 
         void posToGlobalIndex(const rog_map::Vec3f &pos, rog_map::Vec3i &id_g) const ;
 
@@ -127,12 +266,96 @@ namespace path_search {
 
         bool neighborHaveOne(const rog_map::GridType &type, const rog_map::Vec3i &src_id);
 
+        /* The type of a cell as a neighbor of an expanded node, OUT_OF_MAP outside the search map */
+        rog_map::GridType getSearchGridType(const rog_map::Vec3i &id_g);
+
+        /* Whether the search skips a cell of this type */
+        bool isBlockedType(const rog_map::GridType &type) const {
+            return type == OCCUPIED || type == OUT_OF_MAP ||
+                   (md_.unknown_as_occ && type == UNKNOWN);
+        }
+
+        /* The node of a cell inside the search map, with its jump state reset for this round */
+        GridNode &getJpsNode(const rog_map::Vec3i &id_g);
+
+        /* isBlockedType of the cell at id_g, cached in its node for the current round */
+        bool isJpsBlocked(const rog_map::Vec3i &id_g);
+
+        /* Whether the node at id_g reached along jd has a forced neighbor, the directions of
+         * the forced neighbors are appended to forced_dirs if it is not null.
+         * */
+        bool getForcedNeighbors(const rog_map::Vec3i &id_g, const JpsDirection &jd,
+                                rog_map::vec_Vec3i *forced_dirs);
+
+        /* Step from id_g along dir until a jump point: the goal, a node with a forced neighbor,
+         * a diagonal node from which a jump along a sub direction meets a jump point, or the
+         * first node beyond horizon_score. Returns false if a blocked cell is hit first.
+         * distance_score is updated to the one of the jump point.
+         * */
+        bool jump(const rog_map::Vec3i &id_g, const rog_map::Vec3i &dir, const rog_map::Vec3i &end_idx,
+                  const double &horizon_score, rog_map::Vec3i &jump_pt, double &distance_score);
+
+        /* Push the jump points reached from current along its natural and forced neighbors */
+        void expandJumpPoint(GridNodePtr current, const rog_map::Vec3i &current_id_g,
+                             const rog_map::Vec3i &end_idx, const double &horizon_score);
+
+        /* Insert the cells skipped by the jumps between the consecutive nodes of a path */
+        void fillJumpPath(vector<int> &node_path) const;
+
+        /* Move an end point outside the search map to the map border along the line to
+         * seed_pt, and then to the nearest free cell. Returns false if no free cell is near.
+         * */
+        bool getLocalEndPoint(const rog_map::Vec3f &end_pt, const rog_map::Vec3f &seed_pt,
+                              rog_map::Vec3f &local_end_pt);
+
+        /* D* Lite from the goal to the start. While the goal, the flag and the search map
+         * are the same, a call only repairs the nodes whose cost to the goal changed with
+         * the map, and a moving start only changes the heuristic. A time out keeps the
+         * search, which goes on at the next call.
+         * */
+        RET_CODE incrementalPathSearch(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &end_pt,
+                                       const int &flag, const double &searching_horizon,
+                                       rog_map::vec_Vec3f &out_path, const double &time_out);
+
+        /* Start a new session of the incremental search in the search map set by setup */
+        RET_CODE resetIncrementalSearch(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &end_pt,
+                                        const int &flag);
+
+        /* Update the nodes of the cells changed since the last call. Returns false if some
+         * changes were lost, then the search should be reset.
+         * */
+        bool applyIncrementalChanges();
+
+        /* Compare the cached type of a searched cell with the map, and repair the
+         * lookahead of its neighbors if it changed
+         * */
+        void checkIncrementalCell(const rog_map::Vec3i &id_g);
+
+        /* The node of a cell inside the search map, initialized at its first access in the session */
+        IncrementalNode &getIncrementalNode(const rog_map::Vec3i &id_g);
+
+        /* Recompute the rhs of a node from its neighbors */
+        void updateIncrementalRhs(const rog_map::Vec3i &id_g);
+
+        /* The keys of D* Lite need a consistent heuristic, so heu_type is not used and the
+         * heuristic is the grid distance without obstacles, without the tie breaker.
+         * */
+        double getIncrementalHeu(const rog_map::Vec3i &id_1, const rog_map::Vec3i &id_2) const {
+            return getHeu(id_1, id_2, cfg_.allow_diag ? DIAG : MANH) / tie_breaker_;
+        }
+
+        /* Put a locally inconsistent node in the open set with its current key, and remove a consistent one */
+        void updateIncrementalVertex(IncrementalNode &node, const rog_map::Vec3i &id_g);
+
+        RET_CODE computeIncrementalPath(const double &time_1, const double &time_out);
+
         RET_CODE setup(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &goal_pt, const int &flag,
                        const double &searching_horizon = 9999);
 
-        void retrievePath(GridNodePtr current, vector<GridNodePtr> &path);
+        /* The arena indices of the nodes from current back to the start */
+        void retrievePath(GridNodePtr current, vector<int> &path);
 
-        void ConvertNodePathToPointPath(const vector<GridNodePtr> &node_path, rog_map::vec_Vec3f &point_path);
+        void ConvertNodePathToPointPath(const vector<int> &node_path, rog_map::vec_Vec3f &point_path);
 
     public:
 
@@ -146,6 +369,12 @@ namespace path_search {
 
         void setVisualProcessEn(const bool &en);
 
+        void setOpenSetType(const int &open_set_type, const double &bucket_width);
+
+        int getIterNum() const {
+            return num_iter_;
+        }
+
         void setFineInfNeighbors(const int & neighbor_step);
 
         RET_CODE pointToPointPathSearch(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &end_pt,
@@ -0,0 +1,88 @@
+/**
+* This file is part of SUPER
+*
+* Copyright 2025 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/SUPER>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* SUPER is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SUPER is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SUPER. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "array"
+#include "vector"
+#include "cstdint"
+#include "utils/header/eigen_alias.hpp"
+
+namespace path_search {
+
+    /* The pruned neighbors of a node reached along a direction in the 26-connected grid */
+    struct JpsDirection {
+        /* The successors kept on a free neighborhood */
+        super_utils::vec_Vec3i natural;
+        /* The natural successors other than the direction itself, a diagonal jump stops
+         * where a jump along one of them meets a jump point */
+        super_utils::vec_Vec3i sub_dirs;
+        /* The neighbor cells a forced neighbor depends on, bit i of a mask is check_cells[i] */
+        super_utils::vec_Vec3i check_cells;
+
+        /* A successor pruned on a free neighborhood. Each mask is a set of cells whose path
+         * from the parent makes the successor reachable without the node, the successor is
+         * forced when every mask has a blocked cell.
+         * */
+        struct Forced {
+            super_utils::Vec3i dir;
+            std::vector<uint16_t> masks;
+        };
+        std::vector<Forced> forced;
+    };
+
+    /* The neighbor pruning rules of 3D jump point search, for the 26 directions and for the
+     * start node (the zero direction, which keeps all 26 neighbors). A neighbor x of node n
+     * reached from parent p is pruned when a path from p to x around n is shorter than
+     * p -> n -> x, or as long and canonical, i.e. its steps never get more diagonal, while
+     * p -> n -> x does. The rules are derived from this definition when the table is built,
+     * giving 1, 3 and 7 natural and 8, 12 and 12 forced neighbors for a straight, a 2D and a
+     * 3D diagonal direction.
+     * */
+    class JpsNeighbor {
+    public:
+        JpsNeighbor();
+
+        const JpsDirection &get(const super_utils::Vec3i &dir) const {
+            return dirs_[getOffsetId(dir)];
+        }
+
+        /* The index of a cell of the 3x3x3 neighborhood, 13 is the center */
+        static int getOffsetId(const super_utils::Vec3i &offset) {
+            return (offset.x() + 1) * 9 + (offset.y() + 1) * 3 + (offset.z() + 1);
+        }
+
+    private:
+        void buildDirection(const super_utils::Vec3i &dir, JpsDirection &jd) const;
+
+        /* Collect the cells of each path from cur to target around the center, see the class comment */
+        void searchAlternatives(const super_utils::Vec3i &cur, const super_utils::Vec3i &target,
+                                const double &cost, const double &via_cost, const bool &tie_en,
+                                const int &last_norm, const bool &canonical, const uint32_t &used,
+                                std::vector<uint32_t> &masks) const;
+
+        std::array<super_utils::Vec3i, 27> offsets_;
+        std::array<JpsDirection, 27> dirs_;
+    };
+}
@@ -0,0 +1,321 @@
+/**
+* This file is part of SUPER
+*
+* Copyright 2025 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/SUPER>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* SUPER is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SUPER is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SUPER. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "vector"
+#include "cmath"
+#include "cstdint"
+
+namespace path_search {
+
+    /* The open set types of PathSearchConfig::open_set_type */
+    const int OPEN_SET_BINARY_HEAP = 0;
+    const int OPEN_SET_BUCKET_QUEUE = 1;
+
+    template<typename NodeT>
+    struct NodeScoreLess {
+        bool operator()(const NodeT *a, const NodeT *b) const {
+            return a->total_score < b->total_score;
+        }
+    };
+
+    /* A binary min heap of nodes, on total_score by default. Each node keeps its position in
+     * the heap in heap_id, so a node whose score drops is moved up in place instead of being
+     * pushed again, and the heap never holds a stale entry.
+     * */
+    template<typename NodeT, typename Less = NodeScoreLess<NodeT>>
+    class IndexedNodeHeap {
+    public:
+        void clear() {
+            heap_.clear();
+        }
+
+        bool empty() const {
+            return heap_.empty();
+        }
+
+        size_t size() const {
+            return heap_.size();
+        }
+
+        void push(NodeT *node) {
+            node->heap_id = static_cast<int>(heap_.size());
+            heap_.push_back(node);
+            siftUp(node->heap_id);
+        }
+
+        NodeT *top() const {
+            return heap_.front();
+        }
+
+        NodeT *pop() {
+            NodeT *top = heap_.front();
+            remove(top);
+            return top;
+        }
+
+        /* The node should be in the heap and total_score should not increase */
+        void decreaseKey(NodeT *node, const double &total_score) {
+            node->total_score = total_score;
+            siftUp(node->heap_id);
+        }
+
+        /* Restore the order after the key of a node in the heap changed either way */
+        void update(NodeT *node) {
+            siftUp(node->heap_id);
+            siftDown(node->heap_id);
+        }
+
+        /* The node should be in the heap */
+        void remove(NodeT *node) {
+            const int id = node->heap_id;
+            NodeT *last = heap_.back();
+            heap_.pop_back();
+            if (last != node) {
+                heap_[id] = last;
+                last->heap_id = id;
+                update(last);
+            }
+            node->heap_id = -1;
+        }
+
+    private:
+        void siftUp(int id) {
+            NodeT *node = heap_[id];
+            while (id > 0) {
+                const int parent = (id - 1) >> 1;
+                if (!less_(node, heap_[parent])) {
+                    break;
+                }
+                heap_[id] = heap_[parent];
+                heap_[id]->heap_id = id;
+                id = parent;
+            }
+            heap_[id] = node;
+            node->heap_id = id;
+        }
+
+        void siftDown(int id) {
+            NodeT *node = heap_[id];
+            const int num = static_cast<int>(heap_.size());
+            while (true) {
+                int child = 2 * id + 1;
+                if (child >= num) {
+                    break;
+                }
+                if (child + 1 < num && less_(heap_[child + 1], heap_[child])) {
+                    child++;
+                }
+                if (!less_(heap_[child], node)) {
+                    break;
+                }
+                heap_[id] = heap_[child];
+                heap_[id]->heap_id = id;
+                id = child;
+            }
+            heap_[id] = node;
+            node->heap_id = id;
+        }
+
+        std::vector<NodeT *> heap_;
+        Less less_;
+    };
+
+    /* A bucket queue of nodes on total_score quantized by bucket_width. The scores of the
+     * grid search are sums of the step costs, so the scores in the open set stay in a few
+     * cells above the minimum, and the buckets are a ring of a power of two size which only
+     * grows when the spread of the scores exceeds it. Push, pop and decrease-key are O(1),
+     * a node keeps its position in its bucket in heap_id.
+     *
+     * The nodes of a bucket are popped in last-in first-out order, so a popped node can be
+     * at most bucket_width above the minimum score, and so is the cost of the found path
+     * above the optimal one.
+     *
+     * It gave no speedup over the binary heap on astar_benchmark (438k vs 447k expanded nodes
+     * per second), the expansion is dominated by the map queries of the neighbors, so it is
+     * not the default.
+     * */
+    template<typename NodeT>
+    class BucketNodeQueue {
+    public:
+        explicit BucketNodeQueue(const double &bucket_width = 0.1) {
+            setBucketWidth(bucket_width);
+        }
+
+        void setBucketWidth(const double &bucket_width) {
+            width_inv_ = 1.0 / bucket_width;
+        }
+
+        void clear() {
+            for (auto &bucket: buckets_) {
+                bucket.clear();
+            }
+            size_ = 0;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        void push(NodeT *node) {
+            const int64_t key = getKey(node->total_score);
+            if (size_ == 0) {
+                min_key_ = max_key_ = key;
+            } else if (key < min_key_) {
+                // Only an inconsistent heuristic gives a score below the last popped one
+                reserveKeys(key, max_key_);
+                min_key_ = key;
+            } else if (key > max_key_) {
+                reserveKeys(min_key_, key);
+                max_key_ = key;
+            }
+            insert(node, key);
+            size_++;
+        }
+
+        NodeT *pop() {
+            while (buckets_[min_key_ & mask_].empty()) {
+                min_key_++;
+            }
+            auto &bucket = buckets_[min_key_ & mask_];
+            NodeT *top = bucket.back();
+            bucket.pop_back();
+            top->heap_id = -1;
+            size_--;
+            return top;
+        }
+
+        /* The node should be in the queue and total_score should not increase */
+        void decreaseKey(NodeT *node, const double &total_score) {
+            const int64_t old_key = getKey(node->total_score);
+            const int64_t key = getKey(total_score);
+            node->total_score = total_score;
+            if (key == old_key) {
+                return;
+            }
+            auto &bucket = buckets_[old_key & mask_];
+            NodeT *last = bucket.back();
+            bucket[node->heap_id] = last;
+            last->heap_id = node->heap_id;
+            bucket.pop_back();
+            if (key < min_key_) {
+                reserveKeys(key, max_key_);
+                min_key_ = key;
+            }
+            insert(node, key);
+        }
+
+    private:
+        int64_t getKey(const double &total_score) const {
+            return static_cast<int64_t>(std::floor(total_score * width_inv_));
+        }
+
+        void insert(NodeT *node, const int64_t &key) {
+            auto &bucket = buckets_[key & mask_];
+            node->heap_id = static_cast<int>(bucket.size());
+            bucket.push_back(node);
+        }
+
+        /* Grow the ring until the keys from min_key to max_key fit in it */
+        void reserveKeys(const int64_t &min_key, const int64_t &max_key) {
+            if (max_key - min_key < static_cast<int64_t>(buckets_.size())) {
+                return;
+            }
+            size_t num = buckets_.empty() ? 64 : buckets_.size();
+            while (static_cast<int64_t>(num) <= max_key - min_key) {
+                num <<= 1;
+            }
+            std::vector<std::vector<NodeT *>> old_buckets(num);
+            old_buckets.swap(buckets_);
+            mask_ = static_cast<int64_t>(num) - 1;
+            for (auto &bucket: old_buckets) {
+                for (NodeT *node: bucket) {
+                    insert(node, getKey(node->total_score));
+                }
+            }
+        }
+
+        double width_inv_{10.0};
+        std::vector<std::vector<NodeT *>> buckets_{std::vector<std::vector<NodeT *>>(64)};
+        int64_t mask_{63};
+        int64_t min_key_{0}, max_key_{0};
+        size_t size_{0};
+    };
+
+    /* The open set of the grid search, one of the two queues above chosen by open_set_type */
+    template<typename NodeT>
+    class NodeOpenSet {
+    public:
+        void setType(const int &open_set_type, const double &bucket_width) {
+            use_bucket_ = open_set_type == OPEN_SET_BUCKET_QUEUE;
+            bucket_.setBucketWidth(bucket_width);
+        }
+
+        void clear() {
+            if (use_bucket_) {
+                bucket_.clear();
+            } else {
+                heap_.clear();
+            }
+        }
+
+        bool empty() const {
+            return use_bucket_ ? bucket_.empty() : heap_.empty();
+        }
+
+        size_t size() const {
+            return use_bucket_ ? bucket_.size() : heap_.size();
+        }
+
+        void push(NodeT *node) {
+            if (use_bucket_) {
+                bucket_.push(node);
+            } else {
+                heap_.push(node);
+            }
+        }
+
+        NodeT *pop() {
+            return use_bucket_ ? bucket_.pop() : heap_.pop();
+        }
+
+        void decreaseKey(NodeT *node, const double &total_score) {
+            if (use_bucket_) {
+                bucket_.decreaseKey(node, total_score);
+            } else {
+                heap_.decreaseKey(node, total_score);
+            }
+        }
+
+    private:
+        bool use_bucket_{false};
+        IndexedNodeHeap<NodeT> heap_;
+        BucketNodeQueue<NodeT> bucket_;
+    };
+}
@@ -29,6 +29,7 @@ using namespace super_utils;
 namespace path_search {
     using namespace rog_map;
 
+    static constexpr double INCREMENTAL_KEY_EPS = 1e-6;
 
     Astar::Astar(const std::string &cfg_path,
                  const ros_interface::RosInterface::Ptr &ros_ptr,
@@ -36,28 +37,11 @@ namespace path_search {
         cfg_ = PathSearchConfig(cfg_path);
         cout << rog_map::GREEN << " -- [RM] Init Astar-map." << rog_map::RESET << endl;
         int map_buffer_size = cfg_.map_voxel_num(0) * cfg_.map_voxel_num(1) * cfg_.map_voxel_num(2);
-        grid_node_buffer_.resize(map_buffer_size);
-        for (auto &i: grid_node_buffer_) {
-            i = new GridNode;
-            i->rounds = 0;
-        }
+        grid_nodes_.resize(map_buffer_size);
+        grid_node_links_.resize(map_buffer_size);
+        open_set_.setType(cfg_.open_set_type, cfg_.bucket_width);
         cout << rog_map::BLUE << "\tmap index size: " << cfg_.map_size_i.transpose() << rog_map::RESET << endl;
         cout << rog_map::BLUE << "\tmap vox_num: " << cfg_.map_voxel_num.transpose() << rog_map::RESET << endl;
-        int test_num = 100;
-        for (int i = -test_num; i <= test_num; i++) {
-            for (int j = -test_num; j <= test_num; j++) {
-                for (int k = -test_num; k <= test_num; k++) {
-                    rog_map::Vec3i delta(i, j, k);
-                    sorted_pts.push_back(delta);
-                }
-            }
-        }
-        sort(sorted_pts.begin(), sorted_pts.end(),
-             [](const rog_map::Vec3i &pt1, const rog_map::Vec3i &pt2) {
-                 double dist1 = pt1.x() * pt1.x() + pt1.y() * pt1.y() + pt1.z() * pt1.z();
-                 double dist2 = pt2.x() * pt2.x() + pt2.y() * pt2.y() + pt2.z() * pt2.z();
-                 return dist1 < dist2;
-             });
     }
 
     RET_CODE
@@ -74,6 +58,10 @@ namespace path_search {
         if (flag & DONT_USE_INF_NEIGHBOR) {
             md_.use_inf_neighbor = false;
         }
+        // The pruning rules are for the 26-connected grid
+        md_.use_jps = (flag & USE_JPS) && cfg_.allow_diag;
+        // The changes of the map are only logged by the inf map
+        md_.use_incremental = (flag & USE_INCREMENTAL) && md_.use_inf_map;
         if ((md_.use_inf_map && md_.use_prob_map) ||
             (!md_.use_inf_map && !md_.use_prob_map)) {
             cout << YELLOW << " -- [A*] " << RET_CODE_STR[INIT_ERROR]
@@ -90,7 +78,8 @@ namespace path_search {
         } else {
             md_.resolution = map_ptr_->getInfResolution();
         }
-        if (searching_horizon > 0) {
+        // The incremental search keeps its search map while the start moves inside it
+        if (searching_horizon > 0 || md_.use_incremental) {
             md_.local_map_center_d = start_pt;
         } else {
             md_.local_map_center_d = (start_pt + goal_pt) / 2;
@@ -106,12 +95,12 @@ namespace path_search {
         return SUCCESS;
     }
 
-    double Astar::getHeu(GridNodePtr node1, GridNodePtr node2, int type) const {
+    double Astar::getHeu(const Vec3i &id_1, const Vec3i &id_2, int type) const {
         switch (type) {
             case DIAG: {
-                double dx = std::abs(node1->id_g(0) - node2->id_g(0));
-                double dy = std::abs(node1->id_g(1) - node2->id_g(1));
-                double dz = std::abs(node1->id_g(2) - node2->id_g(2));
+                double dx = std::abs(id_1(0) - id_2(0));
+                double dy = std::abs(id_1(1) - id_2(1));
+                double dz = std::abs(id_1(2) - id_2(2));
 
                 double h = 0.0;
                 int diag = std::min(std::min(dx, dy), dz);
@@ -131,14 +120,14 @@ namespace path_search {
                 return tie_breaker_ * h;
             }
             case MANH: {
-                double dx = std::abs(node1->id_g(0) - node2->id_g(0));
-                double dy = std::abs(node1->id_g(1) - node2->id_g(1));
-                double dz = std::abs(node1->id_g(2) - node2->id_g(2));
+                double dx = std::abs(id_1(0) - id_2(0));
+                double dy = std::abs(id_1(1) - id_2(1));
+                double dz = std::abs(id_1(2) - id_2(2));
 
                 return tie_breaker_ * (dx + dy + dz);
             }
             case EUCL: {
-                return tie_breaker_ * (node2->id_g - node1->id_g).norm();
+                return tie_breaker_ * (id_2 - id_1).norm();
             }
             default: {
                 fmt::print(fg(fmt::color::indian_red), " -- [A*] Wrong hue type.\n");
@@ -154,6 +143,12 @@ namespace path_search {
                id(2);
     }
 
+    Vec3i Astar::getGlobalIndexFromHash(const int &hash_id) const {
+        const int yz_num = cfg_.map_voxel_num(1) * cfg_.map_voxel_num(2);
+        const Vec3i id(hash_id / yz_num, (hash_id % yz_num) / cfg_.map_voxel_num(2), hash_id % cfg_.map_voxel_num(2));
+        return id + md_.local_map_center_id_g - cfg_.map_size_i;
+    }
+
     void Astar::posToGlobalIndex(const rog_map::Vec3f &pos, rog_map::Vec3i &id_g) const {
         if (md_.use_inf_map) {
             map_ptr_->infMapPosToGlobalIndex(pos, id_g);
@@ -190,23 +185,33 @@ namespace path_search {
         return true;
     }
 
+    void Astar::setOpenSetType(const int &open_set_type, const double &bucket_width) {
+        cfg_.open_set_type = open_set_type;
+        cfg_.bucket_width = bucket_width;
+        open_set_.setType(open_set_type, bucket_width);
+    }
+
     void Astar::setVisualProcessEn(const bool &en) {
         cfg_.visual_process = en;
     }
 
-    void Astar::retrievePath(GridNodePtr current, vector<GridNodePtr> &path) {
-        path.push_back(current);
-        while (current->father_ptr != NULL) {
-            current = current->father_ptr;
-            path.push_back(current);
+    void Astar::retrievePath(GridNodePtr current, vector<int> &path) {
+        int node_id = getNodeIndex(current);
+        path.push_back(node_id);
+        while (grid_node_links_[node_id].father_id >= 0) {
+            node_id = grid_node_links_[node_id].father_id;
+            path.push_back(node_id);
+        }
+        if (md_.use_jps) {
+            fillJumpPath(path);
         }
     }
 
-    void Astar::ConvertNodePathToPointPath(const vector<GridNodePtr> &node_path, rog_map::vec_Vec3f &point_path) {
+    void Astar::ConvertNodePathToPointPath(const vector<int> &node_path, rog_map::vec_Vec3f &point_path) {
         point_path.clear();
-        for (auto ptr: node_path) {
+        for (const auto &node_id: node_path) {
             rog_map::Vec3f pos;
-            globalIndexToPos(ptr->id_g, pos);
+            globalIndexToPos(getGlobalIndexFromHash(node_id), pos);
             point_path.push_back(pos);
         }
         reverse(point_path.begin(), point_path.end());
@@ -237,9 +242,24 @@ namespace path_search {
         if (setup_ret != SUCCESS) {
             return setup_ret;
         }
+        if (md_.use_incremental) {
+            const RET_CODE inc_ret = incrementalPathSearch(start_pt, end_pt, flag, searching_horizon, out_path, time_out);
+            if (inc_ret != NO_PATH && inc_ret != INIT_ERROR) {
+                return inc_ret;
+            }
+            /* The incremental search only returns paths reaching the goal, the plain search
+             * below also stops at the horizon or at the node closest to an unreachable goal,
+             * e.g. a goal in the unknown space with UNKNOWN_AS_OCCUPIED.
+             * */
+            setup_ret = setup(start_pt, end_pt, flag & ~USE_INCREMENTAL, searching_horizon);
+            if (setup_ret != SUCCESS) {
+                return setup_ret;
+            }
+        }
         out_path.clear();
         double time_1 = ros_ptr_->getSimTime();
         ++rounds_;
+        num_iter_ = 0;
         /// 2) Switch both start and end point to local map
 
         rog_map::Vec3f hit_pt;
@@ -275,24 +295,8 @@ namespace path_search {
 
         if (!insideLocalMap(end_pt)) {
             rog_map::Vec3f seed_pt = start_pt_out_local_map ? md_.local_map_center_d : start_pt;
-            if (rog_map::lineIntersectBox(end_pt, seed_pt, md_.local_map_min_d, md_.local_map_max_d,
-                                          hit_pt)) {
-                rog_map::Vec3f dir = (hit_pt - end_pt).normalized();
-                double dis = (hit_pt - end_pt).norm();
-                local_end_pt = end_pt + dir * (dis + 2.5);
-
-                if (!map_ptr_->getNearestInfCellNot(OCCUPIED, local_end_pt, local_end_pt, 2.0)) {
-                    ros_ptr_->error(
-                            " -- [A*] Error with: {}, Goal point [{}] deeply occupied, cannot find feasible path.",
-                            RET_CODE_STR[INIT_ERROR],
-                            local_end_pt.transpose());
-                    if (cfg_.visual_process || cfg_.debug_visualization_en) {
-                        ros_ptr_->vizAstarPoints(local_end_pt, Color::Red(), "local_end_pt",
-                                                 0.5,
-                                                 1);
-                    }
-                    return INIT_ERROR;
-                }
+            if (!getLocalEndPoint(end_pt, seed_pt, local_end_pt)) {
+                return INIT_ERROR;
             }
         }
 
@@ -326,26 +330,25 @@ namespace path_search {
         }
 
 
-        GridNodePtr startPtr = grid_node_buffer_[getLocalIndexHash(start_idx)];
-        GridNodePtr endPtr = grid_node_buffer_[getLocalIndexHash(end_idx)];
-        endPtr->id_g = end_idx;
+        GridNodePtr startPtr = &grid_nodes_[getLocalIndexHash(start_idx)];
 
-        std::priority_queue<GridNodePtr, std::vector<GridNodePtr>, NodeComparator> open_set;
-        std::priority_queue<GridNodePtr, std::vector<GridNodePtr>, FrontierComparator> frontier_queue;
+        open_set_.clear();
+        std::priority_queue<GridNodePtr, std::vector<GridNodePtr>, FrontierComparator> frontier_queue(
+                FrontierComparator(grid_nodes_, grid_node_links_));
+        const double horizon_score = searching_horizon > 0 ? searching_horizon / md_.resolution
+                                                           : std::numeric_limits<double>::max();
 
 
         GridNodePtr neighborPtr = NULL;
         GridNodePtr current = NULL;
 
-        startPtr->id_g = start_idx;
         startPtr->rounds = rounds_;
         startPtr->distance_score = 0;
-        startPtr->total_score = getHeu(startPtr, endPtr, cfg_.heu_type);
+        startPtr->total_score = getHeu(start_idx, end_idx, cfg_.heu_type);
         startPtr->state = GridNode::OPENSET; //put start node in open set
-        startPtr->father_ptr = NULL;
-        open_set.push(startPtr); //put start in open set
-        int num_iter = 0;
-        vector<GridNodePtr> node_path;
+        getNodeLink(startPtr).father_id = -1;
+        open_set_.push(startPtr); //put start in open set
+        vector<int> node_path;
 
         if (cfg_.visual_process) {
             ros_ptr_->vizAstarPoints(
@@ -360,13 +363,13 @@ namespace path_search {
                     0.3, 1);
         }
 
-        while (!open_set.empty()) {
-            num_iter++;
-            current = open_set.top();
-            open_set.pop();
+        while (!open_set_.empty()) {
+            num_iter_++;
+            current = open_set_.pop();
+            const rog_map::Vec3i current_id_g = getNodeGlobalIndex(current);
             if (cfg_.visual_process) {
                 rog_map::Vec3f local_pt;
-                globalIndexToPos(current->id_g, local_pt);
+                globalIndexToPos(current_id_g, local_pt);
                 ros_ptr_->vizAstarPoints(
                         local_pt,
                         Color(Color::Pink(), 0.5),
@@ -374,33 +377,32 @@ namespace path_search {
                         0.1);
                 usleep(1000);
             }
-            if (current->id_g(0) == endPtr->id_g(0) &&
-                current->id_g(1) == endPtr->id_g(1) &&
-                current->id_g(2) == endPtr->id_g(2)) {
+            if (current_id_g == end_idx) {
                 retrievePath(current, node_path);
+                ConvertNodePathToPointPath(node_path, out_path);
                 if (start_pt_out_local_map) {
+                    // The start point is outside the search map, so it has no node
                     rog_map::Vec3i start_idx_g;
+                    rog_map::Vec3f start_cell_pt;
                     posToGlobalIndex(start_pt, start_idx_g);
-                    GridNodePtr temp_ptr(new GridNode);
-                    temp_ptr->id_g = start_idx_g;
-                    node_path.push_back(temp_ptr);
+                    globalIndexToPos(start_idx_g, start_cell_pt);
+                    out_path.insert(out_path.begin(), start_cell_pt);
                 }
-                ConvertNodePathToPointPath(node_path, out_path);
                 return REACH_GOAL;
             }
 
             // Distance terminate condition
-            if (searching_horizon > 0 && current->distance_score > searching_horizon / md_.resolution) {
+            if (current->distance_score > horizon_score) {
                 GridNodePtr local_goal = current;
                 if (md_.unknown_as_occ && !frontier_queue.empty()) {
-                    local_goal = frontier_queue.top()->father_ptr;
-                    if (local_goal->distance_to_goal > current->distance_to_goal) {
+                    local_goal = &grid_nodes_[getNodeLink(frontier_queue.top()).father_id];
+                    if (getNodeLink(local_goal).distance_to_goal > getNodeLink(current).distance_to_goal) {
                         local_goal = current;
                     }
                 }
                 retrievePath(local_goal, node_path);
                 if (start_pt_out_local_map) {
-                    node_path.push_back(startPtr);
+                    node_path.push_back(getNodeIndex(startPtr));
                 }
                 ConvertNodePathToPointPath(node_path, out_path);
                 return REACH_HORIZON;
@@ -409,101 +411,77 @@ namespace path_search {
 
             current->state = GridNode::CLOSEDSET; //move current node from open set to closed set.
 
-            for (int dx = -1; dx <= 1; dx++)
-                for (int dy = -1; dy <= 1; dy++)
-                    for (int dz = -1; dz <= 1; dz++) {
-                        if (dx == 0 && dy == 0 && dz == 0) {
-                            continue;
-                        }
-                        if (!cfg_.allow_diag &&
-                            (std::abs(dx) + std::abs(dy) + std::abs(dz) > 1)) {
-                            continue;
-                        }
-
-                        rog_map::Vec3i neighborIdx;
-                        rog_map::Vec3f neighborPos;
-                        neighborIdx(0) = (current->id_g)(0) + dx;
-                        neighborIdx(1) = (current->id_g)(1) + dy;
-                        neighborIdx(2) = (current->id_g)(2) + dz;
-                        globalIndexToPos(neighborIdx, neighborPos);
-
-                        if (!insideLocalMap(neighborIdx)) {
-                            continue;
-                        }
+            if (md_.use_jps) {
+                expandJumpPoint(current, current_id_g, end_idx, horizon_score);
+            } else {
+                for (int dx = -1; dx <= 1; dx++)
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dz = -1; dz <= 1; dz++) {
+                            if (dx == 0 && dy == 0 && dz == 0) {
+                                continue;
+                            }
+                            if (!cfg_.allow_diag &&
+                                (std::abs(dx) + std::abs(dy) + std::abs(dz) > 1)) {
+                                continue;
+                            }
 
-                        rog_map::GridType neighbor_type;
+                            rog_map::Vec3i neighborIdx;
+                            neighborIdx(0) = current_id_g(0) + dx;
+                            neighborIdx(1) = current_id_g(1) + dy;
+                            neighborIdx(2) = current_id_g(2) + dz;
 
-                        if (md_.use_inf_map) {
-                            neighbor_type = map_ptr_->getInfGridType(neighborPos);
-                        } else {
-                            if (!md_.use_inf_neighbor) {
-                                neighbor_type = map_ptr_->getGridType(neighborPos);
-                            } else {
-                                // use prob map, but query all neighbors of the current node
-                                // if there is one neighbor is occupied, then the neighbor is occupied.
-                                neighbor_type = neighborHaveOne(OCCUPIED, neighborIdx) ? OCCUPIED : UNDEFINED;
-                                // if there is one known free neighbor, then the neighbor is known free.
-                                if (md_.unknown_as_occ && neighbor_type != OCCUPIED) {
-                                    neighbor_type = neighborHaveOne(KNOWN_FREE, neighborIdx) ? KNOWN_FREE : UNKNOWN;
-                                }
+                            if (!insideLocalMap(neighborIdx)) {
+                                continue;
                             }
-                        }
 
-                        if (neighbor_type == OCCUPIED || neighbor_type == OUT_OF_MAP) {
-                            continue;
-                        }
+                            rog_map::GridType neighbor_type = getSearchGridType(neighborIdx);
 
-                        if (md_.unknown_as_occ && neighbor_type == UNKNOWN) {
-                            continue;
-                        }
+                            if (neighbor_type == OCCUPIED || neighbor_type == OUT_OF_MAP) {
+                                continue;
+                            }
 
-                        neighborPtr = grid_node_buffer_[getLocalIndexHash(neighborIdx)];
-                        if (neighborPtr == nullptr) {
-                            cout << rog_map::RED << " -- [RM] neighborPtr is null, which should not happen." <<
-                                 rog_map::RESET
-                                 << endl;
-                            continue;
-                        }
-                        neighborPtr->id_g = neighborIdx;
+                            if (md_.unknown_as_occ && neighbor_type == UNKNOWN) {
+                                continue;
+                            }
 
-                        bool flag_explored = neighborPtr->rounds == rounds_;
+                            neighborPtr = &grid_nodes_[getLocalIndexHash(neighborIdx)];
+                            GridNodeLink &neighbor_link = getNodeLink(neighborPtr);
 
-                        if (flag_explored && neighborPtr->state == GridNode::CLOSEDSET) {
-                            continue; //in closed set.
-                        }
+                            bool flag_explored = neighborPtr->rounds == rounds_;
 
-                        if (md_.unknown_as_occ && neighbor_type == UNKNOWN && neighborPtr) {
-                            // the frontier is recorded but not expand.
-                            neighborPtr->father_ptr = current;
-                            rog_map::Vec3f pos;
-                            globalIndexToPos(neighborIdx, pos);
-                            neighborPtr->distance_to_goal = getHeu(neighborPtr, endPtr, cfg_.heu_type);
-                            frontier_queue.push(neighborPtr);
-                            continue;
-                        }
+                            if (flag_explored && neighborPtr->state == GridNode::CLOSEDSET) {
+                                continue; //in closed set.
+                            }
 
-                        neighborPtr->rounds = rounds_;
-                        double distance_score = sqrt(dx * dx + dy * dy + dz * dz);
-                        distance_score = current->distance_score + distance_score;
-                        rog_map::Vec3f pos;
-                        globalIndexToPos(neighborIdx, pos);
-                        double heu_score = getHeu(neighborPtr, endPtr, cfg_.heu_type);
+                            if (md_.unknown_as_occ && neighbor_type == UNKNOWN) {
+                                // the frontier is recorded but not expand.
+                                neighbor_link.father_id = getNodeIndex(current);
+                                neighbor_link.distance_to_goal = getHeu(neighborIdx, end_idx, cfg_.heu_type);
+                                frontier_queue.push(neighborPtr);
+                                continue;
+                            }
 
-                        if (!flag_explored) {
-                            //discover a new node
-                            neighborPtr->state = GridNode::OPENSET;
-                            neighborPtr->father_ptr = current;
-                            neighborPtr->distance_score = distance_score;
-                            neighborPtr->distance_to_goal = heu_score;
-                            neighborPtr->total_score = distance_score + heu_score;
-                            open_set.push(neighborPtr); //put neighbor in open set and record it.
-                        } else if (distance_score < neighborPtr->distance_score) {
-                            neighborPtr->father_ptr = current;
-                            neighborPtr->distance_score = distance_score;
-                            neighborPtr->distance_to_goal = heu_score;
-                            neighborPtr->total_score = distance_score + heu_score;
+                            neighborPtr->rounds = rounds_;
+                            double distance_score = sqrt(dx * dx + dy * dy + dz * dz);
+                            distance_score = current->distance_score + distance_score;
+                            double heu_score = getHeu(neighborIdx, end_idx, cfg_.heu_type);
+
+                            if (!flag_explored) {
+                                //discover a new node
+                                neighborPtr->state = GridNode::OPENSET;
+                                neighbor_link.father_id = getNodeIndex(current);
+                                neighborPtr->distance_score = distance_score;
+                                neighbor_link.distance_to_goal = heu_score;
+                                neighborPtr->total_score = distance_score + heu_score;
+                                open_set_.push(neighborPtr); //put neighbor in open set and record it.
+                            } else if (distance_score < neighborPtr->distance_score) {
+                                neighbor_link.father_id = getNodeIndex(current);
+                                neighborPtr->distance_score = distance_score;
+                                neighbor_link.distance_to_goal = heu_score;
+                                open_set_.decreaseKey(neighborPtr, distance_score + heu_score);
+                            }
                         }
-                    }
+            }
             double time_2 = ros_ptr_->getSimTime();
             if (!cfg_.visual_process && (time_2 - time_1) > time_out) {
                 fmt::print(fg(fmt::color::indian_red),
@@ -515,7 +493,7 @@ namespace path_search {
         if ((time_2 - time_1) > time_out) {
             fmt::print(fg(fmt::color::indian_red), "Time consume in A star path finding is {} s, iter={}.\n",
                        (time_2 - time_1),
-                       num_iter);
+                       num_iter_);
             return NO_PATH;
         }
 
@@ -525,7 +503,7 @@ namespace path_search {
                 local_goal = frontier_queue.top();
                 frontier_queue.pop();
                 rog_map::Vec3f pos;
-                globalIndexToPos(local_goal->id_g, pos);
+                globalIndexToPos(getNodeGlobalIndex(local_goal), pos);
                 if ((pos - start_pt).norm() < 1.0) {
                     continue;
                 }
@@ -537,13 +515,13 @@ namespace path_search {
             }
             retrievePath(local_goal, node_path);
             if (start_pt_out_local_map) {
-                node_path.push_back(startPtr);
+                node_path.push_back(getNodeIndex(startPtr));
             }
             ConvertNodePathToPointPath(node_path, out_path);
             cout << rog_map::BLUE << "Frontier queue: " << frontier_queue.size() << endl;
             return REACH_HORIZON;
         }
-        ros_ptr_->error(" -- [A*] Point to point path cannot find path with iter num: {}, return.", num_iter);
+        ros_ptr_->error(" -- [A*] Point to point path cannot find path with iter num: {}, return.", num_iter_);
         return NO_PATH;
     }
 
@@ -556,6 +534,7 @@ namespace path_search {
 
         double time_1 = ros_ptr_->getSimTime();
         ++rounds_;
+        num_iter_ = 0;
 
         posToGlobalIndex(md_.local_map_center_d, md_.local_map_center_id_g);
         /// 2) Check start point
@@ -578,34 +557,32 @@ namespace path_search {
         rog_map::Vec3i start_idx;
         posToGlobalIndex(local_start_pt, start_idx);
 
-        GridNodePtr startPtr = grid_node_buffer_[getLocalIndexHash(start_idx)];
-        std::priority_queue<GridNodePtr, std::vector<GridNodePtr>, NodeComparator> open_set;
+        GridNodePtr startPtr = &grid_nodes_[getLocalIndexHash(start_idx)];
+        open_set_.clear();
         GridNodePtr neighborPtr = NULL;
         GridNodePtr current = NULL;
 
-        startPtr->id_g = start_idx;
         startPtr->rounds = rounds_;
         startPtr->distance_score = 0;
         startPtr->total_score = 0;
         startPtr->state = GridNode::OPENSET; //put start node in open set
-        startPtr->father_ptr = NULL;
-        open_set.push(startPtr); //put start in open set
-        int num_iter = 0;
+        getNodeLink(startPtr).father_id = -1;
+        open_set_.push(startPtr); //put start in open set
 
-        vector<GridNodePtr> node_path;
+        vector<int> node_path;
 
         if (cfg_.visual_process) {
             ros_ptr_->vizAstarPoints(local_start_pt, Color::Orange(), "local_start_pt",
                                      0.05,
                                      1);
         }
-        while (!open_set.empty()) {
-            num_iter++;
-            current = open_set.top();
-            open_set.pop();
+        while (!open_set_.empty()) {
+            num_iter_++;
+            current = open_set_.pop();
+            const rog_map::Vec3i current_id_g = getNodeGlobalIndex(current);
             if (cfg_.visual_process) {
                 rog_map::Vec3f local_pt;
-                globalIndexToPos(current->id_g, local_pt);
+                globalIndexToPos(current_id_g, local_pt);
                 ros_ptr_->vizAstarPoints(local_pt,
                                          Color::Pink(),
                                          "astar_process",
@@ -613,7 +590,7 @@ namespace path_search {
                 usleep(1000);
             }
             rog_map::Vec3f cur_pos;
-            globalIndexToPos(current->id_g, cur_pos);
+            globalIndexToPos(current_id_g, cur_pos);
             rog_map::GridType cur_inf_type = map_ptr_->getInfGridType(cur_pos);
             if (md_.unknown_as_occ && cur_inf_type != OCCUPIED && cur_inf_type != UNKNOWN) {
                 retrievePath(current, node_path);
@@ -641,9 +618,9 @@ namespace path_search {
                         }
                         rog_map::Vec3i neighborIdx;
                         rog_map::Vec3f neighborPos;
-                        neighborIdx(0) = (current->id_g)(0) + dx;
-                        neighborIdx(1) = (current->id_g)(1) + dy;
-                        neighborIdx(2) = (current->id_g)(2) + dz;
+                        neighborIdx(0) = current_id_g(0) + dx;
+                        neighborIdx(1) = current_id_g(1) + dy;
+                        neighborIdx(2) = current_id_g(2) + dz;
                         globalIndexToPos(neighborIdx, neighborPos);
                         if (!map_ptr_->insideLocalMap(neighborPos) ||
                             !insideLocalMap(neighborIdx)) {
@@ -665,13 +642,7 @@ namespace path_search {
                             continue;
                         }
 
-                        neighborPtr = grid_node_buffer_[getLocalIndexHash(neighborIdx)];
-                        if (neighborPtr == nullptr) {
-                            cout << rog_map::RED << " -- [RM] neighborPtr is null, which should not happen" <<
-                                 rog_map::RESET << endl;
-                            continue;
-                        }
-                        neighborPtr->id_g = neighborIdx;
+                        neighborPtr = &grid_nodes_[getLocalIndexHash(neighborIdx)];
 
                         bool flag_explored = neighborPtr->rounds == rounds_;
 
@@ -682,20 +653,18 @@ namespace path_search {
                         neighborPtr->rounds = rounds_;
                         double distance_score = sqrt(dx * dx + dy * dy + dz * dz);
                         distance_score = current->distance_score + distance_score;
-                        rog_map::Vec3f pos;
-                        globalIndexToPos(neighborIdx, pos);
                         double heu_score = 0;
                         if (!flag_explored) {
                             //discover a new node
                             neighborPtr->state = GridNode::OPENSET;
-                            neighborPtr->father_ptr = current;
+                            getNodeLink(neighborPtr).father_id = getNodeIndex(current);
                             neighborPtr->distance_score = distance_score;
                             neighborPtr->total_score = distance_score + heu_score;
-                            open_set.push(neighborPtr); //put neighbor in open set and record it.
+                            open_set_.push(neighborPtr); //put neighbor in open set and record it.
                         } else if (distance_score < neighborPtr->distance_score) {
-                            neighborPtr->father_ptr = current;
+                            getNodeLink(neighborPtr).father_id = getNodeIndex(current);
                             neighborPtr->distance_score = distance_score;
-                            neighborPtr->total_score = distance_score + heu_score;
+                            open_set_.decreaseKey(neighborPtr, distance_score + heu_score);
                         }
                     }
             double time_2 = ros_ptr_->getSimTime();
@@ -709,12 +678,562 @@ namespace path_search {
         if ((time_2 - time_1) > 0.1) {
             fmt::print(fg(fmt::color::indian_red), "Time consume in A star path finding is {} s, iter={}.\n",
                        (time_2 - time_1),
-                       num_iter);
+                       num_iter_);
         }
         cout << rog_map::RED << " -- [A*] Escape path searcher, cannot find path, return." << rog_map::RESET << endl;
         return NO_PATH;
     }
 
+    bool Astar::getLocalEndPoint(const rog_map::Vec3f &end_pt, const rog_map::Vec3f &seed_pt,
+                                 rog_map::Vec3f &local_end_pt) {
+        rog_map::Vec3f hit_pt;
+        local_end_pt = end_pt;
+        if (!rog_map::lineIntersectBox(end_pt, seed_pt, md_.local_map_min_d, md_.local_map_max_d, hit_pt)) {
+            return true;
+        }
+        rog_map::Vec3f dir = (hit_pt - end_pt).normalized();
+        double dis = (hit_pt - end_pt).norm();
+        local_end_pt = end_pt + dir * (dis + 2.5);
+
+        if (!map_ptr_->getNearestInfCellNot(OCCUPIED, local_end_pt, local_end_pt, 2.0)) {
+            ros_ptr_->error(
+                    " -- [A*] Error with: {}, Goal point [{}] deeply occupied, cannot find feasible path.",
+                    RET_CODE_STR[INIT_ERROR],
+                    local_end_pt.transpose());
+            if (cfg_.visual_process || cfg_.debug_visualization_en) {
+                ros_ptr_->vizAstarPoints(local_end_pt, Color::Red(), "local_end_pt",
+                                         0.5,
+                                         1);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    rog_map::GridType Astar::getSearchGridType(const rog_map::Vec3i &id_g) {
+        if (!insideLocalMap(id_g)) {
+            return OUT_OF_MAP;
+        }
+        rog_map::Vec3f pos;
+        globalIndexToPos(id_g, pos);
+        if (md_.use_inf_map) {
+            return map_ptr_->getInfGridType(pos);
+        }
+        if (!md_.use_inf_neighbor) {
+            return map_ptr_->getGridType(pos);
+        }
+        // use prob map, but query all neighbors of the current node
+        // if there is one neighbor is occupied, then the neighbor is occupied.
+        rog_map::GridType type = neighborHaveOne(OCCUPIED, id_g) ? OCCUPIED : UNDEFINED;
+        // if there is one known free neighbor, then the neighbor is known free.
+        if (md_.unknown_as_occ && type != OCCUPIED) {
+            type = neighborHaveOne(KNOWN_FREE, id_g) ? KNOWN_FREE : UNKNOWN;
+        }
+        return type;
+    }
+
+    GridNode &Astar::getJpsNode(const rog_map::Vec3i &id_g) {
+        GridNode &node = grid_nodes_[getLocalIndexHash(id_g)];
+        if (node.jps_rounds != rounds_) {
+            node.jps_rounds = rounds_;
+            node.blocked = isBlockedType(getSearchGridType(id_g));
+            node.no_jump_dirs = 0;
+        }
+        return node;
+    }
+
+    bool Astar::isJpsBlocked(const rog_map::Vec3i &id_g) {
+        if (!insideLocalMap(id_g)) {
+            return true;
+        }
+        return getJpsNode(id_g).blocked;
+    }
+
+    bool Astar::getForcedNeighbors(const rog_map::Vec3i &id_g, const JpsDirection &jd,
+                                   rog_map::vec_Vec3i *forced_dirs) {
+        uint16_t blocked = 0;
+        for (size_t i = 0; i < jd.check_cells.size(); i++) {
+            if (isJpsBlocked(id_g + jd.check_cells[i])) {
+                blocked |= static_cast<uint16_t>(1u << i);
+            }
+        }
+        // All paths around the node are free, which is the case in the open space
+        if (blocked == 0) {
+            return false;
+        }
+        bool has_forced = false;
+        for (const auto &forced: jd.forced) {
+            bool all_blocked = true;
+            for (const auto &mask: forced.masks) {
+                if (!(mask & blocked)) {
+                    all_blocked = false;
+                    break;
+                }
+            }
+            if (!all_blocked || isJpsBlocked(id_g + forced.dir)) {
+                continue;
+            }
+            has_forced = true;
+            if (forced_dirs == nullptr) {
+                return true;
+            }
+            forced_dirs->push_back(forced.dir);
+        }
+        return has_forced;
+    }
+
+    bool Astar::jump(const rog_map::Vec3i &id_g, const rog_map::Vec3i &dir, const rog_map::Vec3i &end_idx,
+                     const double &horizon_score, rog_map::Vec3i &jump_pt, double &distance_score) {
+        const JpsDirection &jd = jps_neighbor_.get(dir);
+        const double step_cost = sqrt(static_cast<double>(dir.squaredNorm()));
+        // The diagonal jumps repeat the straight jumps from each cell they cross, so a straight
+        // jump meeting no jump point is recorded in the cells it crossed. Without a horizon the
+        // result only depends on the map and the goal.
+        uint8_t straight_bit = 0;
+        if (jd.sub_dirs.empty() && horizon_score == std::numeric_limits<double>::max()) {
+            int axis;
+            dir.cwiseAbs().maxCoeff(&axis);
+            straight_bit = static_cast<uint8_t>(1u << (2 * axis + (dir(axis) > 0 ? 1 : 0)));
+        }
+        rog_map::Vec3i cur = id_g;
+        while (true) {
+            cur += dir;
+            if (isJpsBlocked(cur)) {
+                break;
+            }
+            distance_score += step_cost;
+            if (cur == end_idx || distance_score > horizon_score || getForcedNeighbors(cur, jd, nullptr)) {
+                jump_pt = cur;
+                return true;
+            }
+            if (getJpsNode(cur).no_jump_dirs & straight_bit) {
+                break;
+            }
+            for (const auto &sub_dir: jd.sub_dirs) {
+                rog_map::Vec3i sub_jump_pt;
+                double sub_score = distance_score;
+                if (jump(cur, sub_dir, end_idx, horizon_score, sub_jump_pt, sub_score)) {
+                    jump_pt = cur;
+                    return true;
+                }
+            }
+        }
+        if (straight_bit) {
+            for (rog_map::Vec3i id = id_g; id != cur; id += dir) {
+                getJpsNode(id).no_jump_dirs |= straight_bit;
+            }
+        }
+        return false;
+    }
+
+    void Astar::expandJumpPoint(GridNodePtr current, const rog_map::Vec3i &current_id_g,
+                                const rog_map::Vec3i &end_idx, const double &horizon_score) {
+        rog_map::Vec3i dir = rog_map::Vec3i::Zero();
+        const int father_id = getNodeLink(current).father_id;
+        if (father_id >= 0) {
+            dir = (current_id_g - getGlobalIndexFromHash(father_id)).cwiseSign();
+        }
+        const JpsDirection &jd = jps_neighbor_.get(dir);
+        jps_succ_dirs_.assign(jd.natural.begin(), jd.natural.end());
+        getForcedNeighbors(current_id_g, jd, &jps_succ_dirs_);
+
+        for (const auto &succ_dir: jps_succ_dirs_) {
+            rog_map::Vec3i jump_pt;
+            double distance_score = current->distance_score;
+            if (!jump(current_id_g, succ_dir, end_idx, horizon_score, jump_pt, distance_score)) {
+                continue;
+            }
+            GridNodePtr neighborPtr = &grid_nodes_[getLocalIndexHash(jump_pt)];
+            const bool flag_explored = neighborPtr->rounds == rounds_;
+            if (flag_explored && neighborPtr->state == GridNode::CLOSEDSET) {
+                continue;
+            }
+            GridNodeLink &neighbor_link = getNodeLink(neighborPtr);
+            const double heu_score = getHeu(jump_pt, end_idx, cfg_.heu_type);
+            neighborPtr->rounds = rounds_;
+            if (!flag_explored) {
+                neighborPtr->state = GridNode::OPENSET;
+                neighbor_link.father_id = getNodeIndex(current);
+                neighborPtr->distance_score = distance_score;
+                neighbor_link.distance_to_goal = heu_score;
+                neighborPtr->total_score = distance_score + heu_score;
+                open_set_.push(neighborPtr);
+            } else if (distance_score < neighborPtr->distance_score) {
+                neighbor_link.father_id = getNodeIndex(current);
+                neighborPtr->distance_score = distance_score;
+                neighbor_link.distance_to_goal = heu_score;
+                open_set_.decreaseKey(neighborPtr, distance_score + heu_score);
+            }
+        }
+    }
+
+    void Astar::fillJumpPath(vector<int> &node_path) const {
+        vector<int> dense_path;
+        for (size_t i = 0; i < node_path.size(); i++) {
+            dense_path.push_back(node_path[i]);
+            if (i + 1 == node_path.size()) {
+                break;
+            }
+            // The nodes are from the goal to the start, and a jump is along one direction
+            const rog_map::Vec3i to = getGlobalIndexFromHash(node_path[i + 1]);
+            rog_map::Vec3i cur = getGlobalIndexFromHash(node_path[i]);
+            const rog_map::Vec3i dir = (to - cur).cwiseSign();
+            for (cur += dir; cur != to; cur += dir) {
+                dense_path.push_back(getLocalIndexHash(cur));
+            }
+        }
+        node_path.swap(dense_path);
+    }
+
+    RET_CODE Astar::incrementalPathSearch(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &end_pt,
+                                          const int &flag, const double &searching_horizon,
+                                          rog_map::vec_Vec3f &out_path, const double &time_out) {
+        out_path.clear();
+        const double time_1 = ros_ptr_->getSimTime();
+        num_iter_ = 0;
+
+        // The search is reused until the start gets within a quarter of the search map of its border
+        bool reuse = inc_.valid && inc_.flag == flag && (end_pt - inc_.goal_pt).norm() < 1e-6;
+        rog_map::Vec3i start_idx;
+        posToGlobalIndex(start_pt, start_idx);
+        if (reuse) {
+            const rog_map::Vec3i delta = (start_idx - inc_.local_map_center_id_g).cwiseAbs();
+            reuse = (delta * 4 - cfg_.map_size_i * 3).maxCoeff() <= 0;
+        }
+        if (reuse) {
+            const rog_map::Vec3i setup_center_id_g = md_.local_map_center_id_g;
+            const rog_map::Vec3f setup_center_d = md_.local_map_center_d;
+            md_.local_map_center_id_g = inc_.local_map_center_id_g;
+            md_.local_map_center_d = inc_.local_map_center_d;
+            if (applyIncrementalChanges()) {
+                md_.local_map_min_d = md_.local_map_center_d - md_.resolution * cfg_.map_size_i.cast<double>();
+                md_.local_map_max_d = md_.local_map_center_d + md_.resolution * cfg_.map_size_i.cast<double>();
+                inc_.km += getIncrementalHeu(inc_.start_idx, start_idx);
+                inc_.start_idx = start_idx;
+            } else {
+                md_.local_map_center_id_g = setup_center_id_g;
+                md_.local_map_center_d = setup_center_d;
+                reuse = false;
+            }
+        }
+        if (!reuse) {
+            const RET_CODE ret = resetIncrementalSearch(start_pt, end_pt, flag);
+            if (ret != SUCCESS) {
+                return ret;
+            }
+        }
+
+        const RET_CODE ret = computeIncrementalPath(time_1, time_out);
+        if (ret != SUCCESS) {
+            return ret;
+        }
+
+        // Follow the neighbors with the least cost to the goal, whose g decreases along the path
+        const double horizon_score = searching_horizon > 0 ? searching_horizon / md_.resolution
+                                                           : std::numeric_limits<double>::max();
+        rog_map::Vec3i cur = start_idx;
+        double distance_score = 0;
+        double cur_g = getIncrementalNode(cur).g;
+        rog_map::Vec3f pos;
+        globalIndexToPos(cur, pos);
+        out_path.push_back(pos);
+        while (cur != inc_.goal_idx) {
+            if (distance_score > horizon_score) {
+                return REACH_HORIZON;
+            }
+            int best_id = -1;
+            double best_score = std::numeric_limits<double>::infinity();
+            for (size_t i = 0; i < inc_.steps.size(); i++) {
+                const rog_map::Vec3i nb = cur + inc_.steps[i];
+                if (!insideLocalMap(nb)) {
+                    continue;
+                }
+                const IncrementalNode &nb_node = inc_.nodes[getLocalIndexHash(nb)];
+                if (nb_node.session != inc_.session || nb_node.blocked) {
+                    continue;
+                }
+                const double score = inc_.step_costs[i] + nb_node.g;
+                if (score < best_score) {
+                    best_score = score;
+                    best_id = static_cast<int>(i);
+                }
+            }
+            if (best_id < 0 || !(best_score < std::numeric_limits<double>::infinity())) {
+                break;
+            }
+            const double next_g = inc_.nodes[getLocalIndexHash(cur + inc_.steps[best_id])].g;
+            if (next_g >= cur_g) {
+                break;
+            }
+            cur += inc_.steps[best_id];
+            cur_g = next_g;
+            distance_score += inc_.step_costs[best_id];
+            globalIndexToPos(cur, pos);
+            out_path.push_back(pos);
+        }
+        if (cur != inc_.goal_idx) {
+            // Should not happen with a consistent heuristic, start over at the next call
+            ros_ptr_->warn(" -- [A*] The incremental search got a broken path, reset it.");
+            inc_.valid = false;
+            out_path.clear();
+            return NO_PATH;
+        }
+        return REACH_GOAL;
+    }
+
+    RET_CODE Astar::resetIncrementalSearch(const rog_map::Vec3f &start_pt, const rog_map::Vec3f &end_pt,
+                                           const int &flag) {
+        inc_.valid = false;
+        if (inc_.nodes.data() == nullptr) {
+            inc_.nodes.resize(cfg_.map_voxel_num(0) * cfg_.map_voxel_num(1) * cfg_.map_voxel_num(2));
+        }
+        rog_map::Vec3f local_end_pt = end_pt;
+        if (!insideLocalMap(end_pt) && !getLocalEndPoint(end_pt, start_pt, local_end_pt)) {
+            return INIT_ERROR;
+        }
+        rog_map::Vec3i start_idx, end_idx;
+        posToGlobalIndex(start_pt, start_idx);
+        posToGlobalIndex(local_end_pt, end_idx);
+        if (!insideLocalMap(start_idx) || !insideLocalMap(end_idx)) {
+            ros_ptr_->error(" -- [RM] Start [{}] or end point [{}] is out of local map, which should not happen.",
+                            start_pt.transpose(), local_end_pt.transpose());
+            return INIT_ERROR;
+        }
+
+        inc_.steps.clear();
+        inc_.step_costs.clear();
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dz = -1; dz <= 1; dz++) {
+                    const int norm1 = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                    if (norm1 == 0 || (!cfg_.allow_diag && norm1 > 1)) {
+                        continue;
+                    }
+                    inc_.steps.emplace_back(dx, dy, dz);
+                    inc_.step_costs.push_back(sqrt(static_cast<double>(norm1)));
+                }
+            }
+        }
+        // The nodes of the last session are left as they are, a new session invalidates all of them
+        inc_.session++;
+        inc_.open_set.clear();
+        inc_.flag = flag;
+        inc_.goal_pt = end_pt;
+        inc_.goal_idx = end_idx;
+        inc_.start_idx = start_idx;
+        inc_.local_map_center_id_g = md_.local_map_center_id_g;
+        inc_.local_map_center_d = md_.local_map_center_d;
+        inc_.km = 0;
+        // The map is read afresh, so only the position in the edge log is kept
+        inc_.edges.clear();
+        map_ptr_->getInfJumpingEdgesSince(inc_.edge_seq, inc_.edges);
+        inc_.map_origin = map_ptr_->getLocalMapOrigin();
+
+        IncrementalNode &goal = getIncrementalNode(end_idx);
+        goal.rhs = 0;
+        updateIncrementalVertex(goal, end_idx);
+        inc_.valid = true;
+        return SUCCESS;
+    }
+
+    bool Astar::applyIncrementalChanges() {
+        inc_.edges.clear();
+        if (!map_ptr_->getInfJumpingEdgesSince(inc_.edge_seq, inc_.edges)) {
+            return false;
+        }
+        const int r = map_ptr_->getInfMaxInflationStep();
+        for (const auto &edge: inc_.edges) {
+            const bool occ_changed = edge.from_type == OCCUPIED || edge.to_type == OCCUPIED;
+            const bool unk_changed = edge.from_type == UNKNOWN || edge.to_type == UNKNOWN;
+            if (!occ_changed && !(md_.unknown_as_occ && unk_changed)) {
+                continue;
+            }
+            for (int dx = -r; dx <= r; dx++) {
+                for (int dy = -r; dy <= r; dy++) {
+                    for (int dz = -r; dz <= r; dz++) {
+                        checkIncrementalCell(edge.id_g + rog_map::Vec3i(dx, dy, dz));
+                    }
+                }
+            }
+        }
+
+        // The cells entering or leaving the local map of ROG-Map are found from the move of its origin
+        const rog_map::Vec3f map_origin = map_ptr_->getLocalMapOrigin();
+        if (map_origin != inc_.map_origin) {
+            const rog_map::Vec3f half_size = map_ptr_->getLocalMapSize() / 2;
+            const rog_map::Vec3f old_min = inc_.map_origin - half_size, old_max = inc_.map_origin + half_size;
+            const rog_map::Vec3f new_min = map_origin - half_size, new_max = map_origin + half_size;
+            const rog_map::Vec3f margin = rog_map::Vec3f::Constant(2 * md_.resolution);
+            const rog_map::Vec3f union_min = old_min.cwiseMin(new_min) - margin;
+            const rog_map::Vec3f union_max = old_max.cwiseMax(new_max) + margin;
+            const rog_map::Vec3i search_min = md_.local_map_center_id_g - cfg_.map_size_i;
+            const rog_map::Vec3i search_max = md_.local_map_center_id_g + cfg_.map_size_i;
+            for (int axis = 0; axis < 3; axis++) {
+                if (map_origin(axis) == inc_.map_origin(axis)) {
+                    continue;
+                }
+                // The slabs between the old and the new bounds along the axis
+                const double slabs[2][2] = {{std::min(old_min(axis), new_min(axis)),
+                                             std::max(old_min(axis), new_min(axis))},
+                                            {std::min(old_max(axis), new_max(axis)),
+                                             std::max(old_max(axis), new_max(axis))}};
+                for (const auto &slab: slabs) {
+                    rog_map::Vec3f box_min = union_min, box_max = union_max;
+                    box_min(axis) = slab[0] - margin(axis);
+                    box_max(axis) = slab[1] + margin(axis);
+                    rog_map::Vec3i id_min, id_max;
+                    posToGlobalIndex(box_min, id_min);
+                    posToGlobalIndex(box_max, id_max);
+                    id_min = id_min.cwiseMax(search_min);
+                    id_max = id_max.cwiseMin(search_max);
+                    for (int x = id_min.x(); x <= id_max.x(); x++) {
+                        for (int y = id_min.y(); y <= id_max.y(); y++) {
+                            for (int z = id_min.z(); z <= id_max.z(); z++) {
+                                checkIncrementalCell(rog_map::Vec3i(x, y, z));
+                            }
+                        }
+                    }
+                }
+            }
+            inc_.map_origin = map_origin;
+        }
+        return true;
+    }
+
+    void Astar::checkIncrementalCell(const rog_map::Vec3i &id_g) {
+        if (!insideLocalMap(id_g)) {
+            return;
+        }
+        IncrementalNode &node = inc_.nodes[getLocalIndexHash(id_g)];
+        // No node of the session was searched with a cell never accessed
+        if (node.session != inc_.session) {
+            return;
+        }
+        const bool blocked = isBlockedType(getSearchGridType(id_g));
+        if (blocked == node.blocked) {
+            return;
+        }
+        node.blocked = blocked;
+        // The cost of the steps into the cell changed
+        for (const auto &step: inc_.steps) {
+            const rog_map::Vec3i nb = id_g - step;
+            if (insideLocalMap(nb)) {
+                updateIncrementalRhs(nb);
+            }
+        }
+    }
+
+    IncrementalNode &Astar::getIncrementalNode(const rog_map::Vec3i &id_g) {
+        IncrementalNode &node = inc_.nodes[getLocalIndexHash(id_g)];
+        if (node.session != inc_.session) {
+            node.session = inc_.session;
+            node.g = std::numeric_limits<double>::infinity();
+            node.rhs = std::numeric_limits<double>::infinity();
+            node.heap_id = -1;
+            node.blocked = isBlockedType(getSearchGridType(id_g));
+        }
+        return node;
+    }
+
+    void Astar::updateIncrementalRhs(const rog_map::Vec3i &id_g) {
+        IncrementalNode &node = getIncrementalNode(id_g);
+        if (id_g == inc_.goal_idx) {
+            return;
+        }
+        double rhs = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < inc_.steps.size(); i++) {
+            const rog_map::Vec3i nb = id_g + inc_.steps[i];
+            if (!insideLocalMap(nb)) {
+                continue;
+            }
+            const IncrementalNode &nb_node = getIncrementalNode(nb);
+            if (!nb_node.blocked) {
+                rhs = std::min(rhs, inc_.step_costs[i] + nb_node.g);
+            }
+        }
+        node.rhs = rhs;
+        updateIncrementalVertex(node, id_g);
+    }
+
+    void Astar::updateIncrementalVertex(IncrementalNode &node, const rog_map::Vec3i &id_g) {
+        if (node.g != node.rhs) {
+            node.total_score = std::min(node.g, node.rhs) + getIncrementalHeu(id_g, inc_.start_idx) + inc_.km;
+            if (node.heap_id >= 0) {
+                inc_.open_set.update(&node);
+            } else {
+                inc_.open_set.push(&node);
+            }
+        } else if (node.heap_id >= 0) {
+            inc_.open_set.remove(&node);
+        }
+    }
+
+    RET_CODE Astar::computeIncrementalPath(const double &time_1, const double &time_out) {
+        IncrementalNode &start = getIncrementalNode(inc_.start_idx);
+        IncrementalNodeLess less;
+        while (!inc_.open_set.empty()) {
+            IncrementalNode *top = inc_.open_set.top();
+            // The key of the start, its heuristic is zero. The nodes on a shortest path have the
+            // same key up to rounding, so the ties are expanded too, or their g may be stale.
+            IncrementalNode start_key = start;
+            start_key.total_score = std::min(start.g, start.rhs) + inc_.km + INCREMENTAL_KEY_EPS;
+            if (!less(top, &start_key) && start.rhs <= start.g) {
+                break;
+            }
+            num_iter_++;
+            const rog_map::Vec3i u = getGlobalIndexFromHash(static_cast<int>(top - inc_.nodes.data()));
+            const double new_score = std::min(top->g, top->rhs) + getIncrementalHeu(u, inc_.start_idx) + inc_.km;
+            if (top->total_score < new_score) {
+                // The key was computed for an earlier start
+                top->total_score = new_score;
+                inc_.open_set.update(top);
+            } else if (top->g > top->rhs) {
+                top->g = top->rhs;
+                inc_.open_set.remove(top);
+                // A blocked cell cannot be stepped into, so no neighbor gets a cost through it
+                if (!top->blocked) {
+                    for (size_t i = 0; i < inc_.steps.size(); i++) {
+                        const rog_map::Vec3i nb = u - inc_.steps[i];
+                        if (!insideLocalMap(nb) || nb == inc_.goal_idx) {
+                            continue;
+                        }
+                        IncrementalNode &nb_node = getIncrementalNode(nb);
+                        const double rhs = inc_.step_costs[i] + top->g;
+                        if (rhs < nb_node.rhs) {
+                            nb_node.rhs = rhs;
+                            updateIncrementalVertex(nb_node, nb);
+                        }
+                    }
+                }
+            } else {
+                const double g_old = top->g;
+                top->g = std::numeric_limits<double>::infinity();
+                updateIncrementalVertex(*top, u);
+                if (!top->blocked) {
+                    for (size_t i = 0; i < inc_.steps.size(); i++) {
+                        const rog_map::Vec3i nb = u - inc_.steps[i];
+                        if (!insideLocalMap(nb) || nb == inc_.goal_idx) {
+                            continue;
+                        }
+                        // Only the neighbors whose rhs came through the node
+                        if (getIncrementalNode(nb).rhs >= inc_.step_costs[i] + g_old) {
+                            updateIncrementalRhs(nb);
+                        }
+                    }
+                }
+            }
+            if (!cfg_.visual_process && (ros_ptr_->getSimTime() - time_1) > time_out) {
+                fmt::print(fg(fmt::color::indian_red),
+                           "Failed in incremental path searching !!! {} seconds time limit exceeded.\n", time_out);
+                return TIME_OUT;
+            }
+        }
+        if (!(start.rhs < std::numeric_limits<double>::infinity())) {
+            return NO_PATH;
+        }
+        return SUCCESS;
+    }
+
     bool Astar::neighborHaveOne(const rog_map::GridType& type, const rog_map::Vec3i& src_id) {
         for (const auto& nei : neighbor_list) {
             rog_map::Vec3i nei_id = src_id + nei;
@@ -0,0 +1,153 @@
+/**
+* This file is part of SUPER
+*
+* Copyright 2025 Yunfan REN, MaRS Lab, University of Hong Kong, <mars.hku.hk>
+* Developed by Yunfan REN <renyf at connect dot hku dot hk>
+* for more information see <https://github.com/hku-mars/SUPER>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* SUPER is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* SUPER is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with SUPER. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <path_search/jps_neighbor.h>
+#include <algorithm>
+#include <cmath>
+
+namespace path_search {
+    using super_utils::Vec3i;
+
+    static constexpr double COST_EPS = 1e-9;
+
+    static double getStepCost(const Vec3i &step) {
+        return std::sqrt(static_cast<double>(step.squaredNorm()));
+    }
+
+    JpsNeighbor::JpsNeighbor() {
+        for (int x = -1; x <= 1; x++) {
+            for (int y = -1; y <= 1; y++) {
+                for (int z = -1; z <= 1; z++) {
+                    const Vec3i offset(x, y, z);
+                    offsets_[getOffsetId(offset)] = offset;
+                }
+            }
+        }
+        for (const auto &dir: offsets_) {
+            buildDirection(dir, dirs_[getOffsetId(dir)]);
+        }
+    }
+
+    void JpsNeighbor::buildDirection(const Vec3i &dir, JpsDirection &jd) const {
+        if (dir == Vec3i::Zero()) {
+            for (const auto &offset: offsets_) {
+                if (offset != Vec3i::Zero()) {
+                    jd.natural.push_back(offset);
+                }
+            }
+            return;
+        }
+        const Vec3i parent = -dir;
+        const int dir_norm = dir.cwiseAbs().sum();
+        std::vector<std::pair<Vec3i, std::vector<uint32_t>>> candidates;
+        for (const auto &target: offsets_) {
+            if (target == Vec3i::Zero() || target == parent) {
+                continue;
+            }
+            std::vector<uint32_t> masks;
+            const double via_cost = getStepCost(dir) + getStepCost(target);
+            const bool tie_en = target.cwiseAbs().sum() > dir_norm;
+            const uint32_t parent_bit = 1u << getOffsetId(parent);
+            searchAlternatives(parent, target, 0.0, via_cost, tie_en, 3, true, parent_bit, masks);
+            // The parent is free, so only the cells after it are kept in a mask
+            for (auto &mask: masks) {
+                mask &= ~parent_bit;
+            }
+            if (masks.empty()) {
+                jd.natural.push_back(target);
+                if (target != dir) {
+                    jd.sub_dirs.push_back(target);
+                }
+                continue;
+            }
+            // Only keep the minimal cell sets, a superset is blocked whenever its subset is
+            std::sort(masks.begin(), masks.end());
+            masks.erase(std::unique(masks.begin(), masks.end()), masks.end());
+            std::vector<uint32_t> minimal;
+            for (const auto &mask: masks) {
+                bool has_subset = false;
+                for (const auto &other: masks) {
+                    if (other != mask && (other & mask) == other) {
+                        has_subset = true;
+                        break;
+                    }
+                }
+                if (!has_subset) {
+                    minimal.push_back(mask);
+                }
+            }
+            // A path through the parent only, the target is never forced
+            if (minimal.front() == 0) {
+                continue;
+            }
+            candidates.emplace_back(target, minimal);
+        }
+
+        for (const auto &cand: candidates) {
+            JpsDirection::Forced forced;
+            forced.dir = cand.first;
+            for (const auto &mask: cand.second) {
+                uint16_t local_mask = 0;
+                for (int id = 0; id < 27; id++) {
+                    if (!(mask & (1u << id))) {
+                        continue;
+                    }
+                    auto it = std::find(jd.check_cells.begin(), jd.check_cells.end(), offsets_[id]);
+                    if (it == jd.check_cells.end()) {
+                        jd.check_cells.push_back(offsets_[id]);
+                        it = jd.check_cells.end() - 1;
+                    }
+                    local_mask |= static_cast<uint16_t>(1u << (it - jd.check_cells.begin()));
+                }
+                forced.masks.push_back(local_mask);
+            }
+            jd.forced.push_back(forced);
+        }
+    }
+
+    void JpsNeighbor::searchAlternatives(const Vec3i &cur, const Vec3i &target,
+                                         const double &cost, const double &via_cost, const bool &tie_en,
+                                         const int &last_norm, const bool &canonical, const uint32_t &used,
+                                         std::vector<uint32_t> &masks) const {
+        if (cur == target) {
+            if (cost < via_cost - COST_EPS || (tie_en && canonical)) {
+                masks.push_back(used & ~(1u << getOffsetId(target)));
+            }
+            return;
+        }
+        for (const auto &next: offsets_) {
+            const Vec3i step = next - cur;
+            if (next == Vec3i::Zero() || (used & (1u << getOffsetId(next))) ||
+                step.cwiseAbs().maxCoeff() != 1) {
+                continue;
+            }
+            const double next_cost = cost + getStepCost(step);
+            if (next_cost > via_cost + COST_EPS) {
+                continue;
+            }
+            const int step_norm = step.cwiseAbs().sum();
+            searchAlternatives(next, target, next_cost, via_cost, tie_en, step_norm,
+                               canonical && step_norm <= last_norm, used | (1u << getOffsetId(next)), masks);
+        }
+    }
+}
@@ -167,6 +167,9 @@ namespace super_planner {
                              const bool &new_goal) {
         TimeConsuming replan_total_t("ReplanOnce", false);
         std::lock_guard<std::mutex> guard(replan_lock_);
+        // All map queries of this replan read the same map epoch, the map updates coming
+        // meanwhile are queued by the map thread and applied after it, without blocking it
+        const auto map_view = map_ptr_->getReadView();
 
         gi_.goal_p = goal_p;
         gi_.goal_yaw = goal_yaw;
@@ -1153,6 +1156,10 @@ namespace super_planner {
         //            int start_id = getNearestFurtherGoalPoint(goal_waypoints, start_pt);
 
         int flag = ON_INF_MAP | (cfg_.frontend_in_known_free ? UNKNOWN_AS_OCCUPIED : UNKNOWN_AS_FREE) | DONT_USE_INF_NEIGHBOR;
+        if (cfg_.frontend_incremental_en) {
+            // Repair the search of the last replan instead of starting over
+            flag |= USE_INCREMENTAL;
+        }
 
         RET_CODE ret_code = astar_ptr_->pointToPointPathSearch(temp_start_point, goal, flag, temp_plannning_horizon,
                                                                path);